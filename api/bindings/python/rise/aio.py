@@ -0,0 +1,359 @@
+"""
+G-Assist (RISE) asyncio Binding
+
+Concurrent, asyncio-friendly sessions on top of the native RiseClient in
+python_binding.dll. Unlike rise.py, no Python code runs on the driver's
+callback thread: the DLL collects the output of every session into one
+native batch, and a reader thread fetches whole batches with rise_poll(),
+which waits with the GIL released. Each batch is parsed in place from the
+native buffer, decoded once and handed to the event loop in a single call,
+so Python pays for one GIL acquisition and one loop wakeup per batch rather
+than per token.
+
+Sessions are queued by the client and sent to the engine one after
+another in submission order; any number may be outstanding.
+
+Usage:
+    import asyncio
+    from rise import aio
+
+    async def main():
+        async with aio.AsyncRiseClient() as client:
+            result = await client.send('What is my GPU?')
+            print(result['completed_response'])
+
+            session = client.stream('Tell me about my system')
+            async for kind, text in session:
+                print(text, end='', flush=True)
+            print((await session.result())['ttft_ms'])
+
+    asyncio.run(main())
+
+NVAPI keeps one RISE callback per process, so do not combine this module
+with rise.register_rise_client().
+"""
+
+import asyncio
+import codecs
+import collections
+import ctypes
+import struct
+import threading
+from typing import Any, Callable, Dict, Optional, Tuple
+
+from . import rise as _rise
+
+# Output kinds, indexed by the record kind (Rise::OutputKind)
+OUTPUT_KINDS = ('text', 'custom_behavior', 'custom_behavior_result', 'graph', 'asr_interim', 'asr_final')
+
+_RECORD_DONE = 16
+_RECORD_FAILED = 17
+_RECORD_EVENT = 32
+
+_RECORD = struct.Struct('<QII')     # session, kind, length
+_DONE = struct.Struct('<3d')        # queue, time to first token, total (ms)
+_EVENT = struct.Struct('<ii')       # content type, completed
+
+_TEXT_KINDS = (0, 1, 2)             # accumulate into completed_response
+_GRAPH_KIND = 3
+_ASR_KINDS = (4, 5)                 # whole messages; not split across records
+
+_nvapi = None                       # python_binding.dll, once _bind() has set it up
+
+
+class RiseError(Exception):
+    """Raised when connecting fails or a session fails or is cancelled."""
+
+
+def _bind():
+    """
+    Look up the session API in python_binding.dll on first use, so that the
+    module still imports with a DLL built before it existed.
+
+    Raises:
+        RiseError: If the DLL does not export the session API
+    """
+    global _nvapi
+    if _nvapi is not None:
+        return _nvapi
+
+    lib = _rise.nvapi
+    try:
+        lib.rise_client_connect.argtypes = [ctypes.c_int]
+        lib.rise_client_connect.restype = ctypes.c_int
+        lib.rise_client_close.argtypes = []
+        lib.rise_client_close.restype = None
+        lib.rise_submit.argtypes = [ctypes.c_char_p]
+        lib.rise_submit.restype = ctypes.c_uint64
+        lib.rise_cancel.argtypes = [ctypes.c_uint64]
+        lib.rise_cancel.restype = ctypes.c_int
+        lib.rise_poll.argtypes = [ctypes.c_int, ctypes.c_int,
+                                  ctypes.POINTER(ctypes.c_void_p), ctypes.POINTER(ctypes.c_size_t)]
+        lib.rise_poll.restype = ctypes.c_int
+        lib.rise_delivery_overflows.argtypes = []
+        lib.rise_delivery_overflows.restype = ctypes.c_uint64
+    except AttributeError as e:
+        raise RiseError(f'{_rise.LIB_PATH} predates the asyncio session API ({e}); '
+                        'rebuild python_binding.dll from wrapper.cpp to use rise.aio') from None
+    _nvapi = lib
+    return lib
+
+
+class RiseSession:
+    """
+    One prompt and its streamed output.
+
+    Iterate with `async for kind, text in session` to receive output as it
+    arrives; consecutive chunks that arrived in the same batch come as one
+    item. `await session.result()` waits for completion either way.
+    """
+
+    def __init__(self, client: 'AsyncRiseClient', session_id: int):
+        self.id = session_id
+        self._client = client
+        self._chunks = collections.deque()
+        self._waiter: Optional[asyncio.Future] = None
+        self._done = client._loop.create_future()
+        self._text = []
+        self._chart = []
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self) -> Tuple[str, str]:
+        while not self._chunks:
+            if self._done.done():
+                raise StopAsyncIteration
+            self._waiter = self._client._loop.create_future()
+            try:
+                await self._waiter
+            finally:
+                self._waiter = None
+        return self._chunks.popleft()
+
+    def done(self) -> bool:
+        return self._done.done()
+
+    async def result(self) -> Dict[str, Any]:
+        """
+        Wait for the session to finish.
+
+        Returns:
+            dict: completed_response, completed_chart, ttft_ms, api_time_ms
+                  (as rise.send_rise_command) and queue_ms
+
+        Raises:
+            RiseError: If the session failed or was cancelled
+        """
+        return await asyncio.shield(self._done)
+
+    def cancel(self) -> bool:
+        """Cancel the session; False if it had already finished."""
+        if self._done.done():
+            return False
+        return _nvapi.rise_cancel(self.id) != 0
+
+    # Event loop thread
+
+    def _feed(self, kind: int, text: str) -> None:
+        if kind == _GRAPH_KIND:
+            self._chart.append(text)
+        elif kind in _TEXT_KINDS:
+            self._text.append(text)
+        self._chunks.append((OUTPUT_KINDS[kind], text))
+        self._wake()
+
+    def _finish(self, failed: bool, timings: Tuple[float, float, float], error: str) -> None:
+        if self._done.done():
+            return
+        if failed:
+            self._done.set_exception(RiseError(error or 'request failed'))
+            # Retrieved or not, a failure is reported by result()
+            self._done.exception()
+        else:
+            queue_ms, ttft_ms, total_ms = timings
+            self._done.set_result({
+                'completed_response': ''.join(self._text),
+                'completed_chart': ''.join(self._chart),
+                'ttft_ms': ttft_ms,
+                'api_time_ms': total_ms,
+                'queue_ms': queue_ms,
+            })
+        self._wake()
+
+    def _wake(self) -> None:
+        if self._waiter is not None and not self._waiter.done():
+            self._waiter.set_result(None)
+
+
+class AsyncRiseClient:
+    """
+    asyncio client for RISE. Create, connect and use it from one event loop.
+
+    Args:
+        linger_ms: After the first output of a batch arrives, how long the
+                   reader waits for more before waking the loop. Bounds the
+                   wakeup rate while streaming at the cost of that much
+                   latency; 0 hands out every batch at once.
+        on_event: Called on the loop for engine events that belong to no
+                  session (READY, PROGRESS_UPDATE, DOWNLOAD_REQUEST, ...)
+                  with (content_type, completed, text).
+    """
+
+    POLL_TIMEOUT_MS = 250
+
+    def __init__(self, linger_ms: int = 2,
+                 on_event: Optional[Callable[[int, bool, str], None]] = None):
+        self._linger_ms = linger_ms
+        self._on_event = on_event
+        self._loop: Optional[asyncio.AbstractEventLoop] = None
+        self._sessions: Dict[int, RiseSession] = {}
+        self._reader: Optional[threading.Thread] = None
+        self._connected = False
+
+    async def __aenter__(self) -> 'AsyncRiseClient':
+        await self.connect()
+        return self
+
+    async def __aexit__(self, *exc_info) -> None:
+        await self.close()
+
+    async def connect(self, ready_timeout: float = 30.0) -> None:
+        """
+        Register with RISE and wait until it reports READY.
+
+        Raises:
+            RiseError: If registration fails, RISE is not ready in time or
+                python_binding.dll needs rebuilding for this module
+        """
+        if self._connected:
+            return
+        nvapi = _bind()
+        self._loop = asyncio.get_running_loop()
+        status = await self._loop.run_in_executor(None, nvapi.rise_client_connect, int(ready_timeout * 1000))
+        if status == -1:
+            raise RiseError('RISE did not become ready in time')
+        if status == -2:
+            raise RiseError('another AsyncRiseClient is connected')
+        if status != 0:
+            raise RiseError(f'RISE registration failed with {status}')
+
+        self._connected = True
+        self._reader = threading.Thread(target=self._read_loop, name='rise-reader', daemon=True)
+        self._reader.start()
+
+    def stream(self, command: str, payload: Optional[Dict[str, Any]] = None) -> RiseSession:
+        """
+        Queue a command and return its session without waiting.
+
+        Args:
+            command: The text command to send to RISE
+            payload: Optional dict merged into the request (see rise.send_rise_command)
+
+        Raises:
+            RiseError: If the client is not connected
+        """
+        if not self._connected:
+            raise RiseError('not connected')
+        session_id = _nvapi.rise_submit(_rise.build_command_content(command, payload))
+        if session_id == 0:
+            raise RiseError('not connected')
+        # Registered before the loop can run the dispatch of its first batch
+        session = RiseSession(self, session_id)
+        self._sessions[session_id] = session
+        return session
+
+    async def send(self, command: str, payload: Optional[Dict[str, Any]] = None) -> Dict[str, Any]:
+        """Send a command and wait for its result (see RiseSession.result())."""
+        return await self.stream(command, payload).result()
+
+    def delivery_overflows(self) -> int:
+        """Callbacks that found the native delivery ring full."""
+        return _nvapi.rise_delivery_overflows() if _nvapi is not None else 0
+
+    async def close(self) -> None:
+        """Fail outstanding sessions and unregister from RISE."""
+        if not self._connected:
+            return
+        self._connected = False
+        await self._loop.run_in_executor(None, _nvapi.rise_client_close)
+        await self._loop.run_in_executor(None, self._reader.join)
+        # Let the last dispatches run before failing whatever they missed
+        await asyncio.sleep(0)
+        for session in self._sessions.values():
+            session._finish(True, (0.0, 0.0, 0.0), 'client shut down')
+        self._sessions.clear()
+
+    # Reader thread
+
+    def _read_loop(self) -> None:
+        data = ctypes.c_void_p()
+        size = ctypes.c_size_t()
+        decoders: Dict[Tuple[int, int], Any] = {}
+
+        while True:
+            status = _nvapi.rise_poll(self.POLL_TIMEOUT_MS, self._linger_ms, ctypes.byref(data), ctypes.byref(size))
+            if status < 0:
+                return
+            if status == 0:
+                continue
+
+            # View of the native batch; valid until the next rise_poll()
+            view = memoryview((ctypes.c_ubyte * size.value).from_address(data.value))
+            records = []
+            offset = 0
+            while offset < size.value:
+                session, kind, length = _RECORD.unpack_from(view, offset)
+                offset += _RECORD.size
+                body = view[offset:offset + length]
+                offset += length
+
+                if kind in _ASR_KINDS:
+                    records.append((session, kind, codecs.decode(body, 'utf-8', 'replace')))
+                elif kind < len(OUTPUT_KINDS):
+                    # A character may be split across callbacks
+                    decoder = decoders.get((session, kind))
+                    if decoder is None:
+                        decoder = decoders[(session, kind)] = codecs.getincrementaldecoder('utf-8')('replace')
+                    text = decoder.decode(body)
+                    if text:
+                        records.append((session, kind, text))
+                elif kind == _RECORD_DONE or kind == _RECORD_FAILED:
+                    for output_kind in range(len(OUTPUT_KINDS)):
+                        decoder = decoders.pop((session, output_kind), None)
+                        tail = decoder.decode(b'', True) if decoder is not None else ''
+                        if tail:
+                            records.append((session, output_kind, tail))
+                    timings = _DONE.unpack_from(body)
+                    error = codecs.decode(body[_DONE.size:], 'utf-8', 'replace')
+                    records.append((session, kind, (timings, error)))
+                elif kind == _RECORD_EVENT:
+                    content_type, completed = _EVENT.unpack_from(body)
+                    text = codecs.decode(body[_EVENT.size:], 'utf-8', 'replace')
+                    records.append((0, kind, (content_type, completed == 1, text)))
+            view.release()
+
+            try:
+                self._loop.call_soon_threadsafe(self._dispatch, records)
+            except RuntimeError:
+                return  # the loop was closed without close()
+
+    # Event loop thread
+
+    def _dispatch(self, records) -> None:
+        for session_id, kind, value in records:
+            if kind == _RECORD_EVENT:
+                if self._on_event is not None:
+                    self._on_event(*value)
+                continue
+
+            # Output racing a cancellation is dropped with its session
+            session = self._sessions.get(session_id)
+            if session is None:
+                continue
+            if kind < len(OUTPUT_KINDS):
+                session._feed(kind, value)
+            else:
+                timings, error = value
+                del self._sessions[session_id]
+                session._finish(kind == _RECORD_FAILED, timings, error)
@@ -239,6 +239,37 @@ def register_rise_client() -> None:
         print(f"An error occurred: {e}")
 
 
+def build_command_content(command: str, payload: Optional[Dict[str, Any]] = None) -> bytes:
+    """
+    Build the UTF-8 JSON request body for a text command.
+
+    Args:
+        command: The text command to send to RISE
+        payload: Optional dict to merge into the request payload (see send_rise_command)
+
+    Returns:
+        bytes: The encoded request content
+    """
+    # Build base command object
+    command_obj = {
+        'prompt': command,
+        'context_assist': {},
+        'client_config': {}
+    }
+
+    # Merge any provided payload fields
+    if payload:
+        for key, value in payload.items():
+            if key in command_obj and isinstance(command_obj[key], dict) and isinstance(value, dict):
+                # Merge dicts (e.g., context_assist, client_config)
+                command_obj[key].update(value)
+            else:
+                # Replace or add new keys
+                command_obj[key] = value
+
+    return json.dumps(command_obj).encode('utf-8')
+
+
 def send_rise_command(command: str, payload: Optional[Dict[str, Any]] = None) -> Optional[dict]:
     """
     Send a command to RISE and wait for the response.
@@ -261,25 +292,8 @@ def send_rise_command(command: str, payload: Optional[Dict[str, Any]] = None) ->
     global nvapi, response_done, response, chart, ttft_timestamp, api_start_timestamp
 
     try:
-        # Build base command object
-        command_obj = {
-            'prompt': command,
-            'context_assist': {},
-            'client_config': {}
-        }
-        
-        # Merge any provided payload fields
-        if payload:
-            for key, value in payload.items():
-                if key in command_obj and isinstance(command_obj[key], dict) and isinstance(value, dict):
-                    # Merge dicts (e.g., context_assist, client_config)
-                    command_obj[key].update(value)
-                else:
-                    # Replace or add new keys
-                    command_obj[key] = value
-
         content = NV_REQUEST_RISE_SETTINGS_V1()
-        content.content = json.dumps(command_obj).encode('utf-8')
+        content.content = build_command_content(command, payload)
         content.contentType = NV_RISE_CONTENT_TYPE.NV_RISE_CONTENT_TYPE_TEXT
         content.version = ctypes.sizeof(NV_REQUEST_RISE_SETTINGS_V1) | (1 << 16)
         content.completed = 1
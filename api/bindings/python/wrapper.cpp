@@ -1,4 +1,14 @@
 #include "nvapi.h"  // This is the header file for the static library functions
+#include "rise_client.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 extern "C" __declspec(dllexport) int register_rise_callback(NV_RISE_CALLBACK_SETTINGS* pCallbackSettings)
 {
@@ -8,4 +18,338 @@ extern "C" __declspec(dllexport) int register_rise_callback(NV_RISE_CALLBACK_SET
 extern "C" __declspec(dllexport) int request_rise(NV_REQUEST_RISE_SETTINGS* requestContent)
 {
     return NvAPI_RequestRise(requestContent);  // Call the function from the static library
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Session API (rise/aio.py)
+//
+// A Rise::RiseClient owned by the DLL, so the driver callback never enters
+// Python. Output of every session, completions and engine events are
+// appended to one native batch; rise_poll() blocks without the GIL (ctypes
+// releases it around the call) and hands the whole batch to the caller.
+// Python takes the GIL once per batch instead of once per token.
+//
+// A batch is a sequence of unaligned little-endian records:
+//
+//   uint64 session | uint32 kind | uint32 length | length bytes
+//
+//   kind 0-5   output of `session` (Rise::OutputKind); consecutive text of
+//              one session and kind is merged into one record
+//   kind 16    session completed; content is RiseDone
+//   kind 17    session failed; content is RiseDone + error message
+//   kind 32    engine event (session 0); content is RiseEvent + text
+//
+// The pointer returned by rise_poll() stays valid until the next call; the
+// two batch buffers are swapped, never freed, so steady streaming does not
+// allocate. Only one thread may poll, and rise_client_close() must not
+// overlap the other calls.
+// ============================================================================
+
+namespace {
+
+enum RiseRecordKind : uint32_t {
+    RISE_RECORD_DONE = 16,
+    RISE_RECORD_FAILED = 17,
+    RISE_RECORD_EVENT = 32,
+};
+
+#pragma pack(push, 1)
+struct RiseRecordHeader {
+    uint64_t session;
+    uint32_t kind;
+    uint32_t length;
+};
+
+struct RiseDone {
+    double queueMs;
+    double timeToFirstTokenMs;
+    double totalMs;
+};
+
+struct RiseEvent {
+    int32_t contentType;
+    int32_t completed;
+};
+#pragma pack(pop)
+
+constexpr size_t BATCH_RESERVE = 64 * 1024;
+constexpr size_t NO_RECORD = SIZE_MAX;
+
+class SessionQueue {
+public:
+    SessionQueue() {
+        pending_.reserve(BATCH_RESERVE);
+        reading_.reserve(BATCH_RESERVE);
+    }
+
+    void Open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        lastRecord_ = NO_RECORD;
+        closed_ = false;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        condition_.notify_all();
+    }
+
+    // Delivery thread
+    void PushOutput(uint64_t session, Rise::OutputKind kind, const std::string& content) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t recordKind = static_cast<uint32_t>(kind);
+
+        // ASR results replace each other, so only text is merged
+        bool mergeable = kind != Rise::OutputKind::AsrInterim && kind != Rise::OutputKind::AsrFinal;
+        if (mergeable && lastRecord_ != NO_RECORD) {
+            RiseRecordHeader last;
+            std::memcpy(&last, pending_.data() + lastRecord_, sizeof(last));
+            if (last.session == session && last.kind == recordKind) {
+                last.length += static_cast<uint32_t>(content.size());
+                std::memcpy(pending_.data() + lastRecord_, &last, sizeof(last));
+                pending_.insert(pending_.end(), content.begin(), content.end());
+                return;
+            }
+        }
+
+        size_t offset = Append(session, recordKind, content.data(), content.size());
+        lastRecord_ = mergeable ? offset : NO_RECORD;
+        condition_.notify_one();
+    }
+
+    void PushDone(uint64_t session, const Rise::Request& request) {
+        Rise::RequestTimings timings = request.Timings();
+        RiseDone done = { timings.QueueMs(), timings.TimeToFirstTokenMs(), timings.TotalMs() };
+        bool failed = !request.Succeeded();
+        std::string error = failed ? request.Error() : std::string();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t offset = Append(session, failed ? RISE_RECORD_FAILED : RISE_RECORD_DONE,
+                               &done, sizeof(done), error.size());
+        std::memcpy(pending_.data() + offset + sizeof(RiseRecordHeader) + sizeof(done), error.data(), error.size());
+        lastRecord_ = NO_RECORD;
+        condition_.notify_one();
+    }
+
+    void PushEvent(const NV_RISE_CALLBACK_DATA_V1& data) {
+        std::string_view content = Rise::ContentView(data);
+        RiseEvent event = { data.contentType, data.completed };
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t offset = Append(0, RISE_RECORD_EVENT, &event, sizeof(event), content.size());
+        std::memcpy(pending_.data() + offset + sizeof(RiseRecordHeader) + sizeof(event), content.data(), content.size());
+        lastRecord_ = NO_RECORD;
+        condition_.notify_one();
+    }
+
+    /**
+     * Wait up to timeoutMs for records, then up to lingerMs more so tokens
+     * close together share a batch. Returns 1 with a batch, 0 on timeout and
+     * -1 once closed and drained.
+     */
+    int Poll(int timeoutMs, int lingerMs, const char** data, size_t* size) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                            [this] { return closed_ || !pending_.empty(); });
+        if (pending_.empty()) {
+            *data = nullptr;
+            *size = 0;
+            return closed_ ? -1 : 0;
+        }
+        if (lingerMs > 0 && !closed_) {
+            condition_.wait_for(lock, std::chrono::milliseconds(lingerMs), [this] { return closed_; });
+        }
+
+        // The previous batch is done with once the caller polls again
+        reading_.clear();
+        reading_.swap(pending_);
+        lastRecord_ = NO_RECORD;
+        *data = reading_.data();
+        *size = reading_.size();
+        return 1;
+    }
+
+private:
+    // Caller holds mutex_; `extra` bytes after `content` are left for the
+    // caller to fill. Returns the offset of the record.
+    size_t Append(uint64_t session, uint32_t kind, const void* content, size_t length, size_t extra = 0) {
+        RiseRecordHeader header = { session, kind, static_cast<uint32_t>(length + extra) };
+        size_t offset = pending_.size();
+        pending_.resize(offset + sizeof(header) + length + extra);
+        std::memcpy(pending_.data() + offset, &header, sizeof(header));
+        if (length > 0) {
+            std::memcpy(pending_.data() + offset + sizeof(header), content, length);
+        }
+        return offset;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<char> pending_;     // filled by the client's threads
+    std::vector<char> reading_;     // last batch handed to the poller
+    size_t lastRecord_ = NO_RECORD; // mergeable record at the end of pending_
+    bool closed_ = true;
+};
+
+SessionQueue g_queue;
+
+// Serializes rise_client_connect() and rise_client_close(). The client is
+// destroyed outside g_sessionMutex and g_clientMutex: its destructor fails
+// outstanding requests and runs their completion handlers, which take
+// g_sessionMutex.
+std::mutex g_connectMutex;
+
+// Held shared for the whole of every call that uses g_client, and
+// exclusively to install or remove it, so close() cannot destroy the
+// client under a running rise_submit() or rise_cancel()
+std::shared_mutex g_clientMutex;
+std::unique_ptr<Rise::RiseClient> g_client;
+
+// Sessions are numbered by the binding so output handlers know their id
+// before SubmitLlmContent() returns
+std::mutex g_sessionMutex;
+uint64_t g_nextSession = 1;
+std::unordered_map<const Rise::Request*, uint64_t> g_sessionIds;
+std::unordered_map<uint64_t, std::shared_ptr<Rise::Request>> g_sessions;
+
+// Called when any request finishes; see SetCompletionHandler()
+void OnRequestFinished(const std::shared_ptr<Rise::Request>& request) {
+    uint64_t session;
+    {
+        std::lock_guard<std::mutex> lock(g_sessionMutex);
+        auto it = g_sessionIds.find(request.get());
+        if (it == g_sessionIds.end()) return;   // finished inside rise_submit(), which reports it
+        session = it->second;
+        g_sessionIds.erase(it);
+        g_sessions.erase(session);
+    }
+    g_queue.PushDone(session, *request);
+}
+
+} // namespace
+
+/**
+ * Create the client, connect and wait up to readyTimeoutMs for READY.
+ * Returns 0, the NvAPI status of a failed connect, or -1 on timeout and
+ * -2 if already connected. Replaces any callback set through
+ * register_rise_callback().
+ */
+extern "C" __declspec(dllexport) int rise_client_connect(int readyTimeoutMs)
+{
+    std::lock_guard<std::mutex> connectLock(g_connectMutex);
+    {
+        std::shared_lock<std::shared_mutex> lock(g_clientMutex);
+        if (g_client) return -2;
+    }
+    g_queue.Open();
+
+    auto client = std::make_unique<Rise::RiseClient>();
+    client->SetEventHandler([](const NV_RISE_CALLBACK_DATA_V1& data) { g_queue.PushEvent(data); });
+    client->SetCompletionHandler(OnRequestFinished);
+
+    NvAPI_Status status = client->Connect();
+    if (status == NVAPI_OK && !client->WaitUntilReady(std::chrono::milliseconds(readyTimeoutMs))) {
+        status = static_cast<NvAPI_Status>(-1);
+    }
+    if (status != NVAPI_OK) {
+        client.reset();
+        g_queue.Close();
+        return status;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(g_clientMutex);
+    g_client = std::move(client);
+    return NVAPI_OK;
+}
+
+/**
+ * Fail outstanding sessions, shut the client down and end polling once
+ * their completions were read
+ */
+extern "C" __declspec(dllexport) void rise_client_close()
+{
+    std::lock_guard<std::mutex> connectLock(g_connectMutex);
+    std::unique_ptr<Rise::RiseClient> client;
+    {
+        std::unique_lock<std::shared_mutex> lock(g_clientMutex);
+        client.swap(g_client);
+    }
+    client.reset();     // completion handlers run in here
+
+    {
+        std::lock_guard<std::mutex> lock(g_sessionMutex);
+        g_sessionIds.clear();
+        g_sessions.clear();
+    }
+    g_queue.Close();
+}
+
+/**
+ * Queue a request built by the caller ({"prompt": ..., "context_assist":
+ * ..., "client_config": ...}). Returns its session id, or 0 if the client
+ * is not connected. A request that fails immediately still gets its
+ * completion record.
+ */
+extern "C" __declspec(dllexport) uint64_t rise_submit(const char* content)
+{
+    std::shared_lock<std::shared_mutex> clientLock(g_clientMutex);
+    if (!g_client || !content) return 0;
+
+    uint64_t session;
+    {
+        std::lock_guard<std::mutex> lock(g_sessionMutex);
+        session = g_nextSession++;
+    }
+
+    // Not under g_sessionMutex: a request that fails at once calls
+    // OnRequestFinished() from inside SubmitLlmContent()
+    std::shared_ptr<Rise::Request> request = g_client->SubmitLlmContent(content,
+        [session](Rise::OutputKind kind, const std::string& chunk) { g_queue.PushOutput(session, kind, chunk); });
+
+    // OnRequestFinished() marks the request done before it takes the lock,
+    // so exactly one of the two reports it
+    {
+        std::lock_guard<std::mutex> lock(g_sessionMutex);
+        if (!request->IsDone()) {
+            g_sessionIds[request.get()] = session;
+            g_sessions[session] = request;
+            return session;
+        }
+    }
+    g_queue.PushDone(session, *request);
+    return session;
+}
+
+// Cancel a session; 0 if it had already finished
+extern "C" __declspec(dllexport) int rise_cancel(uint64_t session)
+{
+    std::shared_lock<std::shared_mutex> clientLock(g_clientMutex);
+    if (!g_client) return 0;
+
+    std::shared_ptr<Rise::Request> request;
+    {
+        std::lock_guard<std::mutex> lock(g_sessionMutex);
+        auto it = g_sessions.find(session);
+        if (it == g_sessions.end()) return 0;
+        request = it->second;
+    }
+    return g_client->Cancel(request) ? 1 : 0;
+}
+
+/**
+ * Block up to timeoutMs for a batch, then linger up to lingerMs to let it
+ * grow. Returns 1 and sets `data` and `size`, 0 on timeout, -1 after
+ * rise_client_close() once everything was read.
+ */
+extern "C" __declspec(dllexport) int rise_poll(int timeoutMs, int lingerMs, const char** data, size_t* size)
+{
+    return g_queue.Poll(timeoutMs, lingerMs, data, size);
+}
+
+// Callbacks that found the client's delivery ring full (RiseClient::DeliveryOverflows)
+extern "C" __declspec(dllexport) uint64_t rise_delivery_overflows()
+{
+    std::shared_lock<std::shared_mutex> lock(g_clientMutex);
+    return g_client ? g_client->DeliveryOverflows() : 0;
+}
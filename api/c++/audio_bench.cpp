@@ -0,0 +1,637 @@
+/*
+ * Audio Pipeline Benchmark
+ *
+ * Measures the client-side ASR audio path on machines without a microphone,
+ * to validate audio optimizations on build machines.
+ *
+ * Usage:
+ *   audio_bench.exe [--wav <file>] [--seconds N] [--iterations N]
+ *   audio_bench.exe --replay [--wav <file>] [--seconds N] [--speed X]
+ *                   [--period-ms N] [--chunk-format F] [--no-vad] [--engine]
+ *
+ * The audio is a WAV fixture (streamed through WavStream, so resampled to
+ * 16 kHz like gassist_cli does) or, without --wav, SimulatedAudioCapture's
+ * 440 Hz tone in 1.5 s bursts with 1 s pauses, so the voice gate has speech
+ * and silence to tell apart.
+ *
+ * Throughput mode times each stage over the whole clip, best of N passes:
+ * int16 -> float conversion, base64 (per supported ISA), complete chunk
+ * formatting, resampling (48 and 44.1 kHz to 16 kHz), stereo downmix, the
+ * voice gate, and the AudioRingBuffer handoff between two threads.
+ *
+ * Replay mode runs the microphone demo's sender loop (MicSender: ring
+ * buffer, voice gate, chunk encoding) while a capture thread writes the clip
+ * into the ring in device-sized periods at real-time pace (or --speed times
+ * faster). Each sent chunk's latency is measured from the moment the capture
+ * thread wrote the newest sample read so far until the chunk was handed
+ * off; jitter is the standard deviation of those latencies. Chunks are only
+ * formatted, unless --engine streams them to RISE through AsrSession, in
+ * which case latency includes the chunk window and NvAPI_RequestRise.
+ *
+ * Output: one JSON object per line on stdout; progress and errors on stderr.
+ */
+
+#define NOMINMAX
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "mic_sender.h"
+#include "rise_client.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string wavPath;        // empty: simulated audio
+    int seconds = 30;           // length of simulated audio
+    int iterations = 5;         // timed passes per throughput benchmark
+    bool replay = false;
+    double speed = 1.0;         // replay pace, 1.0 = real time
+    int periodMs = 10;          // replay capture period (typical WASAPI period)
+    Rise::ChunkEncoding encoding = Rise::ChunkEncoding::Float32;
+    bool voiceGate = true;
+    bool engine = false;        // replay into RISE instead of formatting only
+};
+
+// ============================================================================
+// Output
+// ============================================================================
+
+/**
+ * One result line: {"bench":"<name>", ...}
+ */
+class ResultLine {
+public:
+    explicit ResultLine(const char* bench) : text_("{\"bench\":" + Quote(bench)) {}
+
+    ResultLine& Text(const char* key, const std::string& value) {
+        text_ += ",\"" + std::string(key) + "\":" + Quote(value);
+        return *this;
+    }
+
+    ResultLine& Number(const char* key, double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+        text_ += ",\"" + std::string(key) + "\":" + buffer;
+        return *this;
+    }
+
+    ResultLine& Count(const char* key, uint64_t value) {
+        text_ += ",\"" + std::string(key) + "\":" + std::to_string(value);
+        return *this;
+    }
+
+    ResultLine& Flag(const char* key, bool value) {
+        text_ += ",\"" + std::string(key) + "\":" + (value ? "true" : "false");
+        return *this;
+    }
+
+    void Emit() const {
+        std::cout << text_ << "}" << std::endl;
+    }
+
+private:
+    static std::string Quote(const std::string& text) {
+        return "\"" + Rise::JsonEscape(text) + "\"";
+    }
+
+    std::string text_;
+};
+
+struct Summary {
+    double min = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+};
+
+Summary Summarize(std::vector<double> values) {
+    Summary summary;
+    if (values.empty()) return summary;
+
+    std::sort(values.begin(), values.end());
+    auto at = [&values](double p) {
+        return values[static_cast<size_t>(p * (values.size() - 1) + 0.5)];
+    };
+
+    double total = 0.0;
+    for (double value : values) total += value;
+    summary.mean = total / values.size();
+
+    double squares = 0.0;
+    for (double value : values) squares += (value - summary.mean) * (value - summary.mean);
+    summary.stddev = std::sqrt(squares / values.size());
+
+    summary.min = values.front();
+    summary.p50 = at(0.50);
+    summary.p95 = at(0.95);
+    summary.p99 = at(0.99);
+    summary.max = values.back();
+    return summary;
+}
+
+double ElapsedMs(Clock::time_point start, Clock::time_point end = Clock::now()) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// ============================================================================
+// Test Audio
+// ============================================================================
+
+struct TestAudio {
+    std::string source;
+    int sampleRate = AudioUtils::DEFAULT_SAMPLE_RATE;
+    std::vector<int16_t> pcm;       // the same clip as 16-bit PCM and as float
+    std::vector<float> samples;
+
+    double Seconds() const { return static_cast<double>(samples.size()) / sampleRate; }
+};
+
+// Mono tone bursts from SimulatedAudioCapture
+std::vector<int16_t> SimulateAudio(int sampleRate, int seconds) {
+    AudioUtils::SimulatedAudioCapture capture;
+    capture.Initialize(AudioUtils::AudioFormat(sampleRate, 1, 16));
+    capture.SetBursts(1500, 1000);
+    capture.Start();
+
+    std::vector<int16_t> pcm;
+    pcm.reserve(static_cast<size_t>(sampleRate) * seconds);
+    for (int i = 0; i < seconds; i++) {
+        AudioUtils::AudioChunk chunk = capture.GetNextChunk(1000);
+        pcm.insert(pcm.end(), chunk.samples.begin(), chunk.samples.end());
+    }
+    capture.Stop();
+    return pcm;
+}
+
+bool LoadTestAudio(const BenchOptions& options, TestAudio& audio, std::string& error) {
+    if (options.wavPath.empty()) {
+        audio.source = "simulated";
+        audio.pcm = SimulateAudio(audio.sampleRate, options.seconds);
+        audio.samples.resize(audio.pcm.size());
+        AudioUtils::Pcm16ToFloat(audio.pcm.data(), audio.pcm.size(), audio.samples.data());
+        return true;
+    }
+
+    // Decoded up front so file I/O is not part of any measurement
+    AudioUtils::WavStream wav;
+    if (!wav.Open(options.wavPath, AudioUtils::DEFAULT_SAMPLE_RATE, &error)) {
+        return false;
+    }
+    audio.source = options.wavPath;
+    audio.sampleRate = wav.SampleRate();
+
+    std::vector<float> block(WavReader::BLOCK_FRAMES);
+    while (size_t count = wav.Read(block.data(), block.size())) {
+        audio.samples.insert(audio.samples.end(), block.begin(), block.begin() + count);
+    }
+    if (audio.samples.empty()) {
+        error = "WAV file has no audio";
+        return false;
+    }
+
+    audio.pcm.resize(audio.samples.size());
+    for (size_t i = 0; i < audio.samples.size(); i++) {
+        audio.pcm[i] = AudioUtils::FloatToPcm16(audio.samples[i]);
+    }
+    return true;
+}
+
+// ============================================================================
+// Throughput Benchmarks
+// ============================================================================
+
+/**
+ * Run `pass` once to warm up, then `iterations` timed times. Emits the
+ * samples processed per second of the best pass and how many times faster
+ * than real time that is, for audio at `sampleRate`.
+ */
+template <typename Pass>
+ResultLine TimePasses(const char* bench, const char* variant, int iterations,
+                      size_t samples, int sampleRate, Pass&& pass) {
+    pass();
+
+    std::vector<double> passMs;
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        pass();
+        passMs.push_back(ElapsedMs(start));
+    }
+    Summary summary = Summarize(passMs);
+    double best = std::max(summary.min, 1e-6);
+
+    ResultLine line(bench);
+    line.Text("variant", variant)
+        .Count("samples", samples)
+        .Number("best_ms", summary.min)
+        .Number("mean_ms", summary.mean)
+        .Number("msamples_per_s", samples / best / 1000.0)
+        .Number("x_realtime", (static_cast<double>(samples) / sampleRate) / (best / 1000.0));
+    return line;
+}
+
+// Stops the compiler from dropping work whose result is never read
+static volatile size_t g_sink = 0;
+
+void BenchConversion(const TestAudio& audio, const BenchOptions& options) {
+    std::vector<float> out(audio.pcm.size());
+    TimePasses("pcm16_to_float", "scalar", options.iterations, audio.pcm.size(), audio.sampleRate, [&]() {
+        AudioUtils::Pcm16ToFloat(audio.pcm.data(), audio.pcm.size(), out.data());
+        g_sink = g_sink + static_cast<size_t>(out.back());
+    }).Emit();
+}
+
+void BenchBase64(const TestAudio& audio, const BenchOptions& options) {
+    // Encoded chunk by chunk, the way AsrSession does
+    const size_t floatChunk = Rise::AsrSession::ChunkSamplesFor(Rise::ChunkEncoding::Float32);
+    const size_t pcm16Chunk = Rise::AsrSession::ChunkSamplesFor(Rise::ChunkEncoding::Pcm16);
+    const size_t count = audio.samples.size();
+    std::vector<char> out(Base64::EncodedLength(std::max(floatChunk * sizeof(float), pcm16Chunk * sizeof(int16_t))));
+
+    for (int level = 0; level <= static_cast<int>(Base64::ActiveIsa()); level++) {
+        Base64::Isa isa = static_cast<Base64::Isa>(level);
+
+        TimePasses("base64_float32", Base64::IsaName(isa), options.iterations, count, audio.sampleRate, [&]() {
+            for (size_t offset = 0; offset < count; offset += floatChunk) {
+                size_t n = std::min(floatChunk, count - offset);
+                g_sink = g_sink + Base64::EncodeWith(isa, reinterpret_cast<const uint8_t*>(&audio.samples[offset]),
+                                                     n * sizeof(float), out.data());
+            }
+        }).Emit();
+
+        TimePasses("base64_pcm16_as_float", Base64::IsaName(isa), options.iterations, count, audio.sampleRate, [&]() {
+            for (size_t offset = 0; offset < count; offset += floatChunk) {
+                size_t n = std::min(floatChunk, count - offset);
+                g_sink = g_sink + Base64::EncodePcm16AsFloatWith(isa, &audio.pcm[offset], n, out.data());
+            }
+        }).Emit();
+
+        TimePasses("base64_float_as_pcm16", Base64::IsaName(isa), options.iterations, count, audio.sampleRate, [&]() {
+            for (size_t offset = 0; offset < count; offset += pcm16Chunk) {
+                size_t n = std::min(pcm16Chunk, count - offset);
+                g_sink = g_sink + Base64::EncodeFloatAsPcm16With(isa, &audio.samples[offset], n, out.data());
+            }
+        }).Emit();
+    }
+}
+
+void BenchFormatChunk(const TestAudio& audio, const BenchOptions& options) {
+    const size_t count = audio.samples.size();
+    NV_REQUEST_RISE_SETTINGS_V1 request = {};
+
+    for (Rise::ChunkEncoding encoding : { Rise::ChunkEncoding::Float32, Rise::ChunkEncoding::Pcm16 }) {
+        const size_t chunkSamples = Rise::AsrSession::ChunkSamplesFor(encoding);
+        uint64_t chunks = (count + chunkSamples - 1) / chunkSamples;
+
+        ResultLine line = TimePasses("format_chunk", Rise::ChunkEncodingName(encoding), options.iterations,
+                                     count, audio.sampleRate, [&]() {
+            int chunkId = 0;
+            for (size_t offset = 0; offset < count; offset += chunkSamples) {
+                size_t n = std::min(chunkSamples, count - offset);
+                g_sink = g_sink + Rise::FormatChunk(encoding, chunkId++, audio.sampleRate,
+                                                    &audio.samples[offset], n, request.content);
+            }
+        });
+        line.Count("chunks", chunks).Emit();
+    }
+}
+
+void BenchResample(const BenchOptions& options) {
+    for (int inputRate : { 48000, 44100 }) {
+        std::vector<int16_t> pcm = SimulateAudio(inputRate, options.seconds);
+        std::vector<float> input(pcm.size());
+        AudioUtils::Pcm16ToFloat(pcm.data(), pcm.size(), input.data());
+
+        // Fed in 10 ms device periods, as from a capture callback
+        Resampler resampler;
+        resampler.Initialize(inputRate, AudioUtils::DEFAULT_SAMPLE_RATE);
+        const size_t period = static_cast<size_t>(inputRate / 100);
+        std::vector<float> out(resampler.MaxOutput(period) + resampler.MaxFlushOutput());
+
+        std::string variant = std::to_string(inputRate) + "->" + std::to_string(AudioUtils::DEFAULT_SAMPLE_RATE);
+        ResultLine line = TimePasses("resample", variant.c_str(), options.iterations, input.size(), inputRate, [&]() {
+            resampler.Reset();
+            for (size_t offset = 0; offset < input.size(); offset += period) {
+                g_sink = g_sink + resampler.Process(&input[offset], std::min(period, input.size() - offset), out.data());
+            }
+            g_sink = g_sink + resampler.Flush(out.data());
+        });
+        line.Count("taps", resampler.Taps()).Emit();
+    }
+}
+
+void BenchDownmix(const TestAudio& audio, const BenchOptions& options) {
+    const size_t frames = audio.samples.size();
+    std::vector<float> stereo(frames * 2);
+    for (size_t i = 0; i < frames; i++) {
+        stereo[2 * i] = audio.samples[i];
+        stereo[2 * i + 1] = -audio.samples[i] * 0.5f;
+    }
+
+    std::vector<float> mono(frames);
+    TimePasses("downmix", "stereo", options.iterations, frames, audio.sampleRate, [&]() {
+        AudioUtils::DownmixToMono(stereo.data(), frames, 2, mono.data());
+        g_sink = g_sink + static_cast<size_t>(mono.back());
+    }).Emit();
+}
+
+void BenchVoiceGate(const TestAudio& audio, const BenchOptions& options) {
+    const size_t chunkSamples = Rise::AsrSession::SAMPLES_PER_CHUNK;
+    const size_t count = audio.samples.size() / chunkSamples * chunkSamples;
+    VoiceGate gate(chunkSamples);
+
+    auto send = [](const float* samples, size_t n) {
+        g_sink = g_sink + n + static_cast<size_t>(samples[0]);
+        return true;
+    };
+    ResultLine line = TimePasses("voice_gate", "rms", options.iterations, count, audio.sampleRate, [&]() {
+        gate.Reset();
+        for (size_t offset = 0; offset < count; offset += chunkSamples) {
+            gate.Process(&audio.samples[offset], chunkSamples, send);
+        }
+    });
+
+    VoiceGate::Stats stats = gate.GetStats();
+    line.Count("chunks_sent", stats.chunksSent)
+        .Count("chunks_skipped", stats.chunksSkipped)
+        .Count("activations", stats.activations)
+        .Emit();
+}
+
+/**
+ * A producer thread writes 10 ms periods into an AudioRingBuffer as fast as
+ * the ring has room; the consumer waits for and reads full chunks the way
+ * MicSender does. Measures the handoff itself, without pacing.
+ */
+void BenchRingHandoff(const TestAudio& audio, const BenchOptions& options) {
+    const size_t chunkSamples = Rise::AsrSession::SAMPLES_PER_CHUNK;
+    const size_t period = static_cast<size_t>(audio.sampleRate / 100);
+    const size_t total = audio.samples.size();
+    AudioRingBuffer ring(static_cast<size_t>(audio.sampleRate) * 4);
+    std::vector<float> chunk(chunkSamples);
+    uint64_t waits = 0;
+
+    ResultLine line = TimePasses("ring_handoff", "event", options.iterations, total, audio.sampleRate, [&]() {
+        ring.Reset();
+        std::thread producer([&]() {
+            for (size_t offset = 0; offset < total; offset += period) {
+                size_t n = std::min(period, total - offset);
+                while (ring.Capacity() - ring.Available() < n) {
+                    std::this_thread::yield();
+                }
+                ring.Write(&audio.samples[offset], n);
+            }
+        });
+
+        size_t consumed = 0;
+        while (consumed < total) {
+            size_t need = std::min(chunkSamples, total - consumed);
+            if (!ring.WaitForSamples(need, MicSender::CHUNK_WAIT_TIMEOUT)) {
+                waits++;
+                continue;
+            }
+            consumed += ring.Read(chunk.data(), need);
+        }
+        producer.join();
+    });
+
+    AudioRingBuffer::Stats stats = ring.GetStats();
+    line.Count("dropped", stats.dropped)
+        .Count("high_water", stats.highWater)
+        .Count("wait_timeouts", waits)
+        .Emit();
+}
+
+void RunThroughput(const TestAudio& audio, const BenchOptions& options) {
+    BenchConversion(audio, options);
+    BenchBase64(audio, options);
+    BenchFormatChunk(audio, options);
+    std::cerr << "resampling..." << std::endl;
+    BenchResample(options);
+    BenchDownmix(audio, options);
+    BenchVoiceGate(audio, options);
+    std::cerr << "ring handoff..." << std::endl;
+    BenchRingHandoff(audio, options);
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+int RunReplay(const TestAudio& audio, const BenchOptions& options) {
+    std::unique_ptr<Rise::RiseClient> client;
+    std::shared_ptr<Rise::AsrSession> session;
+    if (options.engine) {
+        client.reset(new Rise::RiseClient());
+        if (client->Connect() != NVAPI_OK || !client->WaitUntilReady()) {
+            std::cerr << "ERROR: Failed to initialize RISE" << std::endl;
+            return 1;
+        }
+        session = client->StartAsr(audio.sampleRate, ChunkWindow::DEFAULT_CAPACITY, nullptr, options.encoding);
+    }
+
+    const size_t chunkSamples = Rise::AsrSession::ChunkSamplesFor(options.encoding);
+    const size_t period = std::max<size_t>(1, static_cast<size_t>(audio.sampleRate) * options.periodMs / 1000);
+    const size_t total = audio.samples.size();
+    const auto periodTime = std::chrono::duration<double>(options.periodMs / 1000.0 / options.speed);
+
+    // Same ring size as the microphone demo
+    AudioRingBuffer ring(static_cast<size_t>(audio.sampleRate) * 4);
+    MicSender sender(ring, chunkSamples, options.voiceGate);
+
+    // writeTimes[k] is set before period k is published by the ring, so the
+    // sender can read it for any sample it has read
+    std::vector<Clock::time_point> writeTimes((total + period - 1) / period);
+    std::atomic<bool> stopRequested(false);
+    std::atomic<bool> senderDone(false);
+
+    std::cerr << "replaying " << audio.Seconds() << " s at " << options.speed << "x..." << std::endl;
+    auto replayStart = Clock::now();
+
+    // Stands in for the miniaudio callback
+    std::thread capture([&]() {
+        for (size_t k = 0; k < writeTimes.size(); k++) {
+            std::this_thread::sleep_until(replayStart + std::chrono::duration_cast<Clock::duration>(periodTime * k));
+            size_t offset = k * period;
+            writeTimes[k] = Clock::now();
+            ring.Write(&audio.samples[offset], std::min(period, total - offset));
+        }
+
+        // Let the sender drain every full chunk, then stop it
+        while (!senderDone.load(std::memory_order_acquire) && ring.Available() >= chunkSamples) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        stopRequested.store(true, std::memory_order_release);
+        ring.Wake();
+    });
+
+    NV_REQUEST_RISE_SETTINGS_V1 request = {};
+    int chunkId = 0;
+    bool latencyValid = true;
+    std::vector<double> latencies;
+    latencies.reserve(total / chunkSamples + 1);
+
+    auto send = [&](const float* samples, size_t count) {
+        bool ok = session
+            ? session->SendAudio(samples, count)
+            : Rise::FormatChunk(options.encoding, chunkId, audio.sampleRate, samples, count, request.content) != 0;
+        chunkId++;
+
+        // Dropped samples shift the read position away from the capture
+        // timeline, so latencies after a drop would be wrong
+        if (latencyValid && ring.GetStats().dropped > 0) {
+            latencyValid = false;
+        }
+        if (latencyValid) {
+            size_t newest = static_cast<size_t>(sender.SamplesRead() - 1) / period;
+            latencies.push_back(ElapsedMs(writeTimes[newest]));
+        }
+        return ok;
+    };
+
+    bool ok = sender.Run(stopRequested, send);
+    senderDone.store(true, std::memory_order_release);
+    capture.join();
+    double wallSeconds = ElapsedMs(replayStart) / 1000.0;
+
+    if (!ok) {
+        std::cerr << "ERROR: " << (session ? session->Error() : std::string("chunk payload too large")) << std::endl;
+    }
+
+    bool finalReceived = false;
+    if (session && ok) {
+        finalReceived = session->Finish(std::chrono::seconds(15));
+        if (!finalReceived) {
+            std::cerr << "ERROR: " << session->Error() << std::endl;
+        }
+    }
+
+    Summary latency = Summarize(latencies);
+    AudioRingBuffer::Stats ringStats = ring.GetStats();
+    VoiceGate::Stats gateStats = sender.Gate().GetStats();
+
+    ResultLine line("replay");
+    line.Text("source", audio.source)
+        .Text("sink", session ? "engine" : "format")
+        .Text("encoding", Rise::ChunkEncodingName(options.encoding))
+        .Flag("vad", options.voiceGate)
+        .Number("speed", options.speed)
+        .Count("period_ms", static_cast<uint64_t>(options.periodMs))
+        .Count("chunk_samples", chunkSamples)
+        .Number("audio_s", audio.Seconds())
+        .Number("wall_s", wallSeconds)
+        .Count("chunks_read", sender.ChunksRead())
+        .Count("chunks_sent", static_cast<uint64_t>(chunkId))
+        .Count("chunks_skipped", options.voiceGate ? gateStats.chunksSkipped : 0)
+        .Count("empty_waits", sender.Waits())
+        .Count("dropped", ringStats.dropped)
+        .Count("high_water", ringStats.highWater)
+        .Flag("latency_valid", latencyValid)
+        .Number("latency_min_ms", latency.min)
+        .Number("latency_p50_ms", latency.p50)
+        .Number("latency_p95_ms", latency.p95)
+        .Number("latency_p99_ms", latency.p99)
+        .Number("latency_max_ms", latency.max)
+        .Number("latency_mean_ms", latency.mean)
+        .Number("jitter_ms", latency.stddev);
+    if (session) {
+        ChunkWindow::Stats chunkStats = session->ChunkStats();
+        line.Number("mean_ack_ms", chunkStats.meanAckMs)
+            .Number("max_ack_ms", chunkStats.maxAckMs)
+            .Flag("final", finalReceived);
+    }
+    line.Emit();
+
+    return ok && (!session || finalReceived) ? 0 : 1;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+void PrintUsage(const char* program) {
+    std::cerr << "Usage:" << std::endl;
+    std::cerr << "  " << program << " [--wav <file>] [--seconds N] [--iterations N]" << std::endl;
+    std::cerr << "  " << program << " --replay [--wav <file>] [--seconds N] [--speed X] [--period-ms N]" << std::endl;
+    std::cerr << "        [--chunk-format float32|int16] [--no-vad] [--engine]" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Without --wav, simulated tone bursts of --seconds (default 30) are used." << std::endl;
+    std::cerr << "Results are printed to stdout as one JSON object per line." << std::endl;
+}
+
+bool ParseArguments(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--replay") {
+            options.replay = true;
+        } else if (arg == "--no-vad") {
+            options.voiceGate = false;
+        } else if (arg == "--engine") {
+            options.engine = true;
+        } else if (arg == "--wav" && hasValue) {
+            options.wavPath = argv[++i];
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = std::atoi(argv[++i]);
+            if (options.seconds < 1) return false;
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = std::atoi(argv[++i]);
+            if (options.iterations < 1) return false;
+        } else if (arg == "--speed" && hasValue) {
+            options.speed = std::atof(argv[++i]);
+            if (!(options.speed > 0.0)) return false;
+        } else if (arg == "--period-ms" && hasValue) {
+            options.periodMs = std::atoi(argv[++i]);
+            if (options.periodMs < 1) return false;
+        } else if (arg == "--chunk-format" && hasValue) {
+            if (!Rise::ParseChunkEncoding(argv[++i], options.encoding)) return false;
+        } else {
+            return false;
+        }
+    }
+    return !options.engine || options.replay;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!ParseArguments(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    TestAudio audio;
+    std::string error;
+    if (!LoadTestAudio(options, audio, error)) {
+        std::cerr << "ERROR: Failed to load WAV file: " << error << std::endl;
+        return 1;
+    }
+
+    ResultLine("config")
+        .Text("source", audio.source)
+        .Count("sample_rate", static_cast<uint64_t>(audio.sampleRate))
+        .Number("audio_s", audio.Seconds())
+        .Text("isa", Base64::IsaName(Base64::ActiveIsa()))
+        .Count("iterations", static_cast<uint64_t>(options.iterations))
+        .Emit();
+
+    if (options.replay) {
+        return RunReplay(audio, options);
+    }
+
+    RunThroughput(audio, options);
+    return 0;
+}
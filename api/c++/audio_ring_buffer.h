@@ -0,0 +1,135 @@
+/*
+ * Audio Ring Buffer
+ *
+ * Hands captured samples from miniaudio's real-time callback to the thread
+ * that streams them to RISE. The audio thread never locks, allocates or
+ * waits: Write() copies into a fixed-capacity lock-free ring and signals an
+ * auto-reset event once a chunk's worth of samples is ready, so the reader
+ * sleeps until there is work instead of polling.
+ *
+ * If the reader falls behind and the ring fills up, the newest samples are
+ * dropped and counted; already buffered audio is never overwritten.
+ *
+ * Thread-safety: one writer (audio callback) and one reader. Reset() may
+ * only be called while the writer is idle.
+ */
+
+#pragma once
+
+#include <windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "spsc_queue.h"
+
+class AudioRingBuffer {
+public:
+    struct Stats {
+        uint64_t written = 0;      // samples accepted
+        uint64_t dropped = 0;      // samples lost because the ring was full
+        uint64_t overflows = 0;    // writes that lost samples
+        size_t highWater = 0;      // most samples buffered at once
+    };
+
+    explicit AudioRingBuffer(size_t capacity)
+        : ring_(capacity), event_(CreateEventA(nullptr, FALSE, FALSE, nullptr)) {}
+
+    ~AudioRingBuffer() {
+        if (event_) CloseHandle(event_);
+    }
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+    size_t Capacity() const { return ring_.Capacity(); }
+    size_t Available() const { return ring_.Size(); }
+
+    // ------------------------------------------------------------------------
+    // Audio thread
+    // ------------------------------------------------------------------------
+
+    void Write(const float* samples, size_t count) {
+        size_t written = ring_.Write(samples, count);
+        written_.fetch_add(written, std::memory_order_relaxed);
+        if (written < count) {
+            dropped_.fetch_add(count - written, std::memory_order_relaxed);
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        size_t available = ring_.Size();
+        if (available > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(available, std::memory_order_relaxed);
+        }
+        if (available >= wakeThreshold_.load(std::memory_order_relaxed)) {
+            SetEvent(event_);
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Reader
+    // ------------------------------------------------------------------------
+
+    /**
+     * Block until at least `count` samples are buffered. Returns false on
+     * timeout or when woken by Wake(), so the caller can check for stop.
+     */
+    bool WaitForSamples(size_t count, std::chrono::milliseconds timeout) {
+        wakeThreshold_.store(count, std::memory_order_relaxed);
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (ring_.Size() < count) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0) return false;
+
+            WaitForSingleObject(event_, static_cast<DWORD>(remaining));
+            if (wakeRequested_.exchange(false, std::memory_order_acq_rel)) {
+                return ring_.Size() >= count;
+            }
+        }
+        return true;
+    }
+
+    // Copy up to `count` of the oldest samples; returns the number read
+    size_t Read(float* out, size_t count) {
+        return ring_.Read(out, count);
+    }
+
+    // Interrupt WaitForSamples() from another thread
+    void Wake() {
+        wakeRequested_.store(true, std::memory_order_release);
+        SetEvent(event_);
+    }
+
+    // Discard buffered audio and statistics before a new capture
+    void Reset() {
+        ring_.Clear();
+        written_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+        overflows_.store(0, std::memory_order_relaxed);
+        highWater_.store(0, std::memory_order_relaxed);
+        wakeRequested_.store(false, std::memory_order_relaxed);
+        ResetEvent(event_);
+    }
+
+    Stats GetStats() const {
+        Stats stats;
+        stats.written = written_.load(std::memory_order_relaxed);
+        stats.dropped = dropped_.load(std::memory_order_relaxed);
+        stats.overflows = overflows_.load(std::memory_order_relaxed);
+        stats.highWater = highWater_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    SpscQueue<float> ring_;
+    HANDLE event_;
+    std::atomic<size_t> wakeThreshold_{ 1 };
+    std::atomic<bool> wakeRequested_{ false };
+    std::atomic<uint64_t> written_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint64_t> overflows_{ 0 };
+    std::atomic<size_t> highWater_{ 0 };
+};
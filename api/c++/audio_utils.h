@@ -17,7 +17,16 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fstream>
 #include <algorithm>
+#if defined(_M_X64) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+#include "base64.h"
+#include "resampler.h"
+#include "wav_reader.h"
 
 namespace AudioUtils {
 
@@ -66,7 +75,7 @@ struct AudioChunk {
     AudioFormat format;
     int chunkId;
     
-    AudioChunk(int id = 0) : chunkId(id), format() {}
+    AudioChunk(int id = 0) : format(), chunkId(id) {}
     
     size_t SizeInBytes() const {
         return samples.size() * sizeof(int16_t);
@@ -82,34 +91,12 @@ struct AudioChunk {
 // Base64 Encoding (for API transmission)
 // ============================================================================
 
-/**
- * Base64 encoding table
- */
-static const char base64_chars[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-    "abcdefghijklmnopqrstuvwxyz"
-    "0123456789+/";
-
 /**
  * Encode binary data to Base64 string
  * This is required for sending audio data over the RISE API
  */
 inline std::string Base64Encode(const uint8_t* data, size_t length) {
-    std::string result;
-    result.reserve(((length + 2) / 3) * 4);
-    
-    for (size_t i = 0; i < length; i += 3) {
-        uint32_t val = data[i] << 16;
-        if (i + 1 < length) val |= data[i + 1] << 8;
-        if (i + 2 < length) val |= data[i + 2];
-        
-        result += base64_chars[(val >> 18) & 0x3F];
-        result += base64_chars[(val >> 12) & 0x3F];
-        result += (i + 1 < length) ? base64_chars[(val >> 6) & 0x3F] : '=';
-        result += (i + 2 < length) ? base64_chars[val & 0x3F] : '=';
-    }
-    
-    return result;
+    return Base64::Encode(data, length);
 }
 
 /**
@@ -180,9 +167,59 @@ inline bool DetectVoiceActivity(const AudioChunk& chunk, int16_t threshold = 100
 }
 
 /**
- * Resample audio to target sample rate (simple linear interpolation)
- * NOTE: For production, use a proper resampling library (libsamplerate, etc.)
+ * RMS level of float samples (full scale 1.0)
+ */
+inline float CalculateRms(const float* samples, size_t count) {
+    if (count == 0) return 0.0f;
+
+    float sumSquares = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        sumSquares += samples[i] * samples[i];
+    }
+    return std::sqrt(sumSquares / count);
+}
+
+/**
+ * Convert a float sample (-1.0 to +1.0) to 16-bit PCM, clamping overshoot
+ */
+inline int16_t FloatToPcm16(float sample) {
+    float scaled = std::round(sample * 32768.0f);
+    return static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, scaled)));
+}
+
+/**
+ * Convert 16-bit PCM to float (sample / 32768), the format AsrSession sends
+ */
+inline void Pcm16ToFloat(const int16_t* in, size_t count, float* out) {
+    constexpr float SCALE = 1.0f / 32768.0f;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<float>(in[i]) * SCALE;
+    }
+}
+
+/**
+ * Resample a whole buffer with the polyphase filter in resampler.h.
+ * For streams (microphone, long files) keep a Resampler and feed it chunk by
+ * chunk instead; it carries the filter state across calls.
  */
+inline std::vector<float> ResampleAudio(
+    const float* input,
+    size_t count,
+    int inputRate,
+    int outputRate)
+{
+    if (inputRate == outputRate) return std::vector<float>(input, input + count);
+
+    Resampler resampler;
+    if (!resampler.Initialize(inputRate, outputRate)) return {};
+
+    std::vector<float> output(resampler.MaxOutput(count) + resampler.MaxFlushOutput());
+    size_t written = resampler.Process(input, count, output.data());
+    written += resampler.Flush(output.data() + written);
+    output.resize(written);
+    return output;
+}
+
 inline std::vector<int16_t> ResampleAudio(
     const std::vector<int16_t>& input,
     int inputRate,
@@ -190,37 +227,72 @@ inline std::vector<int16_t> ResampleAudio(
 {
     if (inputRate == outputRate) return input;
     if (input.empty()) return {};
-    
-    size_t outputSize = (input.size() * outputRate) / inputRate;
-    std::vector<int16_t> output(outputSize);
-    
-    float ratio = static_cast<float>(inputRate) / outputRate;
-    for (size_t i = 0; i < outputSize; i++) {
-        float srcIdx = i * ratio;
-        size_t idx0 = static_cast<size_t>(srcIdx);
-        size_t idx1 = std::min(idx0 + 1, input.size() - 1);
-        float frac = srcIdx - idx0;
-        
-        output[i] = static_cast<int16_t>(
-            input[idx0] * (1.0f - frac) + input[idx1] * frac
-        );
+
+    std::vector<float> samples(input.size());
+    Pcm16ToFloat(input.data(), input.size(), samples.data());
+
+    std::vector<float> resampled = ResampleAudio(samples.data(), samples.size(), inputRate, outputRate);
+    std::vector<int16_t> output(resampled.size());
+    for (size_t i = 0; i < resampled.size(); i++) {
+        output[i] = FloatToPcm16(resampled[i]);
     }
-    
     return output;
 }
 
+/**
+ * Average interleaved frames of `channels` channels into one channel.
+ * `out` receives `frames` samples and may be the same buffer as `in`.
+ */
+inline void DownmixToMono(const float* in, size_t frames, int channels, float* out) {
+    if (channels <= 1) {
+        if (out != in) std::copy(in, in + frames, out);
+        return;
+    }
+
+    size_t i = 0;
+#if defined(_M_X64) || defined(__x86_64__)
+    if (channels == 2) {
+        // Four stereo frames per step: split left/right, add, halve
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(in + 2 * i);
+            __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+            __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+        }
+    }
+#endif
+
+    const float scale = 1.0f / channels;
+    for (; i < frames; i++) {
+        const float* frame = in + i * channels;
+        float sum = 0.0f;
+        for (int c = 0; c < channels; c++) sum += frame[c];
+        out[i] = sum * scale;
+    }
+}
+
+inline void DownmixToMono(const int16_t* in, size_t frames, int channels, int16_t* out) {
+    if (channels <= 1) {
+        if (out != in) std::copy(in, in + frames, out);
+        return;
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        const int16_t* frame = in + i * channels;
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) sum += frame[c];
+        out[i] = static_cast<int16_t>(sum / channels);
+    }
+}
+
 /**
  * Convert stereo to mono by averaging channels
  */
 inline std::vector<int16_t> StereoToMono(const std::vector<int16_t>& stereo) {
-    std::vector<int16_t> mono;
-    mono.reserve(stereo.size() / 2);
-    
-    for (size_t i = 0; i + 1 < stereo.size(); i += 2) {
-        int32_t avg = (static_cast<int32_t>(stereo[i]) + stereo[i + 1]) / 2;
-        mono.push_back(static_cast<int16_t>(avg));
-    }
-    
+    std::vector<int16_t> mono(stereo.size() / 2);
+    DownmixToMono(stereo.data(), mono.size(), 2, mono.data());
     return mono;
 }
 
@@ -245,7 +317,8 @@ public:
 
 /**
  * Simulated audio capture (for testing)
- * Generates sine wave audio data
+ * Generates sine wave audio data, optionally in bursts separated by silence
+ * so voice activity gating has something to gate
  */
 class SimulatedAudioCapture : public IAudioCapture {
 private:
@@ -253,19 +326,32 @@ private:
     bool capturing_;
     int chunkCounter_;
     double phase_;
+    int burstMs_;
+    int pauseMs_;
+    int64_t position_;  // frames generated since Start()
     
 public:
     SimulatedAudioCapture() 
-        : capturing_(false), chunkCounter_(0), phase_(0.0) {}
+        : capturing_(false), chunkCounter_(0), phase_(0.0), burstMs_(0), pauseMs_(0), position_(0) {}
     
     bool Initialize(const AudioFormat& format) override {
         format_ = format;
         return true;
     }
+
+    /**
+     * Alternate `burstMs` of tone with `pauseMs` of silence, starting with
+     * tone. A pause of 0 (the default) generates a continuous tone.
+     */
+    void SetBursts(int burstMs, int pauseMs) {
+        burstMs_ = std::max(burstMs, 0);
+        pauseMs_ = std::max(pauseMs, 0);
+    }
     
     bool Start() override {
         capturing_ = true;
         chunkCounter_ = 0;
+        position_ = 0;
         return true;
     }
     
@@ -290,8 +376,13 @@ public:
         double frequency = 440.0;
         double increment = (2.0 * 3.14159265358979323846 * frequency) / format_.sampleRate;
         
+        const int64_t burstFrames = static_cast<int64_t>(format_.sampleRate) * burstMs_ / 1000;
+        const int64_t cycleFrames = burstFrames + static_cast<int64_t>(format_.sampleRate) * pauseMs_ / 1000;
+        
         for (int i = 0; i < numSamples; i++) {
-            int16_t sample = static_cast<int16_t>(
+            int64_t frame = position_++;
+            bool silent = cycleFrames > burstFrames && frame % cycleFrames >= burstFrames;
+            int16_t sample = silent ? 0 : static_cast<int16_t>(
                 std::sin(phase_) * 10000.0  // Amplitude
             );
             chunk.samples.push_back(sample);
@@ -312,39 +403,129 @@ public:
 // ============================================================================
 
 /**
- * Simple WAV file header structure
+ * Load a whole WAV file as interleaved 16-bit samples. Accepts everything
+ * WavReader does (24-bit, float, extra RIFF chunks); other depths are
+ * converted to 16-bit. On failure, `error` (if given) receives the reason.
+ *
+ * For long recordings prefer streaming with WavReader directly, which keeps
+ * memory use constant.
  */
-#pragma pack(push, 1)
-struct WavHeader {
-    char riff[4];           // "RIFF"
-    uint32_t fileSize;      // File size - 8
-    char wave[4];           // "WAVE"
-    char fmt[4];            // "fmt "
-    uint32_t fmtSize;       // 16 for PCM
-    uint16_t audioFormat;   // 1 for PCM
-    uint16_t channels;
-    uint32_t sampleRate;
-    uint32_t byteRate;
-    uint16_t blockAlign;
-    uint16_t bitsPerSample;
-    char data[4];           // "data"
-    uint32_t dataSize;      // Size of audio data
-};
-#pragma pack(pop)
+inline bool LoadWavFile(const std::string& filename, std::vector<int16_t>& samples,
+                        int& sampleRate, int& channels, std::string* error = nullptr) {
+    WavReader reader;
+    if (!reader.Open(filename, error)) {
+        return false;
+    }
+
+    sampleRate = reader.SampleRate();
+    channels = reader.Channels();
+
+    samples.clear();
+    samples.reserve(static_cast<size_t>(reader.TotalFrames()) * channels);
+
+    std::vector<float> block(WavReader::BLOCK_FRAMES * channels);
+    size_t frames;
+    while ((frames = reader.Read(block.data(), WavReader::BLOCK_FRAMES)) > 0) {
+        for (size_t i = 0; i < frames * channels; i++) {
+            samples.push_back(FloatToPcm16(block[i]));
+        }
+    }
+
+    return true;
+}
 
 /**
- * Load PCM data from a WAV file
- * NOTE: Simplified implementation, assumes 16-bit PCM WAV
+ * Load PCM data from a WAV file into an AudioChunk
  */
 inline bool LoadWavFile(const std::string& filename, AudioChunk& chunk) {
-    // In production, use a proper WAV library
-    // This is a simplified example
-    
-    // TODO: Implement actual file reading
-    // For now, return false to indicate not implemented
-    return false;
+    int sampleRate = 0;
+    int channels = 0;
+    if (!LoadWavFile(filename, chunk.samples, sampleRate, channels)) {
+        return false;
+    }
+    chunk.format = AudioFormat(sampleRate, channels, 16);
+    return true;
 }
 
+/**
+ * Streams a WAV file as mono float audio at no more than `maxRate`: the
+ * reader downmixes, and sources above maxRate are resampled on the fly.
+ * Read() always fills the request until the file ends, so callers can hand
+ * out fixed-size ASR chunks. Memory use is constant.
+ */
+class WavStream {
+public:
+    bool Open(const std::string& filename, int maxRate, std::string* error = nullptr) {
+        if (!reader_.Open(filename, error)) {
+            return false;
+        }
+
+        // Keep the source rate if it is already low enough, or if the ratio
+        // is too awkward for the resampler (the engine resamples anyway)
+        int sourceRate = reader_.SampleRate();
+        if (sourceRate <= maxRate || !resampler_.Initialize(sourceRate, maxRate)) {
+            resampler_.Initialize(sourceRate, sourceRate);
+        }
+
+        input_.resize(WavReader::BLOCK_FRAMES);
+        output_.resize(resampler_.MaxOutput(input_.size()) + resampler_.MaxFlushOutput());
+        outputStart_ = 0;
+        outputCount_ = 0;
+        flushed_ = false;
+        return true;
+    }
+
+    const WavReader& Source() const { return reader_; }
+
+    // Rate of the samples Read() returns
+    int SampleRate() const { return resampler_.OutputRate(); }
+    bool IsResampling() const { return !resampler_.IsPassthrough(); }
+
+    // Samples Read() returns in total; 0 if the file did not say
+    uint64_t TotalSamples() const {
+        uint64_t frames = reader_.TotalFrames();
+        return (frames * resampler_.OutputRate() + resampler_.InputRate() - 1) / resampler_.InputRate();
+    }
+
+    // Returns `count` samples, fewer only at the end of the file
+    size_t Read(float* out, size_t count) {
+        size_t written = 0;
+        while (written < count) {
+            if (outputCount_ == 0 && !Refill()) break;
+
+            size_t n = std::min(count - written, outputCount_);
+            std::copy(output_.begin() + outputStart_, output_.begin() + outputStart_ + n, out + written);
+            outputStart_ += n;
+            outputCount_ -= n;
+            written += n;
+        }
+        return written;
+    }
+
+private:
+    bool Refill() {
+        if (flushed_) return false;
+
+        size_t frames = reader_.ReadMono(input_.data(), input_.size());
+        if (frames > 0) {
+            outputCount_ = resampler_.Process(input_.data(), frames, output_.data());
+        } else {
+            outputCount_ = resampler_.Flush(output_.data());
+            flushed_ = true;
+        }
+        outputStart_ = 0;
+        return outputCount_ > 0 || !flushed_;
+    }
+
+    WavReader reader_;
+    Resampler resampler_;
+    std::vector<float> input_;      // one block of mono source samples
+    std::vector<float> output_;     // the same block after resampling
+    size_t outputStart_ = 0;
+    size_t outputCount_ = 0;
+    bool flushed_ = false;
+};
+
 /**
  * Save audio chunk to WAV file (for debugging)
  */
@@ -0,0 +1,296 @@
+/*
+ * Base64 Encoder
+ *
+ * Standard base64 (RFC 4648, with padding) for the audio chunks sent to
+ * RISE. The encoder is picked once per process from what the CPU supports:
+ * AVX2 (24 bytes per step), SSSE3 (12 bytes per step) or a scalar table
+ * lookup. All three produce identical output.
+ *
+ * EncodePcm16AsFloat() converts 16-bit PCM to float32 (-1.0 to +1.0) and
+ * encodes it in one pass through a small stack buffer, so a chunk can go
+ * straight into a request buffer without an intermediate float vector or
+ * string. EncodeFloatAsPcm16() goes the other way for the compact int16
+ * chunk format.
+ *
+ * Output is not NUL-terminated; callers size the buffer with EncodedLength().
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BASE64_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic; GCC and Clang need the target per function
+#if defined(BASE64_X86) && !defined(_MSC_VER)
+#define BASE64_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define BASE64_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BASE64_TARGET_SSSE3
+#define BASE64_TARGET_AVX2
+#endif
+
+namespace Base64 {
+
+enum class Isa { Scalar, Ssse3, Avx2 };
+
+inline const char* IsaName(Isa isa) {
+    switch (isa) {
+        case Isa::Avx2: return "AVX2";
+        case Isa::Ssse3: return "SSSE3";
+        default: return "scalar";
+    }
+}
+
+constexpr size_t EncodedLength(size_t length) {
+    return ((length + 2) / 3) * 4;
+}
+
+constexpr char ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+// ============================================================================
+// Scalar
+// ============================================================================
+
+inline size_t EncodeScalar(const uint8_t* data, size_t length, char* out) {
+    char* start = out;
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t value = (static_cast<uint32_t>(data[i]) << 16) |
+                         (static_cast<uint32_t>(data[i + 1]) << 8) |
+                         static_cast<uint32_t>(data[i + 2]);
+        *out++ = ALPHABET[(value >> 18) & 0x3F];
+        *out++ = ALPHABET[(value >> 12) & 0x3F];
+        *out++ = ALPHABET[(value >> 6) & 0x3F];
+        *out++ = ALPHABET[value & 0x3F];
+    }
+
+    size_t remaining = length - i;
+    if (remaining > 0) {
+        uint32_t value = static_cast<uint32_t>(data[i]) << 16;
+        if (remaining == 2) value |= static_cast<uint32_t>(data[i + 1]) << 8;
+        *out++ = ALPHABET[(value >> 18) & 0x3F];
+        *out++ = ALPHABET[(value >> 12) & 0x3F];
+        *out++ = remaining == 2 ? ALPHABET[(value >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+    return static_cast<size_t>(out - start);
+}
+
+#ifdef BASE64_X86
+
+// ============================================================================
+// SSSE3 / AVX2
+// ============================================================================
+//
+// Each step spreads 3 input bytes over 4 bytes, isolates the four 6-bit
+// indices with two multiplies, and maps indices to ASCII by adding a
+// per-range offset picked with a byte shuffle:
+//   0..25 -> 'A'   26..51 -> 'a' - 26   52..61 -> '0' - 52   62 -> '+'   63 -> '/'
+
+BASE64_TARGET_SSSE3
+inline __m128i EncodeStep128(__m128i input) {
+    // Bytes [b1 b0 b2 b1] for every 3-byte group
+    input = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    __m128i high = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+    __m128i low = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(high, low);
+
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+
+BASE64_TARGET_SSSE3
+inline size_t EncodeSsse3(const uint8_t* data, size_t length, char* out) {
+    char* start = out;
+    // Each step reads 16 bytes and uses 12
+    while (length >= 16) {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), EncodeStep128(input));
+        data += 12;
+        length -= 12;
+        out += 16;
+    }
+    return static_cast<size_t>(out - start) + EncodeScalar(data, length, out);
+}
+
+BASE64_TARGET_AVX2
+inline size_t EncodeAvx2(const uint8_t* data, size_t length, char* out) {
+    char* start = out;
+    const __m256i spread = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                           10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                             '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                             '/' - 63, 'A', 0, 0);
+
+    // Each step reads bytes 0..15 and 12..27 into the two lanes and uses 24
+    while (length >= 28) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 12));
+        __m256i input = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        input = _mm256_shuffle_epi8(input, spread);
+
+        __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0FC0FC00)),
+                                          _mm256_set1_epi32(0x04000040));
+        __m256i low = _mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003F03F0)),
+                                         _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(high, low);
+
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+
+        __m256i encoded = _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), encoded);
+        data += 24;
+        length -= 24;
+        out += 32;
+    }
+    return static_cast<size_t>(out - start) + EncodeSsse3(data, length, out);
+}
+
+inline Isa DetectIsa() {
+#if defined(_MSC_VER)
+    int info[4] = { 0 };
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    bool ssse3 = __builtin_cpu_supports("ssse3");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return Isa::Avx2;
+    if (ssse3) return Isa::Ssse3;
+    return Isa::Scalar;
+}
+
+#else
+
+inline Isa DetectIsa() { return Isa::Scalar; }
+
+#endif // BASE64_X86
+
+// Best encoder for this CPU, detected on first use
+inline Isa ActiveIsa() {
+    static const Isa isa = DetectIsa();
+    return isa;
+}
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+// Encode with a specific implementation (it must be supported by the CPU)
+inline size_t EncodeWith(Isa isa, const uint8_t* data, size_t length, char* out) {
+#ifdef BASE64_X86
+    switch (isa) {
+        case Isa::Avx2: return EncodeAvx2(data, length, out);
+        case Isa::Ssse3: return EncodeSsse3(data, length, out);
+        default: break;
+    }
+#endif
+    (void)isa;
+    return EncodeScalar(data, length, out);
+}
+
+// Encode `length` bytes into `out`, which must hold EncodedLength(length)
+// chars; returns the number written
+inline size_t Encode(const uint8_t* data, size_t length, char* out) {
+    return EncodeWith(ActiveIsa(), data, length, out);
+}
+
+inline std::string Encode(const uint8_t* data, size_t length) {
+    std::string result(EncodedLength(length), '\0');
+    Encode(data, length, &result[0]);
+    return result;
+}
+
+/**
+ * Convert 16-bit PCM to float32 (sample / 32768) and base64-encode the float
+ * bytes in one pass. `out` must hold EncodedLength(count * sizeof(float))
+ * chars; returns the number written. The result is identical to converting
+ * the whole buffer first and encoding it afterwards.
+ */
+inline size_t EncodePcm16AsFloatWith(Isa isa, const int16_t* samples, size_t count, char* out) {
+    // 96 floats are 384 bytes, a multiple of 3 (and of the AVX2 step), so
+    // blocks encode without padding and concatenate to the encoding of the
+    // whole buffer
+    constexpr size_t BLOCK_SAMPLES = 96;
+    constexpr float SCALE = 1.0f / 32768.0f;
+    float block[BLOCK_SAMPLES];
+
+    char* start = out;
+    for (size_t offset = 0; offset < count; offset += BLOCK_SAMPLES) {
+        size_t n = std::min(BLOCK_SAMPLES, count - offset);
+        for (size_t i = 0; i < n; i++) {
+            block[i] = static_cast<float>(samples[offset + i]) * SCALE;
+        }
+        out += EncodeWith(isa, reinterpret_cast<const uint8_t*>(block), n * sizeof(float), out);
+    }
+    return static_cast<size_t>(out - start);
+}
+
+inline size_t EncodePcm16AsFloat(const int16_t* samples, size_t count, char* out) {
+    return EncodePcm16AsFloatWith(ActiveIsa(), samples, count, out);
+}
+
+/**
+ * The reverse: convert float32 (-1.0 to +1.0) to 16-bit PCM and encode the
+ * little-endian int16 bytes in one pass. Out-of-range samples are clamped.
+ * `out` must hold EncodedLength(count * sizeof(int16_t)) chars.
+ */
+inline size_t EncodeFloatAsPcm16With(Isa isa, const float* samples, size_t count, char* out) {
+    // 192 int16 samples are 384 bytes, for the same reason as above
+    constexpr size_t BLOCK_SAMPLES = 192;
+    int16_t block[BLOCK_SAMPLES];
+
+    char* start = out;
+    for (size_t offset = 0; offset < count; offset += BLOCK_SAMPLES) {
+        size_t n = std::min(BLOCK_SAMPLES, count - offset);
+        for (size_t i = 0; i < n; i++) {
+            float scaled = samples[offset + i] * 32768.0f;
+            scaled = std::max(-32768.0f, std::min(32767.0f, scaled));
+            block[i] = static_cast<int16_t>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+        }
+        out += EncodeWith(isa, reinterpret_cast<const uint8_t*>(block), n * sizeof(int16_t), out);
+    }
+    return static_cast<size_t>(out - start);
+}
+
+inline size_t EncodeFloatAsPcm16(const float* samples, size_t count, char* out) {
+    return EncodeFloatAsPcm16With(ActiveIsa(), samples, count, out);
+}
+
+} // namespace Base64
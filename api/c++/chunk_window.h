@@ -0,0 +1,127 @@
+/*
+ * ASR Chunk Window
+ *
+ * Bounded in-flight window for pipelined "CHUNK:<id>:..." submission.
+ * Instead of sending one chunk and waiting for its acknowledgment before the
+ * next, the sender keeps up to N chunks outstanding and only blocks when the
+ * window is full (backpressure).
+ *
+ * The engine acknowledges chunks in the order they were sent and the
+ * acknowledgment does not echo the chunk id, so each acknowledgment retires
+ * the oldest outstanding chunk. A window of 1 reproduces the old lockstep
+ * behaviour.
+ *
+ * Thread-safe: Acknowledge() is called from the RISE callback thread while
+ * the sender waits in WaitForSlot()/WaitForAll().
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+class ChunkWindow {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        int sent = 0;
+        int acknowledged = 0;
+        double elapsedSeconds = 0.0;
+        double chunksPerSecond = 0.0;
+        double meanAckMs = 0.0;       // send -> acknowledgment, per chunk
+        double maxAckMs = 0.0;
+    };
+
+    explicit ChunkWindow(size_t capacity = DEFAULT_CAPACITY)
+        : capacity_(std::max<size_t>(capacity, 1)) {}
+
+    static constexpr size_t DEFAULT_CAPACITY = 4;
+
+    size_t Capacity() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_;
+    }
+
+    // Start a new stream with the given window size: forget outstanding
+    // chunks and restart the clock
+    void Begin(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = std::max<size_t>(capacity, 1);
+        outstanding_.clear();
+        stats_ = Stats();
+        totalAckMs_ = 0.0;
+        start_ = Clock::now();
+    }
+
+    // Block until another chunk may be sent; false if the window stayed full
+    bool WaitForSlot(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return condition_.wait_for(lock, timeout, [this] { return outstanding_.size() < capacity_; });
+    }
+
+    void OnSent(int chunkId) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        outstanding_.push_back({ chunkId, Clock::now() });
+        stats_.sent++;
+    }
+
+    // Retire the oldest outstanding chunk; returns its id, or -1 if none
+    int Acknowledge() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (outstanding_.empty()) return -1;
+
+        Pending chunk = outstanding_.front();
+        outstanding_.pop_front();
+
+        double ackMs = std::chrono::duration<double, std::milli>(Clock::now() - chunk.sentAt).count();
+        totalAckMs_ += ackMs;
+        stats_.maxAckMs = std::max(stats_.maxAckMs, ackMs);
+        stats_.acknowledged++;
+
+        condition_.notify_all();
+        return chunk.id;
+    }
+
+    // Block until every sent chunk is acknowledged; false on timeout
+    bool WaitForAll(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return condition_.wait_for(lock, timeout, [this] { return outstanding_.empty(); });
+    }
+
+    bool HasOutstanding() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !outstanding_.empty();
+    }
+
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats result = stats_;
+        result.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start_).count();
+        if (result.elapsedSeconds > 0.0) {
+            result.chunksPerSecond = result.acknowledged / result.elapsedSeconds;
+        }
+        if (result.acknowledged > 0) {
+            result.meanAckMs = totalAckMs_ / result.acknowledged;
+        }
+        return result;
+    }
+
+private:
+    struct Pending {
+        int id;
+        Clock::time_point sentAt;
+    };
+
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<Pending> outstanding_;
+    Stats stats_;
+    double totalAckMs_ = 0.0;
+    Clock::time_point start_ = Clock::now();
+};
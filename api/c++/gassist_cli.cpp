@@ -6,485 +6,762 @@
  * 2. LLM (Large Language Model) prompt/response
  * 
  * Usage:
- *   gassist_cli.exe --asr <wav_file>
- *   gassist_cli.exe --llm "<prompt>"
+ *   gassist_cli.exe --asr <wav_file> [--window N] [--chunk-format F] [--trace DIR]
+ *   gassist_cli.exe --llm "<prompt>" [--stream | --ndjson] [--trace DIR]
+ *   gassist_cli.exe --batch <items.jsonl | -> [--window N] [--chunk-format F] [--trace DIR]
+ *   gassist_cli.exe --serve [pipe_name] [--window N] [--chunk-format F] [--trace DIR]
  * 
- * Output: Only the final text result is printed to stdout.
+ * Output by mode:
+ *   --asr, --llm  the final text result on stdout; ASR throughput
+ *                 statistics and chart data on stderr
+ *   --stream      LLM text on stdout as it arrives; time-to-first-token,
+ *                 tokens/s and total time on stderr
+ *   --ndjson      one JSON event per chunk on stdout, then a "done" event
+ *   --batch       one JSON result line per item on stdout
+ *   --serve       one JSON result frame per request on the pipe; server
+ *                 status on stderr
+ *   --trace DIR   adds a Chrome trace file per request (see below)
+ *
+ * Batch mode initializes RISE once and runs every item of a JSON Lines file
+ * (or stdin), one object per line:
+ *   {"id": "q1", "prompt": "What is my GPU?"}
+ *   {"id": "a1", "wav": "C:\\audio\\clip.wav"}
+ * and writes one JSON result line per item, in input order, to stdout:
+ *   {"id":"q1","type":"llm","ok":true,"result":"...","queue_ms":0.1,"ttft_ms":412.5,"total_ms":2310.2}
+ *
+ * Server mode keeps RISE initialized and takes the same request objects
+ * from local clients over a named pipe (default \\.\pipe\gassist_cli),
+ * framed like gassist::Protocol: 4-byte big-endian length, then JSON. Each
+ * request gets one result frame. {"command": "ping" | "status" | "shutdown"}
+ * controls the server.
+ *
+ * --trace DIR writes a Chrome trace of every request to DIR/<trace_id>.json
+ * (open in chrome://tracing or ui.perfetto.dev); result lines then carry
+ * the trace_id.
  */
 
 #define NOMINMAX
 
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
 #include <mutex>
 #include <thread>
-#include <condition_variable>
-#include <chrono>
 #include <vector>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
-#include <atomic>
-#include <fstream>
-#include <algorithm>
-#include <cmath>
-#include "nvapi.h"
+#include "pipe_server.h"
+#include "rise_client.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Outcome of one ASR or LLM request
+struct CommandResult {
+    bool ok = false;
+    std::string output;     // transcript or LLM response
+    std::string error;
+    std::string chart;      // GRAPH content, LLM only
+    Rise::RequestTimings timings;
+    ChunkWindow::Stats chunkStats;  // ASR only
+    double loadMs = 0.0;            // WAV read and decode time, ASR only
+    std::string traceId;            // with --trace
+};
 
-// ============================================================================
-// Synchronization
-// ============================================================================
+// How long a request may wait behind others (batch lookahead, other server
+// clients) before its own timeout starts
+static constexpr auto QUEUE_TIMEOUT = std::chrono::minutes(10);
 
-class Semaphore {
-private:
-    std::mutex mutex_;
-    std::condition_variable condition_;
-    unsigned long count_ = 0;
+static double MsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
 
-public:
-    void release() {
-        std::lock_guard<decltype(mutex_)> lock(mutex_);
-        ++count_;
-        condition_.notify_one();
-    }
+// Directory for request traces; empty unless --trace was given
+static std::string g_traceDir;
 
-    void acquire() {
-        std::unique_lock<decltype(mutex_)> lock(mutex_);
-        while (!count_) {
-            condition_.wait(lock);
-        }
-        --count_;
-    }
+// Write a finished request's Chrome trace to g_traceDir
+static void WriteTrace(const Rise::Request& request) {
+    std::string trace = request.ChromeTrace();
+    if (g_traceDir.empty() || trace.empty()) return;
 
-    bool try_acquire() {
-        std::lock_guard<decltype(mutex_)> lock(mutex_);
-        if (count_) {
-            --count_;
-            return true;
-        }
-        return false;
+    std::string path = g_traceDir + "/" + Rise::TraceFileName(request.TraceId());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.write(trace.data(), static_cast<std::streamsize>(trace.size()))) {
+        std::cerr << "WARNING: Could not write trace " << path << std::endl;
     }
-};
-
-// ============================================================================
-// Global State
-// ============================================================================
-
-static Semaphore g_responseSemaphore;
-static std::mutex g_responseMutex;
-static std::string g_finalResult;
-static std::string g_chartData;  // Store GRAPH content separately
-static bool g_systemReady = false;
-static bool g_responseCompleted = false;
-static std::atomic<bool> g_waitingForAsrFinal(false);
-
-// Per-content-type completion tracking (bitmask).
-// A type becomes "expected" when we first receive data for it and
-// "completed" when its callback reports completed==1.  The semaphore
-// is only released once every expected type has completed.
-static constexpr unsigned CT_TEXT                    = 1u << 0;
-static constexpr unsigned CT_CUSTOM_BEHAVIOR         = 1u << 1;
-static constexpr unsigned CT_CUSTOM_BEHAVIOR_RESULT  = 1u << 2;
-static constexpr unsigned CT_GRAPH                   = 1u << 3;
-
-static unsigned g_expectedTypes  = 0;
-static unsigned g_completedTypes = 0;
-
-static bool AllExpectedTypesComplete() {
-    return g_expectedTypes != 0 &&
-           (g_completedTypes & g_expectedTypes) == g_expectedTypes;
 }
 
 // ============================================================================
-// WAV File Handling
+// ASR Function
 // ============================================================================
 
-#pragma pack(push, 1)
-struct WavHeader {
-    char riff[4];
-    uint32_t fileSize;
-    char wave[4];
-    char fmt[4];
-    uint32_t fmtSize;
-    uint16_t audioFormat;
-    uint16_t channels;
-    uint32_t sampleRate;
-    uint32_t byteRate;
-    uint16_t blockAlign;
-    uint16_t bitsPerSample;
-    char data[4];
-    uint32_t dataSize;
+// How ASR audio is sent to the engine
+struct AsrOptions {
+    size_t windowSize = ChunkWindow::DEFAULT_CAPACITY;            // chunks in flight
+    Rise::ChunkEncoding encoding = Rise::ChunkEncoding::Float32;  // chunk payload format
 };
-#pragma pack(pop)
 
-bool LoadWavFile(const std::string& filename, std::vector<int16_t>& samples, int& sampleRate, int& channels) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        return false;
-    }
-
-    WavHeader header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(WavHeader));
+// An opened WAV file; samples are streamed from disk while they are sent
+struct WavAudio {
+    AudioUtils::WavStream stream;
+    std::string error;
+    double loadMs = 0.0;    // header parsing, then accumulated decode time
+};
 
-    if (std::strncmp(header.riff, "RIFF", 4) != 0 || std::strncmp(header.wave, "WAVE", 4) != 0) {
-        return false;
-    }
+bool OpenWav(const std::string& wavFilePath, WavAudio& audio) {
+    auto start = Clock::now();
+    // Sources above 16 kHz are resampled to the engine's rate, which cuts
+    // the payload and the number of chunks by the rate ratio
+    bool opened = audio.stream.Open(wavFilePath, AudioUtils::DEFAULT_SAMPLE_RATE, &audio.error);
+    audio.loadMs = MsSince(start);
+    return opened;
+}
 
-    if (header.audioFormat != 1 || header.bitsPerSample != 16) {
-        return false;
+CommandResult DoASR(Rise::RiseClient& client, WavAudio& audio, const AsrOptions& options) {
+    // Send audio chunks, keeping up to options.windowSize of them in flight, then
+    // STOP and wait for the final transcription
+    const auto TIMEOUT = std::chrono::milliseconds(15000);
+
+    CommandResult result;
+    auto session = client.StartAsr(audio.stream.SampleRate(), options.windowSize, nullptr, options.encoding);
+    session->WaitUntilStarted(QUEUE_TIMEOUT);
+
+    // Decode a few whole chunks at a time, downmixed to mono, so memory use
+    // does not depend on the length of the recording
+    const size_t SAMPLES_PER_READ = 8 * session->ChunkSamples();
+    std::vector<float> samples(SAMPLES_PER_READ);
+
+    bool sent = true;
+    while (sent) {
+        auto readStart = Clock::now();
+        size_t count = audio.stream.Read(samples.data(), SAMPLES_PER_READ);
+        audio.loadMs += MsSince(readStart);
+        if (count == 0) break;
+        sent = session->SendAudio(samples.data(), count);
     }
 
-    sampleRate = header.sampleRate;
-    channels = header.channels;
-
-    size_t numSamples = header.dataSize / sizeof(int16_t);
-    samples.resize(numSamples);
-    file.read(reinterpret_cast<char*>(samples.data()), header.dataSize);
-
-    return true;
+    result.ok = sent && session->Finish(TIMEOUT);
+    result.loadMs = audio.loadMs;
+    result.output = session->Transcript();
+    result.error = session->Error();
+    result.timings = session->Timings();
+    result.chunkStats = session->ChunkStats();
+    result.traceId = session->TraceId();
+    WriteTrace(*session);
+    return result;
 }
 
 // ============================================================================
-// Base64 Encoding
+// LLM Function
 // ============================================================================
 
-std::string Base64Encode(const uint8_t* data, size_t length) {
-    static const char base64_chars[] =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/";
-
-    std::string result;
-    result.reserve(((length + 2) / 3) * 4);
-
-    for (size_t i = 0; i < length; i += 3) {
-        uint32_t val = data[i] << 16;
-        if (i + 1 < length) val |= data[i + 1] << 8;
-        if (i + 2 < length) val |= data[i + 2];
+// Collect the result of a submitted prompt, waiting up to the LLM timeout
+CommandResult AwaitLLM(Rise::RiseClient& client, const std::shared_ptr<Rise::Request>& request) {
+    // Wait for response with timeout
+    const auto TIMEOUT = std::chrono::milliseconds(60000);
 
-        result += base64_chars[(val >> 18) & 0x3F];
-        result += base64_chars[(val >> 12) & 0x3F];
-        result += (i + 1 < length) ? base64_chars[(val >> 6) & 0x3F] : '=';
-        result += (i + 2 < length) ? base64_chars[val & 0x3F] : '=';
+    CommandResult result;
+    if (!request->WaitUntilStarted(QUEUE_TIMEOUT) || !request->Wait(TIMEOUT)) {
+        client.Cancel(request, "Timeout waiting for LLM response");
     }
 
+    result.ok = request->Succeeded();
+    result.output = request->Text();
+    result.error = request->Error();
+    result.chart = request->Chart();
+    result.timings = request->Timings();
+    result.traceId = request->TraceId();
+    WriteTrace(*request);
     return result;
 }
 
+CommandResult DoLLM(Rise::RiseClient& client, const std::string& prompt) {
+    return AwaitLLM(client, client.SubmitLlm(prompt));
+}
+
 // ============================================================================
-// RISE Callback Handler
+// JSON Lines
 // ============================================================================
 
-void RiseCallback(NV_RISE_CALLBACK_DATA_V1* pData) {
-    if (!pData) return;
+struct JsonValue {
+    bool isString = false;
+    std::string text;       // unescaped for strings, raw JSON otherwise
+};
 
-    std::lock_guard<std::mutex> lock(g_responseMutex);
+static void AppendUtf8(std::string& out, unsigned codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
 
-    switch (pData->contentType) {
-        case NV_RISE_CONTENT_TYPE_READY:
-            if (pData->completed == 1) {
-                g_systemReady = true;
-            }
-            break;
+static bool ParseHex4(const std::string& text, size_t pos, unsigned& value) {
+    if (pos + 4 > text.size()) return false;
+    value = 0;
+    for (size_t i = pos; i < pos + 4; i++) {
+        char c = text[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
 
-        case NV_RISE_CONTENT_TYPE_TEXT: {
-            std::string chunk(pData->content);
-            
-            if (!chunk.empty()) {
-                // Check for ASR responses
-                if (chunk.find("ASR_INTERIM:") == 0) {
-                    // Ignore interim results
-                } else if (chunk.find("ASR_FINAL:") == 0) {
-                    // Extract final transcription
-                    g_finalResult = chunk.substr(10);
-                    if (g_waitingForAsrFinal.load()) {
-                        g_responseCompleted = true;
-                        g_responseSemaphore.release();
+// Parse a JSON string starting at the opening quote; pos ends past the closing quote
+static bool ParseJsonString(const std::string& text, size_t& pos, std::string& out) {
+    if (pos >= text.size() || text[pos] != '"') return false;
+    pos++;
+    while (pos < text.size()) {
+        char c = text[pos++];
+        if (c == '"') return true;
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= text.size()) return false;
+        char escape = text[pos++];
+        switch (escape) {
+            case '"':  out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/'; break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u': {
+                unsigned codePoint = 0;
+                if (!ParseHex4(text, pos, codePoint)) return false;
+                pos += 4;
+                // Surrogate pair
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                    unsigned low = 0;
+                    if (ParseHex4(text, pos + 2, low) && low >= 0xDC00 && low < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        pos += 6;
                     }
-                } else {
-                    // LLM response - accumulate
-                    g_finalResult += chunk;
-                    g_expectedTypes |= CT_TEXT;
                 }
+                AppendUtf8(out, codePoint);
+                break;
             }
-
-            if (pData->completed == 1) {
-                g_completedTypes |= CT_TEXT;
-                if (!g_waitingForAsrFinal.load() && AllExpectedTypesComplete()) {
-                    g_responseCompleted = true;
-                    g_responseSemaphore.release();
-                }
-            }
-            break;
+            default:
+                return false;
         }
+    }
+    return false;
+}
 
-        // Handle CUSTOM_BEHAVIOR - contains JSON tool calls
-        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR: {
-            std::string chunk(pData->content);
-            if (!chunk.empty()) {
-                g_finalResult += chunk;
-                g_expectedTypes |= CT_CUSTOM_BEHAVIOR;
-            }
-            if (pData->completed == 1) {
-                g_completedTypes |= CT_CUSTOM_BEHAVIOR;
-                if (AllExpectedTypesComplete()) {
-                    g_responseCompleted = true;
-                    g_responseSemaphore.release();
-                }
-            }
-            break;
-        }
+static void SkipSpace(const std::string& text, size_t& pos) {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+        pos++;
+    }
+}
 
-        // Handle CUSTOM_BEHAVIOR_RESULT - contains JSON tool call results
-        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR_RESULT: {
-            std::string chunk(pData->content);
-            if (!chunk.empty()) {
-                g_finalResult += chunk;
-                g_expectedTypes |= CT_CUSTOM_BEHAVIOR_RESULT;
-            }
-            if (pData->completed == 1) {
-                g_completedTypes |= CT_CUSTOM_BEHAVIOR_RESULT;
-                if (AllExpectedTypesComplete()) {
-                    g_responseCompleted = true;
-                    g_responseSemaphore.release();
-                }
-            }
+// Skip a non-string value (number, literal, nested object or array)
+static bool SkipJsonValue(const std::string& text, size_t& pos) {
+    int depth = 0;
+    size_t start = pos;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '"') {
+            std::string ignored;
+            if (!ParseJsonString(text, pos, ignored)) return false;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) break;
+            depth--;
+        } else if (c == ',' && depth == 0) {
             break;
         }
+        pos++;
+    }
+    return depth == 0 && pos > start;
+}
 
-        // Handle GRAPH - contains chart/graph data
-        case NV_RISE_CONTENT_TYPE_GRAPH: {
-            std::string chunk(pData->content);
-            if (!chunk.empty()) {
-                g_chartData += chunk;
-                g_expectedTypes |= CT_GRAPH;
-            }
-            if (pData->completed == 1) {
-                g_completedTypes |= CT_GRAPH;
-                if (AllExpectedTypesComplete()) {
-                    g_responseCompleted = true;
-                    g_responseSemaphore.release();
-                }
+/**
+ * Parse one JSON object. Top-level string members are unescaped; other
+ * members are kept as raw JSON text.
+ */
+bool ParseJsonObject(const std::string& text, std::map<std::string, JsonValue>& members) {
+    size_t pos = 0;
+    SkipSpace(text, pos);
+    if (pos >= text.size() || text[pos] != '{') return false;
+    pos++;
+    SkipSpace(text, pos);
+    if (pos < text.size() && text[pos] == '}') return true;
+
+    while (pos < text.size()) {
+        std::string key;
+        SkipSpace(text, pos);
+        if (!ParseJsonString(text, pos, key)) return false;
+        SkipSpace(text, pos);
+        if (pos >= text.size() || text[pos] != ':') return false;
+        pos++;
+        SkipSpace(text, pos);
+
+        JsonValue value;
+        if (pos < text.size() && text[pos] == '"') {
+            value.isString = true;
+            if (!ParseJsonString(text, pos, value.text)) return false;
+        } else {
+            size_t start = pos;
+            if (!SkipJsonValue(text, pos)) return false;
+            value.text = text.substr(start, pos - start);
+            while (!value.text.empty() && std::isspace(static_cast<unsigned char>(value.text.back()))) {
+                value.text.pop_back();
             }
-            break;
         }
+        members[key] = value;
 
-        default:
-            break;
+        SkipSpace(text, pos);
+        if (pos >= text.size()) return false;
+        if (text[pos] == '}') return true;
+        if (text[pos] != ',') return false;
+        pos++;
     }
+    return false;
 }
 
-// ============================================================================
-// RISE Initialization
-// ============================================================================
+static std::string JsonString(const std::string& text) {
+    return "\"" + Rise::JsonEscape(text) + "\"";
+}
 
-bool InitializeRise() {
-    NvAPI_Status status = NvAPI_Initialize();
-    if (status != NVAPI_OK) {
-        return false;
+static std::string JsonNumber(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+enum class ItemType { Invalid, Llm, Asr };
+
+/**
+ * One result line: {"id":..,"type":..,"ok":..,"result"|"error":.., timings}
+ */
+std::string FormatResultLine(const std::string& idJson, ItemType type, const CommandResult& result) {
+    bool isAsr = type == ItemType::Asr;
+    std::string line = "{\"id\":" + idJson;
+    if (type != ItemType::Invalid) {
+        line += ",\"type\":";
+        line += isAsr ? "\"asr\"" : "\"llm\"";
     }
+    line += ",\"ok\":";
+    line += result.ok ? "true" : "false";
+    if (result.ok) {
+        line += ",\"result\":" + JsonString(result.output);
+    } else {
+        line += ",\"error\":" + JsonString(result.error);
+    }
+    if (!result.chart.empty()) {
+        line += ",\"chart\":" + JsonString(result.chart);
+    }
+
+    const Rise::RequestTimings& timings = result.timings;
+    if (timings.started != Clock::time_point()) {
+        line += ",\"queue_ms\":" + JsonNumber(timings.QueueMs());
+        line += ",\"ttft_ms\":" + (timings.hasFirstToken ? JsonNumber(timings.TimeToFirstTokenMs()) : std::string("null"));
+        line += ",\"total_ms\":" + JsonNumber(timings.TotalMs());
+    }
+    if (isAsr) {
+        line += ",\"load_ms\":" + JsonNumber(result.loadMs);
+        line += ",\"chunks\":" + std::to_string(result.chunkStats.acknowledged);
+        line += ",\"chunks_per_s\":" + JsonNumber(result.chunkStats.chunksPerSecond);
+        line += ",\"mean_ack_ms\":" + JsonNumber(result.chunkStats.meanAckMs);
+    }
+    if (!result.traceId.empty()) {
+        line += ",\"trace_id\":" + JsonString(result.traceId);
+    }
+    line += "}";
+    return line;
+}
 
-    NV_RISE_CALLBACK_SETTINGS_V1 callbackSettings = { 0 };
-    callbackSettings.version = NV_RISE_CALLBACK_SETTINGS_VER1;
-    callbackSettings.callback = RiseCallback;
+/**
+ * One request object: {"id": .., "prompt": ".."} (LLM), {"id": .., "wav": ".."}
+ * (ASR) or, in server mode, {"id": .., "command": ".."}. Without an id, the
+ * caller's default is kept.
+ */
+struct Item {
+    std::string idJson;
+    ItemType type = ItemType::Invalid;
+    std::string input;      // prompt or WAV path
+    std::string command;
+    std::string error;      // set when the object cannot be parsed
+};
 
-    status = NvAPI_RegisterRiseCallback(&callbackSettings);
-    if (status != NVAPI_OK) {
+bool ParseItem(const std::string& text, Item& item) {
+    std::map<std::string, JsonValue> members;
+    if (!ParseJsonObject(text, members)) {
+        item.error = "invalid JSON";
         return false;
     }
 
-    // Wait for system ready
-    auto startTime = std::chrono::steady_clock::now();
-    while (!g_systemReady) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::steady_clock::now() - startTime).count();
-        if (elapsed > 30) {
-            return false;
-        }
+    auto id = members.find("id");
+    if (id != members.end()) {
+        item.idJson = id->second.isString ? JsonString(id->second.text) : id->second.text;
     }
 
+    auto prompt = members.find("prompt");
+    auto wav = members.find("wav");
+    auto command = members.find("command");
+
+    if (prompt != members.end() && prompt->second.isString) {
+        item.type = ItemType::Llm;
+        item.input = prompt->second.text;
+    } else if (wav != members.end() && wav->second.isString) {
+        item.type = ItemType::Asr;
+        item.input = wav->second.text;
+    } else if (command != members.end() && command->second.isString) {
+        item.command = command->second.text;
+    } else {
+        item.error = "expected a \"prompt\" or \"wav\" string";
+        return false;
+    }
     return true;
 }
 
 // ============================================================================
-// ASR Function
+// Streaming Output
 // ============================================================================
 
-std::string DoASR(const std::string& wavFilePath) {
-    // Load WAV file
-    std::vector<int16_t> audioSamples;
-    int sampleRate = 0;
-    int channels = 0;
+enum class StreamFormat { None, Text, Ndjson };
 
-    if (!LoadWavFile(wavFilePath, audioSamples, sampleRate, channels)) {
-        return "ERROR: Failed to load WAV file";
+/**
+ * Writes LLM text to stdout as each chunk arrives instead of after
+ * completion. Ndjson writes one event object per line:
+ *   {"event":"token","text":"..."}
+ *   {"event":"done","ok":true,"ttft_ms":..,"tokens":..,"tokens_per_s":..,"total_ms":..}
+ * Tokens are counted per TEXT callback.
+ */
+class TokenStream {
+public:
+    explicit TokenStream(StreamFormat format) : format_(format) {}
+
+    // Called on the client's delivery thread
+    void OnOutput(Rise::OutputKind kind, const std::string& content) {
+        if (kind != Rise::OutputKind::Text) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        tokens_++;
+        if (format_ == StreamFormat::Ndjson) {
+            std::cout << "{\"event\":\"token\",\"text\":" << JsonString(content) << "}\n";
+        } else {
+            std::cout << content;
+        }
+        std::cout.flush();
     }
 
-    // Convert stereo to mono if needed
-    if (channels == 2) {
-        std::vector<int16_t> mono;
-        mono.reserve(audioSamples.size() / 2);
-        for (size_t i = 0; i + 1 < audioSamples.size(); i += 2) {
-            int32_t avg = (static_cast<int32_t>(audioSamples[i]) + audioSamples[i + 1]) / 2;
-            mono.push_back(static_cast<int16_t>(avg));
+    // Close the stream after the request is done. Metrics go to stderr.
+    void Finish(const CommandResult& result) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Rise::RequestTimings& timings = result.timings;
+
+        // Generation rate after the first token, so queueing and prompt
+        // processing don't count against it
+        double generationMs = timings.hasFirstToken ? Rise::RequestTimings::Ms(timings.firstToken, timings.finished) : 0.0;
+        double tokensPerSecond = (generationMs > 0.0 && tokens_ > 1) ? (tokens_ - 1) * 1000.0 / generationMs : 0.0;
+
+        if (format_ == StreamFormat::Ndjson) {
+            if (!result.chart.empty()) {
+                std::cout << "{\"event\":\"chart\",\"data\":" << JsonString(result.chart) << "}\n";
+            }
+            std::cout << "{\"event\":\"done\",\"ok\":" << (result.ok ? "true" : "false");
+            if (!result.ok) {
+                std::cout << ",\"error\":" << JsonString(result.error);
+            }
+            std::cout << ",\"ttft_ms\":" << JsonNumber(timings.TimeToFirstTokenMs())
+                      << ",\"tokens\":" << tokens_
+                      << ",\"tokens_per_s\":" << JsonNumber(tokensPerSecond)
+                      << ",\"total_ms\":" << JsonNumber(timings.TotalMs()) << "}" << std::endl;
+        } else {
+            std::cout << std::endl;
+            if (!result.ok) {
+                std::cout << "ERROR: " << result.error << std::endl;
+            }
+            if (!result.chart.empty()) {
+                std::cerr << "[CHART_DATA]" << std::endl;
+                std::cerr << result.chart << std::endl;
+            }
         }
-        audioSamples = mono;
-    }
 
-    // Reset state
-    {
-        std::lock_guard<std::mutex> lock(g_responseMutex);
-        g_finalResult.clear();
-        g_responseCompleted = false;
-        g_expectedTypes  = 0;
-        g_completedTypes = 0;
+        std::cerr << "[LLM] TTFT " << timings.TimeToFirstTokenMs() << " ms, " << tokens_ << " tokens at "
+                  << tokensPerSecond << " tokens/s, total " << timings.TotalMs() << " ms" << std::endl;
     }
-    while (g_responseSemaphore.try_acquire()) {}
 
-    // Send audio chunks
-    const int SAMPLES_PER_CHUNK = 700;
-    const int NUM_CHUNKS = (audioSamples.size() + SAMPLES_PER_CHUNK - 1) / SAMPLES_PER_CHUNK;
+private:
+    const StreamFormat format_;
+    std::mutex mutex_;
+    int tokens_ = 0;
+};
 
-    for (int chunkId = 0; chunkId < NUM_CHUNKS; chunkId++) {
-        size_t startSample = chunkId * SAMPLES_PER_CHUNK;
-        size_t endSample = std::min(startSample + SAMPLES_PER_CHUNK, audioSamples.size());
-        size_t chunkSize = endSample - startSample;
+// ============================================================================
+// Batch Mode
+// ============================================================================
 
-        // Convert to float32
-        std::vector<float> floatSamples(chunkSize);
-        for (size_t i = 0; i < chunkSize; i++) {
-            floatSamples[i] = static_cast<float>(audioSamples[startSample + i]) / 32768.0f;
-        }
+// Prompts submitted ahead of the one being waited on, so the engine never
+// idles between items
+static constexpr size_t BATCH_LOOKAHEAD = 8;
 
-        // Encode to base64
-        const uint8_t* chunkData = reinterpret_cast<const uint8_t*>(floatSamples.data());
-        size_t chunkBytes = chunkSize * sizeof(float);
-        std::string base64Audio = Base64Encode(chunkData, chunkBytes);
-
-        // Format payload
-        std::string payload = "CHUNK:" + std::to_string(chunkId) + ":" + 
-                              std::to_string(sampleRate) + ":" + base64Audio;
-
-        // Send chunk
-        NV_REQUEST_RISE_SETTINGS_V1 requestSettings = { 0 };
-        requestSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-        requestSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-        strncpy_s(requestSettings.content, sizeof(requestSettings.content),
-                  payload.c_str(), payload.length());
-        requestSettings.completed = 0;
-
-        NvAPI_Status status = NvAPI_RequestRise(&requestSettings);
-        if (status != NVAPI_OK) {
-            return "ERROR: Failed to send audio chunk";
-        }
+struct PendingLLM {
+    std::string idJson;
+    std::shared_ptr<Rise::Request> request;
+};
 
-        // Wait for acknowledgment
-        g_responseSemaphore.acquire();
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
-    }
-
-    // Send STOP and wait for final transcription
-    g_waitingForAsrFinal.store(true);
-    
-    {
-        std::lock_guard<std::mutex> lock(g_responseMutex);
-        g_finalResult.clear();
-        g_responseCompleted = false;
-        g_expectedTypes  = 0;
-        g_completedTypes = 0;
-    }
-    while (g_responseSemaphore.try_acquire()) {}
-
-    NV_REQUEST_RISE_SETTINGS_V1 stopSettings = { 0 };
-    stopSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-    stopSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-    strncpy_s(stopSettings.content, sizeof(stopSettings.content), "STOP:", 5);
-    stopSettings.completed = 0;
-
-    NvAPI_Status status = NvAPI_RequestRise(&stopSettings);
-    if (status != NVAPI_OK) {
-        g_waitingForAsrFinal.store(false);
-        return "ERROR: Failed to send STOP command";
-    }
-
-    // Wait for ASR_FINAL with timeout
-    auto waitStart = std::chrono::steady_clock::now();
-    const int TIMEOUT_MS = 15000;
-    
-    while (true) {
-        if (g_responseSemaphore.try_acquire()) {
-            break;
+struct BatchTotals {
+    size_t items = 0;
+    size_t failed = 0;
+};
+
+static void WriteResult(const std::string& idJson, ItemType type, const CommandResult& result, BatchTotals& totals) {
+    totals.items++;
+    if (!result.ok) totals.failed++;
+    std::cout << FormatResultLine(idJson, type, result) << std::endl;
+}
+
+static void DrainPending(Rise::RiseClient& client, std::deque<PendingLLM>& pending, size_t keep, BatchTotals& totals) {
+    while (pending.size() > keep) {
+        PendingLLM item = pending.front();
+        pending.pop_front();
+        WriteResult(item.idJson, ItemType::Llm, AwaitLLM(client, item.request), totals);
+    }
+}
+
+int RunBatch(Rise::RiseClient& client, std::istream& input, const AsrOptions& asrOptions) {
+    auto batchStart = Clock::now();
+    std::deque<PendingLLM> pending;
+    BatchTotals totals;
+    std::string line;
+    size_t lineNumber = 0;
+
+    while (std::getline(input, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+        Item item;
+        item.idJson = std::to_string(lineNumber);
+        CommandResult invalid;
+
+        if (!ParseItem(line, item) || item.type == ItemType::Invalid) {
+            invalid.error = item.error.empty() ? "expected a \"prompt\" or \"wav\" string" : item.error;
+            invalid.error += " on line " + std::to_string(lineNumber);
+            DrainPending(client, pending, 0, totals);
+            WriteResult(item.idJson, ItemType::Invalid, invalid, totals);
+            continue;
         }
-        
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - waitStart).count();
-        
-        if (elapsed >= TIMEOUT_MS) {
-            g_waitingForAsrFinal.store(false);
-            return "ERROR: Timeout waiting for transcription";
+
+        if (item.type == ItemType::Llm) {
+            pending.push_back({ item.idJson, client.SubmitLlm(item.input) });
+            DrainPending(client, pending, BATCH_LOOKAHEAD, totals);
+        } else {
+            // Check the file while queued prompts are still running, then
+            // let the session have the engine once they are done
+            WavAudio audio;
+            bool loaded = OpenWav(item.input, audio);
+            DrainPending(client, pending, 0, totals);
+
+            if (!loaded) {
+                invalid.error = "Failed to load WAV file: " + audio.error;
+                WriteResult(item.idJson, ItemType::Asr, invalid, totals);
+            } else {
+                WriteResult(item.idJson, ItemType::Asr, DoASR(client, audio, asrOptions), totals);
+            }
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
+    DrainPending(client, pending, 0, totals);
 
-    g_waitingForAsrFinal.store(false);
-
-    std::lock_guard<std::mutex> lock(g_responseMutex);
-    return g_finalResult;
+    std::cerr << "[BATCH] " << totals.items << " items (" << totals.failed << " failed) in "
+              << MsSince(batchStart) / 1000.0 << " s" << std::endl;
+    return 0;
 }
 
 // ============================================================================
-// LLM Function
+// Server Mode
 // ============================================================================
 
-std::string DoLLM(const std::string& prompt) {
-    // Reset state
-    {
-        std::lock_guard<std::mutex> lock(g_responseMutex);
-        g_finalResult.clear();
-        g_chartData.clear();
-        g_responseCompleted = false;
-        g_expectedTypes  = 0;
-        g_completedTypes = 0;
+/**
+ * Serves requests from local clients over a named pipe while RISE stays
+ * initialized. Every client connection has its own thread and is answered
+ * in request order; requests from all clients share the RiseClient queue,
+ * so the engine runs them one at a time in arrival order.
+ */
+class CommandServer {
+public:
+    // How often a blocked client read is interrupted during shutdown
+    static constexpr auto SHUTDOWN_POLL_INTERVAL = std::chrono::milliseconds(50);
+
+    CommandServer(Rise::RiseClient& client, const std::string& pipeName, const AsrOptions& asrOptions)
+        : client_(client), pipe_(pipeName), asrOptions_(asrOptions) {}
+
+    int Run() {
+        std::cerr << "[SERVER] Listening on " << pipe_.Name() << std::endl;
+
+        int exitCode = 0;
+        while (true) {
+            std::unique_ptr<PipeConnection> pipe = pipe_.Accept();
+            if (!pipe) {
+                if (!pipe_.Stopping()) {
+                    std::cerr << "ERROR: Named pipe failed (error " << pipe_.LastError() << ")" << std::endl;
+                    exitCode = 1;
+                }
+                break;
+            }
+
+            ReapFinished();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            connections_.emplace_back(new Connection());
+            Connection& connection = *connections_.back();
+            connection.pipe = std::move(pipe);
+            connection.number = ++connectionCount_;
+            connection.thread = std::thread([this, &connection] { Serve(connection); });
+        }
+
+        StopConnections();
+        std::cerr << "[SERVER] Stopped after " << served_.load() << " requests" << std::endl;
+        return exitCode;
     }
-    while (g_responseSemaphore.try_acquire()) {}
 
-    // Build JSON request
-    std::string jsonRequest = "{\"prompt\":\"" + prompt + "\",\"context_assist\":{},\"client_config\":{}}";
+private:
+    struct Connection {
+        std::unique_ptr<PipeConnection> pipe;
+        std::thread thread;
+        uint64_t number = 0;
+        bool finished = false;   // guarded by CommandServer::mutex_
+    };
+
+    void Serve(Connection& connection) {
+        std::cerr << "[SERVER] Client " << connection.number << " connected" << std::endl;
+
+        std::string payload;
+        while (true) {
+            PipeConnection::ReadStatus status = connection.pipe->ReadMessage(payload);
+            if (status == PipeConnection::ReadStatus::Closed) {
+                break;
+            }
+            if (status == PipeConnection::ReadStatus::BadFrame) {
+                CommandResult invalid;
+                invalid.error = "bad frame (expected 4-byte big-endian length and JSON payload)";
+                connection.pipe->WriteMessage(FormatResultLine("null", ItemType::Invalid, invalid));
+                break;
+            }
+
+            bool shutdown = false;
+            std::string response = Handle(payload, shutdown);
+            served_++;
+            if (!connection.pipe->WriteMessage(response)) {
+                break;
+            }
+            if (shutdown) {
+                pipe_.Stop();
+                break;
+            }
+        }
 
-    // Send request
-    NV_REQUEST_RISE_SETTINGS_V1 requestSettings = { 0 };
-    requestSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-    requestSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-    strncpy_s(requestSettings.content, sizeof(requestSettings.content),
-              jsonRequest.c_str(), jsonRequest.length());
-    requestSettings.completed = 1;
+        std::cerr << "[SERVER] Client " << connection.number << " disconnected" << std::endl;
+        connection.pipe.reset();
 
-    NvAPI_Status status = NvAPI_RequestRise(&requestSettings);
-    if (status != NVAPI_OK) {
-        return "ERROR: Failed to send LLM request";
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection.finished = true;
+        condition_.notify_all();
     }
 
-    // Wait for response with timeout
-    auto waitStart = std::chrono::steady_clock::now();
-    const int TIMEOUT_MS = 60000;
-    
-    while (true) {
-        if (g_responseSemaphore.try_acquire()) {
-            break;
+    std::string Handle(const std::string& payload, bool& shutdown) {
+        Item item;
+        item.idJson = "null";
+        CommandResult result;
+
+        if (!ParseItem(payload, item)) {
+            result.error = item.error;
+            return FormatResultLine(item.idJson, ItemType::Invalid, result);
+        }
+
+        if (item.type == ItemType::Llm) {
+            return FormatResultLine(item.idJson, item.type, DoLLM(client_, item.input));
         }
-        
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - waitStart).count();
-        
-        if (elapsed >= TIMEOUT_MS) {
-            return "ERROR: Timeout waiting for LLM response";
+
+        if (item.type == ItemType::Asr) {
+            WavAudio audio;
+            if (!OpenWav(item.input, audio)) {
+                result.error = "Failed to load WAV file: " + audio.error;
+            } else {
+                result = DoASR(client_, audio, asrOptions_);
+            }
+            return FormatResultLine(item.idJson, item.type, result);
+        }
+
+        std::string reply = "{\"id\":" + item.idJson + ",\"ok\":true";
+        if (item.command == "ping") {
+            reply += ",\"result\":\"pong\"";
+        } else if (item.command == "status") {
+            reply += ",\"pending\":" + std::to_string(client_.PendingCount());
+            reply += ",\"served\":" + std::to_string(served_.load());
+        } else if (item.command == "shutdown") {
+            shutdown = true;
+            reply += ",\"result\":\"shutting down\"";
+        } else {
+            result.error = "unknown command: " + item.command;
+            return FormatResultLine(item.idJson, ItemType::Invalid, result);
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return reply + "}";
     }
 
-    std::lock_guard<std::mutex> lock(g_responseMutex);
-    return g_finalResult;
-}
+    // Caller must not hold mutex_
+    void ReapFinished() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            if ((*it)->finished) {
+                (*it)->thread.join();
+                it = connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Let running requests finish, and interrupt clients blocked in a read
+    void StopConnections() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto& connection : connections_) {
+            while (!connection->finished) {
+                CancelSynchronousIo(connection->thread.native_handle());
+                condition_.wait_for(lock, SHUTDOWN_POLL_INTERVAL);
+            }
+            connection->thread.join();
+        }
+        connections_.clear();
+    }
+
+    Rise::RiseClient& client_;
+    PipeServer pipe_;
+    const AsrOptions asrOptions_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::list<std::unique_ptr<Connection>> connections_;
+    uint64_t connectionCount_ = 0;
+    std::atomic<uint64_t> served_{ 0 };
+};
 
 // ============================================================================
 // Main
@@ -492,48 +769,147 @@ std::string DoLLM(const std::string& prompt) {
 
 void PrintUsage(const char* programName) {
     std::cerr << "Usage:" << std::endl;
-    std::cerr << "  " << programName << " --asr <wav_file>   Transcribe WAV file to text" << std::endl;
-    std::cerr << "  " << programName << " --llm \"<prompt>\"   Send prompt to LLM and get response" << std::endl;
+    std::cerr << "  " << programName << " --asr <wav_file> [--window N] [--chunk-format F]   Transcribe WAV file to text" << std::endl;
+    std::cerr << "      --window N   Audio chunks in flight at once (default "
+              << ChunkWindow::DEFAULT_CAPACITY << ", 1 = wait for each chunk)" << std::endl;
+    std::cerr << "      --chunk-format float32 | int16   Chunk payload (default float32); int16 sends" << std::endl;
+    std::cerr << "                   twice the audio per request as CHUNK16, if the engine supports it" << std::endl;
+    std::cerr << "  " << programName << " --llm \"<prompt>\" [--stream | --ndjson]   Send prompt to LLM and get response" << std::endl;
+    std::cerr << "      --stream   Print the response as it arrives, timing metrics to stderr" << std::endl;
+    std::cerr << "      --ndjson   Like --stream, as one JSON event per line" << std::endl;
+    std::cerr << "  " << programName << " --batch <file.jsonl | -> [--window N] [--chunk-format F]   Run many items in one session" << std::endl;
+    std::cerr << "      one {\"id\": ..., \"prompt\": \"...\"} or {\"id\": ..., \"wav\": \"...\"} per line;" << std::endl;
+    std::cerr << "      \"-\" reads stdin. Writes one JSON result line per item." << std::endl;
+    std::cerr << "  " << programName << " --serve [pipe_name] [--window N] [--chunk-format F]   Serve requests over a named pipe" << std::endl;
+    std::cerr << "      default pipe " << PipeServer::DEFAULT_NAME << "; same request objects as --batch," << std::endl;
+    std::cerr << "      length-prefixed like the plugin protocol" << std::endl;
+    std::cerr << "  --trace DIR   Write a Chrome trace of each request to DIR/<trace_id>.json" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
+    if (argc < 2) {
         PrintUsage(argv[0]);
         return 1;
     }
 
     std::string mode = argv[1];
-    std::string input = argv[2];
+    std::string input;
+    int firstOption = 3;
+
+    if (mode == "--serve") {
+        // Pipe name is optional; bare names are placed in the local pipe namespace
+        if (argc >= 3 && std::strncmp(argv[2], "--", 2) != 0) {
+            input = argv[2];
+            if (input.compare(0, 2, "\\\\") != 0) {
+                input = "\\\\.\\pipe\\" + input;
+            }
+        } else {
+            input = PipeServer::DEFAULT_NAME;
+            firstOption = 2;
+        }
+    } else if (argc < 3) {
+        PrintUsage(argv[0]);
+        return 1;
+    } else {
+        input = argv[2];
+    }
+
+    AsrOptions asrOptions;
+    StreamFormat streamFormat = StreamFormat::None;
+    for (int i = firstOption; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--stream" && mode == "--llm") {
+            streamFormat = StreamFormat::Text;
+        } else if (option == "--ndjson" && mode == "--llm") {
+            streamFormat = StreamFormat::Ndjson;
+        } else if (option == "--window" && i + 1 < argc) {
+            int value = std::atoi(argv[++i]);
+            if (value < 1) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            asrOptions.windowSize = static_cast<size_t>(value);
+        } else if (option == "--trace" && i + 1 < argc) {
+            g_traceDir = argv[++i];
+        } else if (option == "--chunk-format" && i + 1 < argc && mode != "--llm") {
+            if (!Rise::ParseChunkEncoding(argv[++i], asrOptions.encoding)) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (mode != "--asr" && mode != "--llm" && mode != "--batch" && mode != "--serve") {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream batchFile;
+    if (mode == "--batch" && input != "-") {
+        batchFile.open(input);
+        if (!batchFile.is_open()) {
+            std::cerr << "ERROR: Could not open batch file: " << input << std::endl;
+            return 1;
+        }
+    }
 
     // Initialize RISE
-    if (!InitializeRise()) {
+    Rise::RiseClient client;
+    if (client.Connect() != NVAPI_OK || !client.WaitUntilReady()) {
         std::cerr << "ERROR: Failed to initialize RISE" << std::endl;
         return 1;
     }
+    client.SetTracing(!g_traceDir.empty());
 
-    std::string result;
+    if (mode == "--batch") {
+        return RunBatch(client, input == "-" ? std::cin : batchFile, asrOptions);
+    }
+
+    if (mode == "--serve") {
+        CommandServer server(client, input, asrOptions);
+        return server.Run();
+    }
+
+    if (streamFormat != StreamFormat::None) {
+        TokenStream stream(streamFormat);
+        CommandResult result = AwaitLLM(client, client.SubmitLlm(input,
+            [&stream](Rise::OutputKind kind, const std::string& content) { stream.OnOutput(kind, content); }));
+        stream.Finish(result);
+        return 0;
+    }
+
+    CommandResult result;
 
     if (mode == "--asr") {
-        result = DoASR(input);
-    } else if (mode == "--llm") {
-        result = DoLLM(input);
+        WavAudio audio;
+        if (!OpenWav(input, audio)) {
+            result.error = "Failed to load WAV file: " + audio.error;
+        } else {
+            result = DoASR(client, audio, asrOptions);
+        }
+
+        if (result.ok) {
+            const ChunkWindow::Stats& stats = result.chunkStats;
+            std::cerr << "[ASR] " << stats.acknowledged << " chunks in " << stats.elapsedSeconds << " s ("
+                      << stats.chunksPerSecond << " chunks/s, window " << asrOptions.windowSize
+                      << ", " << Rise::ChunkEncodingName(asrOptions.encoding)
+                      << ", mean ack " << stats.meanAckMs << " ms, max " << stats.maxAckMs << " ms)" << std::endl;
+        }
     } else {
-        PrintUsage(argv[0]);
-        return 1;
+        result = DoLLM(client, input);
     }
 
     // Output the result
-    std::cout << result << std::endl;
+    std::cout << (result.ok ? result.output : "ERROR: " + result.error) << std::endl;
 
     // Output chart data if present (on stderr to separate from main result)
-    {
-        std::lock_guard<std::mutex> lock(g_responseMutex);
-        if (!g_chartData.empty()) {
-            std::cerr << "[CHART_DATA]" << std::endl;
-            std::cerr << g_chartData << std::endl;
-        }
+    if (!result.chart.empty()) {
+        std::cerr << "[CHART_DATA]" << std::endl;
+        std::cerr << result.chart << std::endl;
     }
 
     return 0;
 }
-
@@ -30,7 +30,11 @@
 #include <algorithm>
 #include <cmath>
 #include <queue>
-#include "nvapi.h"
+#include <stdexcept>
+#include "audio_ring_buffer.h"
+#include "mic_sender.h"
+#include "rise_client.h"
+#include "voice_gate.h"
 
 // ============================================================================
 // Miniaudio - Single-header audio library for microphone capture
@@ -40,169 +44,54 @@
 #define MA_NO_ENCODING      // We don't need file encoding
 #define MA_NO_GENERATION    // We don't need waveform generation
 #include "miniaudio.h"
-
-// ============================================================================
-// Synchronization Primitives
-// ============================================================================
-
-/**
- * Simple semaphore implementation for synchronizing async callbacks
- */
-class Semaphore {
-private:
-    std::mutex mutex_;
-    std::condition_variable condition_;
-    unsigned long count_ = 0;
-
-public:
-    void release() {
-        std::lock_guard<decltype(mutex_)> lock(mutex_);
-        ++count_;
-        condition_.notify_one();
-    }
-
-    void acquire() {
-        std::unique_lock<decltype(mutex_)> lock(mutex_);
-        while (!count_) {
-            condition_.wait(lock);
-        }
-        --count_;
-    }
-
-    bool try_acquire() {
-        std::lock_guard<decltype(mutex_)> lock(mutex_);
-        if (count_) {
-            --count_;
-            return true;
-        }
-        return false;
-    }
-};
+#include "mic_capture.h"
 
 // ============================================================================
 // Global State Management
 // ============================================================================
 
-Semaphore responseCompleteSemaphore;
-std::mutex responseMutex;
-std::string currentResponse;
-std::string currentChart;
-bool systemReady = false;
-bool responseCompleted = false;
-bool firstTokenReceived = false;
-bool callbackFinished = false;
-std::atomic<bool> spinnerActive(false);
-std::chrono::steady_clock::time_point requestStartTime;
-std::chrono::steady_clock::time_point firstTokenTime;
-
-// ASR-specific state
-std::atomic<bool> waitingForAsrFinal(false);  // When true, only release semaphore on ASR_FINAL
-std::string lastAsrFinalResponse;             // Store the ASR_FINAL response
+static Rise::RiseClient g_riseClient;
+
+// Serializes console output between the spinner and the response handlers,
+// so the first token can clear the spinner without sleeping
+static std::mutex g_consoleMutex;
+static std::atomic<bool> g_spinnerActive(false);
 
 // ============================================================================
-// Microphone Capture State (Thread-Safe Audio Buffer)
+// Microphone Capture State (Lock-Free Audio Buffer)
 // ============================================================================
 
-std::mutex micBufferMutex;
-std::vector<float> micBuffer;              // Accumulated audio samples from microphone
-std::atomic<bool> micCaptureActive(false); // Flag to control capture loop
 const int MIC_SAMPLE_RATE = 16000;         // 16kHz for ASR
-const int MIC_CHANNELS = 1;                // Mono
+const int MIC_BUFFER_SECONDS = 4;          // Audio the sender may fall behind by before samples are dropped
 
-// Debug logging flag - set to true to enable detailed mic debug output
-static bool g_micDebugLogging = false;
-static std::atomic<int> g_callbackCount(0);
-static std::chrono::steady_clock::time_point g_micStartTime;
-static std::atomic<float> g_lastRms(0.0f);  // Track audio level for warm-up detection
+AudioRingBuffer micBuffer(MIC_SAMPLE_RATE * MIC_BUFFER_SECONDS);  // Captured samples, audio thread -> sender
 
-/**
- * Miniaudio callback - called from audio thread when samples are available
- * We copy samples into our buffer for the main thread to consume
- */
-void MicrophoneDataCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
-    (void)pOutput; // Capture-only, no playback
+// Audio context, device list and open device; persists across sessions so
+// a second recording on the same microphone starts immediately
+static MicCapture g_mic(micBuffer, MIC_SAMPLE_RATE);
+static MicCaptureConfig g_micConfig;
+static bool g_micPrewarm = false;          // open the default microphone at startup
 
-    int callbackNum = g_callbackCount.fetch_add(1);
-    
-    if (pInput == nullptr) {
-        if (g_micDebugLogging && callbackNum < 10) {
-            std::cerr << "[MIC_DEBUG] Callback #" << callbackNum << ": pInput is NULL" << std::endl;
-        }
-        return;
-    }
-    
-    if (!micCaptureActive.load(std::memory_order_acquire)) {
-        if (g_micDebugLogging && callbackNum < 10) {
-            std::cerr << "[MIC_DEBUG] Callback #" << callbackNum << ": micCaptureActive is false" << std::endl;
-        }
-        return;
-    }
+// How long a started microphone may take to deliver non-silent audio
+static int g_micReadyTimeoutMs = 500;
 
-    const float* inputSamples = static_cast<const float*>(pInput);
-    
-    // Calculate RMS to check if we have actual audio
-    float rms = 0.0f;
-    for (ma_uint32 i = 0; i < frameCount; i++) {
-        rms += inputSamples[i] * inputSamples[i];
-    }
-    rms = std::sqrt(rms / frameCount);
+// ASR chunk payload format for both ASR demos (--chunk-format)
+static Rise::ChunkEncoding g_chunkEncoding = Rise::ChunkEncoding::Float32;
 
-    // Store RMS for warm-up detection (atomic for thread safety)
-    g_lastRms.store(rms, std::memory_order_release);
-    
-    std::lock_guard<std::mutex> lock(micBufferMutex);
-    size_t bufferSizeBefore = micBuffer.size();
-    micBuffer.insert(micBuffer.end(), inputSamples, inputSamples + frameCount);
-    
-    // Log first few callbacks and periodically after
-    if (g_micDebugLogging && (callbackNum < 10 || callbackNum % 100 == 0)) {
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - g_micStartTime).count();
-        std::cerr << "[MIC_DEBUG] Callback #" << callbackNum 
-                  << " @ " << elapsed << "ms"
-                  << ": frames=" << frameCount 
-                  << ", bufferBefore=" << bufferSizeBefore
-                  << ", bufferAfter=" << micBuffer.size()
-                  << ", RMS=" << std::fixed << std::setprecision(6) << rms
-                  << "\n" << std::flush;
-    }
-}
+// Silent chunks are dropped before encoding; see voice_gate.h
+static bool g_micVoiceGate = true;
+static VoiceGateConfig g_micVoiceGateConfig;
 
-// ============================================================================
-// Content Type Constants
-// ============================================================================
-// Note: NV_RISE_CONTENT_TYPE enum is defined in nvapi.h (values 0-9)
-// We define RESERVED separately as it's not in the official enum yet
+// Debug logging flag - set to true to enable detailed mic debug output
+static bool g_micDebugLogging = false;
 
-// Reserved type for experimental features (streaming ASR PoC)
-constexpr int NV_RISE_CONTENT_TYPE_RESERVED = 10;
+// Directory for Chrome traces of each request (--trace); empty = off
+static std::string g_traceDir;
 
 // ============================================================================
 // Utility Functions
 // ============================================================================
 
-/**
- * Get human-readable name for content type
- */
-const char* GetContentTypeName(int contentType) {
-    switch (contentType) {
-        case NV_RISE_CONTENT_TYPE_TEXT: return "TEXT";
-        case NV_RISE_CONTENT_TYPE_GRAPH: return "GRAPH";
-        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR: return "CUSTOM_BEHAVIOR";
-        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR_RESULT: return "CUSTOM_BEHAVIOR_RESULT";
-        case NV_RISE_CONTENT_TYPE_INSTALLING: return "INSTALLING";
-        case NV_RISE_CONTENT_TYPE_PROGRESS_UPDATE: return "PROGRESS_UPDATE";
-        case NV_RISE_CONTENT_TYPE_READY: return "READY";
-        case NV_RISE_CONTENT_TYPE_DOWNLOAD_REQUEST: return "DOWNLOAD_REQUEST";
-        case NV_RISE_CONTENT_TYPE_UPDATE_INFO: return "UPDATE_INFO";
-        default:
-            if (contentType == NV_RISE_CONTENT_TYPE_RESERVED) {
-                return "RESERVED (ASR)";
-            }
-            return "INVALID/UNKNOWN";
-    }
-}
-
 /**
  * Print colored output to console
  */
@@ -211,158 +100,70 @@ void PrintColored(const std::string& text, const std::string& color) {
     std::cout << text;
 }
 
-// ============================================================================
-// Callback Handler
-// ============================================================================
-
 /**
- * Main callback function that handles all RISE responses
- * This function is called asynchronously by the RISE engine
+ * Show a spinner until StopSpinner() or the first response output
  */
-void RiseCallbackHandler(NV_RISE_CALLBACK_DATA_V1* pData) {
-    if (!pData) return;
+std::thread StartSpinner(const std::string& label) {
+    g_spinnerActive.store(true, std::memory_order_release);
 
-    std::lock_guard<std::mutex> lock(responseMutex);
-
-    // Debug logging for callbacks
-    if (g_micDebugLogging) {
-        std::string contentStr(pData->content);
-        std::string contentPreview = contentStr.length() > 80 ? contentStr.substr(0, 80) + "..." : contentStr;
-        // Use \n at end and flush to prevent interleaving with other threads
-        std::cerr << "[CALLBACK_DEBUG] Type=" << GetContentTypeName(pData->contentType)
-                  << ", Completed=" << (int)pData->completed
-                  << ", Content='" << contentPreview << "'"
-                  << "\n" << std::flush;
-    }
+    return std::thread([label]() {
+        const char spinChars[] = { '|', '/', '-', '\\' };
+        int idx = 0;
 
-    switch (pData->contentType) {
-        case NV_RISE_CONTENT_TYPE_READY:
-            if (pData->completed == 1) {
-                systemReady = true;
-                std::cout << "[RISE] System is READY!" << std::endl;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(g_consoleMutex);
+                if (!g_spinnerActive.load(std::memory_order_acquire)) break;
+                std::cout << "\r" << spinChars[idx % 4] << " " << label;
+                std::cout.flush();
             }
-            break;
-
-        case NV_RISE_CONTENT_TYPE_TEXT: {
-            // Handle text responses (both LLM and ASR)
-            std::string chunk(pData->content);
-            bool isAsrFinal = false;
+            idx++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
+}
 
-            if (!chunk.empty()) {
-                // Track first token arrival time
-                if (!firstTokenReceived) {
-                    firstTokenReceived = true;
-                    firstTokenTime = std::chrono::steady_clock::now();
+/**
+ * Stop the spinner and clear its line. Caller holds g_consoleMutex.
+ */
+void ClearSpinnerLocked() {
+    if (g_spinnerActive.exchange(false, std::memory_order_acq_rel)) {
+        std::cout << "\r\033[K";
+        std::cout.flush();
+    }
+}
 
-                    // Give spinner thread time to clear itself before we start printing
-                    std::this_thread::sleep_for(std::chrono::milliseconds(150));
-                }
+void StopSpinner(std::thread& spinnerThread) {
+    {
+        std::lock_guard<std::mutex> lock(g_consoleMutex);
+        ClearSpinnerLocked();
+    }
+    if (spinnerThread.joinable()) {
+        spinnerThread.join();
+    }
+}
 
-                // Check if this is an ASR response
-                if (chunk.find("ASR_") == 0) {
-                    // ASR responses - display immediately
-                    currentResponse = chunk;
-                    
-                    // Stop any active spinner immediately
-                    if (spinnerActive.load(std::memory_order_acquire)) {
-                        spinnerActive.store(false, std::memory_order_release);
-                        std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Let spinner clear
-                    }
-                    
-                    // Extract and display transcription text immediately
-                    if (chunk.find("ASR_INTERIM:") == 0) {
-                        std::string transcript = chunk.substr(12);
-                        if (!transcript.empty()) {
-                            // Clear spinner line and display transcription
-                            std::cout << "\r\033[K";  // Clear current line
-                            std::cout << "Transcription: " << transcript << std::endl;
-                            std::cout.flush();
-                        }
-                    } else if (chunk.find("ASR_FINAL:") == 0) {
-                        isAsrFinal = true;
-                        lastAsrFinalResponse = chunk;
-                        // Final transcription will be handled separately
-                        std::cout << "\r\033[K";  // Clear spinner line
-                        std::cout.flush();
-                        
-                        if (g_micDebugLogging) {
-                            std::cerr << "[CALLBACK_DEBUG] *** ASR_FINAL received! ***\n" << std::flush;
-                        }
-                    }
-                } else {
-                    // LLM responses - print immediately as they arrive
-                    std::cout << chunk;
-                    std::cout.flush();
-                    currentResponse += chunk;
-                }
-            }
+// ============================================================================
+// Callback Handlers
+// ============================================================================
 
-            if (pData->completed == 1) {
-                responseCompleted = true;
-                callbackFinished = true;
-                
-                // If we're waiting for ASR_FINAL, only release semaphore when we get it
-                if (waitingForAsrFinal.load(std::memory_order_acquire)) {
-                    if (isAsrFinal) {
-                        if (g_micDebugLogging) {
-                            std::cerr << "[CALLBACK_DEBUG] Releasing semaphore (ASR_FINAL received)\n" << std::flush;
-                        }
-                        responseCompleteSemaphore.release();
-                    } else {
-                        if (g_micDebugLogging) {
-                            std::cerr << "[CALLBACK_DEBUG] Waiting for ASR_FINAL, NOT releasing semaphore\n" << std::flush;
-                        }
-                    }
-                } else {
-                    // Normal mode - release on any completed response
-                    responseCompleteSemaphore.release();
-                }
-            }
-            break;
-        }
+/**
+ * Handles RISE callbacks that are not part of a request (READY, progress,
+ * installation). Request output is routed to the request's own handler.
+ */
+void OnRiseEvent(const NV_RISE_CALLBACK_DATA_V1& data) {
+    std::lock_guard<std::mutex> lock(g_consoleMutex);
 
-        case NV_RISE_CONTENT_TYPE_GRAPH:
-            currentChart += std::string(pData->content);
-            if (pData->completed == 1) {
-                std::cout << "[GRAPH DATA] " << currentChart << std::endl;
-                responseCompleted = true;
-                responseCompleteSemaphore.release();
+    switch (data.contentType) {
+        case NV_RISE_CONTENT_TYPE_READY:
+            if (data.completed == 1) {
+                std::cout << "[RISE] System is READY!" << std::endl;
             }
             break;
 
-        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR:
-        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR_RESULT:
-        {
-            // Handle custom behavior responses (show JSON content)
-            std::string customContent(pData->content);
-            if (!customContent.empty()) {
-                // Track first token if not already set
-                if (!firstTokenReceived) {
-                    firstTokenReceived = true;
-                    firstTokenTime = std::chrono::steady_clock::now();
-                    std::this_thread::sleep_for(std::chrono::milliseconds(150));
-                }
-
-                // Print custom behavior content
-                std::cout << customContent;
-                std::cout.flush();
-                currentResponse += customContent;
-            }
-
-            if (pData->completed == 1) {
-                responseCompleted = true;
-                // Signal that callback has completely finished
-                callbackFinished = true;
-                responseCompleteSemaphore.release();
-            }
+        case NV_RISE_CONTENT_TYPE_PROGRESS_UPDATE:
+            std::cout << "[PROGRESS] " << data.content << "%" << std::endl;
             break;
-        }
-
-        case NV_RISE_CONTENT_TYPE_PROGRESS_UPDATE: {
-            std::string progress(pData->content);
-            std::cout << "[PROGRESS] " << progress << "%" << std::endl;
-            break;
-        }
 
         case NV_RISE_CONTENT_TYPE_DOWNLOAD_REQUEST:
             std::cout << "[DOWNLOAD REQUESTED] RISE requires installation" << std::endl;
@@ -373,11 +174,63 @@ void RiseCallbackHandler(NV_RISE_CALLBACK_DATA_V1* pData) {
             break;
 
         default:
-            std::cout << "[UNKNOWN] Content type: " << pData->contentType << std::endl;
+            std::cout << "[UNKNOWN] Content type: " << data.contentType << std::endl;
             break;
     }
 }
 
+/**
+ * Debug logging for every callback
+ */
+void LogRiseCallback(const NV_RISE_CALLBACK_DATA_V1& data) {
+    if (!g_micDebugLogging) return;
+
+    std::string_view content = Rise::ContentView(data);
+    std::string contentPreview(content.substr(0, 80));
+    if (content.size() > 80) contentPreview += "...";
+    // Use \n at end and flush to prevent interleaving with other threads
+    std::cerr << "[CALLBACK_DEBUG] Type=" << Rise::ContentTypeName(data.contentType)
+              << ", Completed=" << (int)data.completed
+              << ", Content='" << contentPreview << "'"
+              << "\n" << std::flush;
+}
+
+/**
+ * Prints ASR interim transcriptions as they arrive
+ */
+void PrintAsrOutput(Rise::OutputKind kind, const std::string& transcript) {
+    std::lock_guard<std::mutex> lock(g_consoleMutex);
+    ClearSpinnerLocked();
+
+    if (kind == Rise::OutputKind::AsrInterim && !transcript.empty()) {
+        std::cout << "\r\033[K";  // Clear current line
+        std::cout << "Transcription: " << transcript << std::endl;
+        std::cout.flush();
+    } else if (kind == Rise::OutputKind::AsrFinal && g_micDebugLogging) {
+        std::cerr << "[CALLBACK_DEBUG] *** ASR_FINAL received! ***\n" << std::flush;
+    }
+}
+
+/**
+ * Print the final transcription of an ASR session
+ */
+void PrintFinalTranscription(const Rise::AsrSession& session) {
+    std::string finalTranscript = session.Transcript();
+    std::string fallback = session.Interim();
+
+    if (session.Succeeded()) {
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "FINAL TRANSCRIPTION:" << std::endl;
+        std::cout << "========================================" << std::endl;
+        std::cout << finalTranscript << std::endl;
+        std::cout << "========================================\n" << std::endl;
+    } else if (!fallback.empty()) {
+        std::cout << "\nFinal: " << fallback << std::endl;
+    } else {
+        std::cout << "\n[WARN] No transcription received (" << session.Error() << ")" << std::endl;
+    }
+}
+
 // ============================================================================
 // RISE API Wrapper Functions
 // ============================================================================
@@ -388,133 +241,88 @@ void RiseCallbackHandler(NV_RISE_CALLBACK_DATA_V1* pData) {
 bool InitializeRiseClient() {
     std::cout << "=== Initializing RISE Client ===" << std::endl;
 
-    // Initialize NVAPI
-    NvAPI_Status status = NvAPI_Initialize();
-    if (status != NVAPI_OK) {
-        std::cerr << "[ERROR] NvAPI_Initialize failed with status: " << status << std::endl;
-        return false;
-    }
-    std::cout << "[OK] NVAPI Initialized" << std::endl;
-
-    // Setup callback settings
-    NV_RISE_CALLBACK_SETTINGS_V1 callbackSettings = { 0 };
-    callbackSettings.version = NV_RISE_CALLBACK_SETTINGS_VER1;
-    callbackSettings.callback = RiseCallbackHandler;
+    g_riseClient.SetEventHandler(OnRiseEvent);
+    g_riseClient.SetObserver(LogRiseCallback);
+    g_riseClient.SetTracing(!g_traceDir.empty());
 
-    // Register callback
-    status = NvAPI_RegisterRiseCallback(&callbackSettings);
+    // Initialize NVAPI and register callback
+    NvAPI_Status status = g_riseClient.Connect();
     if (status != NVAPI_OK) {
-        std::cerr << "[ERROR] NvAPI_RegisterRiseCallback failed with status: " << status << std::endl;
+        std::cerr << "[ERROR] RISE client setup failed with status: " << status << std::endl;
         return false;
     }
+    std::cout << "[OK] NVAPI Initialized" << std::endl;
     std::cout << "[OK] Callback Registered" << std::endl;
 
-        // Wait for system ready signal
-        std::cout << "[WAITING] For RISE to become ready..." << std::endl;
-        while (!systemReady) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
+    // Wait for system ready signal
+    std::cout << "[WAITING] For RISE to become ready..." << std::endl;
+    while (!g_riseClient.WaitUntilReady(Rise::DEFAULT_READY_TIMEOUT)) {
+        std::cout << "[WAITING] Still waiting for RISE..." << std::endl;
+    }
 
     std::cout << "[OK] RISE Client Initialized Successfully!" << std::endl;
     return true;
 }
 
+/**
+ * Write a finished request's phases to g_traceDir, for chrome://tracing or
+ * ui.perfetto.dev
+ */
+void SaveTrace(const Rise::Request& request) {
+    std::string trace = request.ChromeTrace();
+    if (trace.empty()) return;
+
+    std::string path = g_traceDir + "/" + Rise::TraceFileName(request.TraceId());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (file.write(trace.data(), static_cast<std::streamsize>(trace.size()))) {
+        std::cout << "\n[INFO] Trace written to " << path << std::endl;
+    } else {
+        std::cerr << "\n[WARN] Could not write trace " << path << std::endl;
+    }
+}
+
 /**
  * Send LLM text request to RISE
  * This demonstrates streaming text-based AI responses
  */
 bool SendLLMRequest(const std::string& prompt) {
-    // Reset response state and start timing
-    {
-        std::lock_guard<std::mutex> lock(responseMutex);
-        currentResponse.clear();
-        currentChart.clear();
-        responseCompleted = false;
-        firstTokenReceived = false;  // Reset for each new request
-        callbackFinished = false;
-        requestStartTime = std::chrono::steady_clock::now();
-    }
-
-    // CRITICAL: Drain any leftover semaphore releases from previous requests
-    while (responseCompleteSemaphore.try_acquire()) {
-        // Drain silently
-    }
-
-    // Build JSON request
-    // Format: {"prompt": "...", "context_assist": {}, "client_config": {}}
-    std::string jsonRequest = "{\"prompt\":\"" + prompt + "\",\"context_assist\":{},\"client_config\":{}}";
-
-    // Setup request settings
-    NV_REQUEST_RISE_SETTINGS_V1 requestSettings = { 0 };
-    requestSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-    requestSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-    strncpy_s(requestSettings.content, sizeof(requestSettings.content), 
-              jsonRequest.c_str(), jsonRequest.length());
-    requestSettings.completed = 1;  // Single request, not chunked
-
-    // Send request
-    NvAPI_Status status = NvAPI_RequestRise(&requestSettings);
-    if (status != NVAPI_OK) {
-        std::cerr << "\n[ERROR] NvAPI_RequestRise failed with status: " << status << std::endl;
-        return false;
-    }
-
     // Show spinner while waiting for first token
-    spinnerActive.store(true, std::memory_order_release);
-    
-    std::thread spinnerThread([]() {
-        const char spinChars[] = { '|', '/', '-', '\\' };
-        int idx = 0;
-        
-        // Small delay to ensure we see the initialized value
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        
-        // firstTokenReceived is a global, access it directly
-        while (spinnerActive.load(std::memory_order_acquire) && !firstTokenReceived) {
-            std::cout << "\r" << spinChars[idx % 4] << " ";
+    std::thread spinnerThread = StartSpinner("");
+
+    // Streamed output is printed as it arrives; the first chunk clears the spinner
+    auto request = g_riseClient.SubmitLlm(prompt, [](Rise::OutputKind kind, const std::string& chunk) {
+        std::lock_guard<std::mutex> lock(g_consoleMutex);
+        ClearSpinnerLocked();
+        if (kind != Rise::OutputKind::Graph) {
+            std::cout << chunk;
             std::cout.flush();
-            idx++;
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-        
-        // Clear spinner when done
-        std::cout << "\r   \r";
-        std::cout.flush();
     });
 
-    // Wait for response completion (streaming prints in callback)
-    responseCompleteSemaphore.acquire();
+    // Wait for response completion (the request finishes after its last output was printed)
+    const auto TIMEOUT = std::chrono::seconds(120);
+    bool finished = request->Wait(TIMEOUT);
+    StopSpinner(spinnerThread);
 
-    // Stop spinner (it should have already stopped when first token arrived)
-    spinnerActive.store(false, std::memory_order_release);
-    spinnerThread.join();
-
-    // Wait for callback to signal it has completely finished printing
-    {
-        std::unique_lock<std::mutex> lock(responseMutex);
-        while (!callbackFinished) {
-            lock.unlock();
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            lock.lock();
-        }
+    if (!finished) {
+        g_riseClient.Cancel(request, "timeout");
+        std::cerr << "\n[ERROR] Timed out waiting for response" << std::endl;
+        SaveTrace(*request);
+        return false;
+    }
+    SaveTrace(*request);
+    if (!request->Succeeded()) {
+        std::cerr << "\n[ERROR] " << request->Error() << std::endl;
+        return false;
     }
 
-    // Calculate TTFT - this should now be available since callback has finished
-    double ttft = 0.0;
-    {
-        std::lock_guard<std::mutex> lock(responseMutex);
-        if (firstTokenReceived) {
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                firstTokenTime - requestStartTime
-            );
-            ttft = duration.count() / 1000.0;
-        } else {
-            // This shouldn't happen, but handle gracefully
-            ttft = 0.0;
-        }
+    std::string chart = request->Chart();
+    if (!chart.empty()) {
+        std::cout << "\n[GRAPH DATA] " << chart << std::endl;
     }
 
-    // Display TTFT metric (callback has finished printing all text)
+    // Display TTFT metric (measured from when the prompt reached the engine)
+    double ttft = request->Timings().TimeToFirstTokenMs() / 1000.0;
     std::cout << "\n\n[TTFT: " << std::fixed << std::setprecision(3)
               << ttft << "s]" << std::endl;
 
@@ -555,104 +363,6 @@ void DemoLLMChat() {
     }
 }
 
-// ============================================================================
-// WAV File Utilities
-// ============================================================================
-
-#pragma pack(push, 1)
-struct WavHeader {
-    char riff[4];           // "RIFF"
-    uint32_t fileSize;      // File size - 8
-    char wave[4];           // "WAVE"
-    char fmt[4];            // "fmt "
-    uint32_t fmtSize;       // 16 for PCM
-    uint16_t audioFormat;   // 1 for PCM
-    uint16_t channels;
-    uint32_t sampleRate;
-    uint32_t byteRate;
-    uint16_t blockAlign;
-    uint16_t bitsPerSample;
-    char data[4];           // "data"
-    uint32_t dataSize;      // Size of audio data
-};
-#pragma pack(pop)
-
-/**
- * Load PCM data from WAV file
- */
-bool LoadWavFile(const std::string& filename, std::vector<int16_t>& samples, int& sampleRate, int& channels) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "[ERROR] Could not open file: " << filename << std::endl;
-        return false;
-    }
-
-    // Read WAV header
-    WavHeader header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(WavHeader));
-
-    // Validate WAV header
-    if (std::strncmp(header.riff, "RIFF", 4) != 0 || std::strncmp(header.wave, "WAVE", 4) != 0) {
-        std::cerr << "[ERROR] Invalid WAV file format" << std::endl;
-        return false;
-    }
-
-    if (header.audioFormat != 1) {
-        std::cerr << "[ERROR] Only PCM audio format supported" << std::endl;
-        return false;
-    }
-
-    if (header.bitsPerSample != 16) {
-        std::cerr << "[ERROR] Only 16-bit audio supported" << std::endl;
-        return false;
-    }
-
-    sampleRate = header.sampleRate;
-    channels = header.channels;
-
-    // Read audio data
-    size_t numSamples = header.dataSize / sizeof(int16_t);
-    samples.resize(numSamples);
-    file.read(reinterpret_cast<char*>(samples.data()), header.dataSize);
-
-    file.close();
-
-    std::cout << "[INFO] Loaded WAV file:" << std::endl;
-    std::cout << "  Sample Rate: " << sampleRate << " Hz" << std::endl;
-    std::cout << "  Channels: " << channels << std::endl;
-    std::cout << "  Samples: " << numSamples << std::endl;
-    std::cout << "  Duration: " << std::fixed << std::setprecision(2) 
-              << (numSamples / (double)(sampleRate * channels)) << " seconds" << std::endl;
-
-    return true;
-}
-
-/**
- * Base64 encode audio data
- */
-std::string Base64Encode(const uint8_t* data, size_t length) {
-    static const char base64_chars[] =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/";
-
-    std::string result;
-    result.reserve(((length + 2) / 3) * 4);
-
-    for (size_t i = 0; i < length; i += 3) {
-        uint32_t val = data[i] << 16;
-        if (i + 1 < length) val |= data[i + 1] << 8;
-        if (i + 2 < length) val |= data[i + 2];
-
-        result += base64_chars[(val >> 18) & 0x3F];
-        result += base64_chars[(val >> 12) & 0x3F];
-        result += (i + 1 < length) ? base64_chars[(val >> 6) & 0x3F] : '=';
-        result += (i + 2 < length) ? base64_chars[val & 0x3F] : '=';
-    }
-
-    return result;
-}
-
 /**
  * Demo: ASR Streaming with real WAV file
  */
@@ -664,7 +374,7 @@ void DemoASRStreaming() {
     std::cout << "Stream audio from a WAV file and get speech-to-text transcription\n" << std::endl;
 
     // Prompt for WAV file path
-    std::cout << "Enter path to WAV file (16-bit PCM): ";
+    std::cout << "Enter path to WAV file (PCM or float, any channel count): ";
     std::string wavPath;
     std::getline(std::cin, wavPath);
 
@@ -675,218 +385,109 @@ void DemoASRStreaming() {
         return;
     }
 
-    // Load WAV file
-    std::vector<int16_t> audioSamples;
-    int sampleRate = 0;
-    int channels = 0;
+    // Open the WAV file; samples are streamed from disk while sending, and
+    // sources above 16 kHz are resampled to it so fewer chunks are needed
+    AudioUtils::WavStream stream;
+    std::string wavError;
 
-    if (!LoadWavFile(wavPath, audioSamples, sampleRate, channels)) {
+    if (!stream.Open(wavPath, AudioUtils::DEFAULT_SAMPLE_RATE, &wavError)) {
+        std::cerr << "[ERROR] " << wavError << ": " << wavPath << std::endl;
         std::cout << "\n[ERROR] Failed to load WAV file" << std::endl;
         std::cout << "Press Enter to continue...";
         std::cin.get();
         return;
     }
 
-    // Convert stereo to mono if needed
-    if (channels == 2) {
-        std::cout << "[INFO] Converting stereo to mono..." << std::endl;
-        std::vector<int16_t> mono;
-        mono.reserve(audioSamples.size() / 2);
-        for (size_t i = 0; i + 1 < audioSamples.size(); i += 2) {
-            int32_t avg = (static_cast<int32_t>(audioSamples[i]) + audioSamples[i + 1]) / 2;
-            mono.push_back(static_cast<int16_t>(avg));
-        }
-        audioSamples = mono;
-        channels = 1;
+    const WavReader& wav = stream.Source();
+    const int sampleRate = stream.SampleRate();
+    std::cout << "[INFO] Opened WAV file:" << std::endl;
+    std::cout << "  Sample Rate: " << wav.SampleRate() << " Hz" << std::endl;
+    std::cout << "  Channels: " << wav.Channels() << std::endl;
+    std::cout << "  Format: " << wav.BitsPerSample() << "-bit "
+              << (wav.GetEncoding() == WavReader::Encoding::Float ? "float" : "PCM") << std::endl;
+    std::cout << "  Frames: " << wav.TotalFrames() << std::endl;
+    std::cout << "  Duration: " << std::fixed << std::setprecision(2)
+              << wav.DurationSeconds() << " seconds" << std::endl;
+
+    if (wav.Channels() > 1) {
+        std::cout << "[INFO] Downmixing " << wav.Channels() << " channels to mono while streaming" << std::endl;
     }
 
-    // NOTE: Resampling is NOT needed - the engine handles resampling to 16kHz automatically
-    // Client can send audio at any sample rate (e.g. 44.1kHz, 48kHz, etc.)
-    std::cout << "[INFO] Audio will be sent at " << sampleRate << " Hz (engine will resample if needed)" << std::endl;
-
-    // Calculate chunk size - must account for base64 encoding AND payload overhead
-    // Python uses float32 (4 bytes per sample), not int16 (2 bytes)
-    // API has 4096 byte limit. Base64 encoding increases size by 4/3.
-    // Format: "CHUNK:ID:16000:base64data" adds ~20 bytes overhead
-    // Working backwards: 4096 - 20 = 4076 max base64 bytes
-    // 4076 / (4/3) = 3057 max raw bytes = 764 float32 samples
-    // Python uses 700 samples per chunk - let's match that
-    const int SAFE_SAMPLES_PER_CHUNK = 700;  // Match Python's chunk size
-    const int NUM_CHUNKS = (audioSamples.size() + SAFE_SAMPLES_PER_CHUNK - 1) / SAFE_SAMPLES_PER_CHUNK;
-    const int chunkBytes = SAFE_SAMPLES_PER_CHUNK * sizeof(float);  // 2800 bytes (float32)
-    const int base64Bytes = ((chunkBytes + 2) / 3) * 4;  // ~3734 bytes
-    const int totalPayload = base64Bytes + 20;  // ~3754 bytes (well under 4096)
+    // The engine accepts any rate, but downsampling here means the same audio
+    // fits in fewer chunks (a third as many for 48 kHz)
+    if (stream.IsResampling()) {
+        std::cout << "[INFO] Resampling " << wav.SampleRate() << " Hz to " << sampleRate << " Hz while streaming" << std::endl;
+    } else {
+        std::cout << "[INFO] Audio will be sent at " << sampleRate << " Hz (engine will resample if needed)" << std::endl;
+    }
+
+    // Pipelined send: keep up to ASR_CHUNK_WINDOW chunks in flight and only
+    // wait when the window is full
+    const size_t ASR_CHUNK_WINDOW = ChunkWindow::DEFAULT_CAPACITY;
+    const size_t CHUNKS_PER_PROGRESS = 10;
+    auto session = g_riseClient.StartAsr(sampleRate, ASR_CHUNK_WINDOW, PrintAsrOutput, g_chunkEncoding);
+
+    // Chunk size - the request content is limited to 4096 bytes and base64
+    // grows the audio by 4/3, after a "CHUNK:ID:RATE:" header of ~20 bytes.
+    // Float32 chunks are 700 samples like the Python client (764 would
+    // fit); int16 chunks ("CHUNK16:", --chunk-format int16) are sized to the
+    // limit and carry 1522 samples, so half as many requests are needed
+    const size_t SAFE_SAMPLES_PER_CHUNK = session->ChunkSamples();
+    const uint64_t NUM_CHUNKS = (stream.TotalSamples() + SAFE_SAMPLES_PER_CHUNK - 1) / SAFE_SAMPLES_PER_CHUNK;
+    const size_t chunkBytes = SAFE_SAMPLES_PER_CHUNK * Rise::ChunkBytesPerSample(session->Encoding());
+    const size_t totalPayload = Base64::EncodedLength(chunkBytes) + 20;
     
-    std::cout << "[INFO] Using " << SAFE_SAMPLES_PER_CHUNK << " samples per chunk (~" 
-              << (SAFE_SAMPLES_PER_CHUNK * 1000 / 16000) << " ms)" << std::endl;
+    std::cout << "[INFO] Using " << SAFE_SAMPLES_PER_CHUNK << " " << Rise::ChunkEncodingName(session->Encoding())
+              << " samples per chunk (~" << (SAFE_SAMPLES_PER_CHUNK * 1000 / sampleRate) << " ms)" << std::endl;
     std::cout << "[INFO] Estimated payload size: ~" << totalPayload << " bytes (limit: 4096)" << std::endl;
 
     std::cout << "\n[INFO] Streaming audio for transcription..." << std::endl;
     std::cout << "========================================\n" << std::endl;
 
-    // Drain semaphore before starting
-    while (responseCompleteSemaphore.try_acquire()) {}
-
-    // Send audio chunks
-    for (int chunkId = 0; chunkId < NUM_CHUNKS; chunkId++) {
-        size_t startSample = chunkId * SAFE_SAMPLES_PER_CHUNK;
-        size_t endSample = std::min(startSample + SAFE_SAMPLES_PER_CHUNK, audioSamples.size());
-        size_t chunkSize = endSample - startSample;
-
-        // Convert int16 samples to float32 (normalized -1.0 to +1.0)
-        // This matches Python: pcm_float = [float(s) / 32768.0 for s in pcm_data]
-        std::vector<float> floatSamples(chunkSize, 0.0f);  // Initialize to zero
-        for (size_t i = 0; i < chunkSize; i++) {
-            int16_t sample = audioSamples[startSample + i];
-            float floatSample = static_cast<float>(sample) / 32768.0f;
-            
-            // Validate and clamp the result
-            if (std::isnan(floatSample) || std::isinf(floatSample)) {
-                std::cerr << "\n[ERROR] Invalid float at index " << i << " from int16 " << sample << std::endl;
-                floatSample = 0.0f;  // Replace with silence
-            }
-            
-            // Clamp to valid range
-            if (floatSample > 1.0f) floatSample = 1.0f;
-            if (floatSample < -1.0f) floatSample = -1.0f;
-            
-            floatSamples[i] = floatSample;
-        }
-
-        // Get float32 bytes
-        const uint8_t* chunkData = reinterpret_cast<const uint8_t*>(floatSamples.data());
-        size_t chunkBytes = chunkSize * sizeof(float);
-
-        // Encode to base64
-        std::string base64Audio = Base64Encode(chunkData, chunkBytes);
-
-        // Reset for this chunk
-        {
-            std::lock_guard<std::mutex> lock(responseMutex);
-            currentResponse.clear();
-            responseCompleted = false;
-            firstTokenReceived = false;
-            callbackFinished = false;
-        }
-
-        // Format: "CHUNK:<id>:<sample_rate>:<base64_data>"
-        // Note: Sample rate can be anything - engine will resample to 16kHz if needed
-        std::string payload = "CHUNK:" + std::to_string(chunkId) + ":" + std::to_string(sampleRate) + ":" + base64Audio;
-
-        // Validate payload size (silent check)
-        if (payload.length() >= sizeof(NV_REQUEST_RISE_SETTINGS_V1::content)) {
-            std::cerr << "\n[ERROR] Payload too large: " << payload.length() 
-                      << " bytes (max: " << sizeof(NV_REQUEST_RISE_SETTINGS_V1::content) << ")" << std::endl;
-            break;
-        }
-
-        // Setup request
-        NV_REQUEST_RISE_SETTINGS_V1 requestSettings = { 0 };
-        requestSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-        requestSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-        strncpy_s(requestSettings.content, sizeof(requestSettings.content), 
-                  payload.c_str(), payload.length());
-        requestSettings.completed = 0;  // More chunks coming
-
-        // Send chunk (silent)
-        NvAPI_Status status = NvAPI_RequestRise(&requestSettings);
-        if (status != NVAPI_OK) {
-            std::cerr << "\n[ERROR] Failed to send audio chunk" << std::endl;
-            break;
-        }
-
-        // Show spinner while waiting for response (callback will stop it and display text)
-        spinnerActive.store(true, std::memory_order_release);
-        std::thread spinnerThread([chunkId, NUM_CHUNKS]() {
-            const char spinChars[] = { '|', '/', '-', '\\' };
-            int idx = 0;
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            
-            while (spinnerActive.load(std::memory_order_acquire)) {
-                // Show progress with spinner
-                std::cout << "\r" << spinChars[idx % 4] << " Processing chunk " 
-                          << (chunkId + 1) << "/" << NUM_CHUNKS << "...   ";
-                std::cout.flush();
-                idx++;
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
-            
-            // Clear spinner when done
-            std::cout << "\r\033[K";
-            std::cout.flush();
-        });
-
-        // Wait for interim response (callback displays it immediately)
-        responseCompleteSemaphore.acquire();
-
-        // Stop spinner and wait for it to clean up
-        spinnerActive.store(false, std::memory_order_release);
-        spinnerThread.join();
-
-        // Small delay between chunks
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // Read and send audio chunks, a few at a time so progress can be shown;
+    // only this block of samples is ever in memory
+    const size_t samplesPerStep = CHUNKS_PER_PROGRESS * SAFE_SAMPLES_PER_CHUNK;
+    std::vector<float> stepSamples(samplesPerStep);
+    uint64_t samplesSent = 0;
+    bool sent = true;
+    while (sent) {
+        size_t count = stream.Read(stepSamples.data(), samplesPerStep);
+        if (count == 0) break;
+        sent = session->SendAudio(stepSamples.data(), count);
+        samplesSent += count;
+
+        uint64_t chunksSent = (samplesSent + SAFE_SAMPLES_PER_CHUNK - 1) / SAFE_SAMPLES_PER_CHUNK;
+        std::lock_guard<std::mutex> lock(g_consoleMutex);
+        std::cout << "\r\033[KSent chunk " << chunksSent;
+        if (NUM_CHUNKS > 0) std::cout << "/" << NUM_CHUNKS;
+        std::cout << std::flush;
+    }
+
+    if (!sent) {
+        std::cerr << "\n[ERROR] " << session->Error() << std::endl;
+        std::cout << "\nPress Enter to continue...";
+        std::cin.get();
+        return;
     }
 
     // Send STOP to get final transcription
-    std::cout << "\n[INFO] Finalizing transcription..." << std::endl;
+    std::cout << "\r\033[K[INFO] Finalizing transcription..." << std::endl;
 
-    // Drain semaphore
-    while (responseCompleteSemaphore.try_acquire()) {}
+    // Show spinner while waiting for final transcription
+    std::thread finalSpinnerThread = StartSpinner("Generating final transcription...   ");
+    const auto FINAL_TIMEOUT = std::chrono::seconds(15);
+    session->Finish(FINAL_TIMEOUT);
+    StopSpinner(finalSpinnerThread);
 
-    {
-        std::lock_guard<std::mutex> lock(responseMutex);
-        currentResponse.clear();
-        responseCompleted = false;
-        firstTokenReceived = false;
-        callbackFinished = false;
-    }
+    ChunkWindow::Stats chunkStats = session->ChunkStats();
+    std::cout << "[INFO] Streamed " << chunkStats.acknowledged << " chunks in "
+              << std::fixed << std::setprecision(2) << chunkStats.elapsedSeconds << " s ("
+              << chunkStats.chunksPerSecond << " chunks/s, window " << ASR_CHUNK_WINDOW
+              << ", mean ack " << chunkStats.meanAckMs << " ms)" << std::endl;
+    std::cout << std::defaultfloat;
 
-    NV_REQUEST_RISE_SETTINGS_V1 stopSettings = { 0 };
-    stopSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-    stopSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-    strncpy_s(stopSettings.content, sizeof(stopSettings.content), "STOP:", 5);
-    stopSettings.completed = 0;
-
-    NvAPI_Status status = NvAPI_RequestRise(&stopSettings);
-    if (status == NVAPI_OK) {
-        // Show spinner while waiting for final transcription
-        spinnerActive.store(true, std::memory_order_release);
-        std::thread finalSpinnerThread([]() {
-            const char spinChars[] = { '|', '/', '-', '\\' };
-            int idx = 0;
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            
-            while (spinnerActive.load(std::memory_order_acquire)) {
-                std::cout << "\r" << spinChars[idx % 4] << " Generating final transcription...   ";
-                std::cout.flush();
-                idx++;
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
-            
-            std::cout << "\r" << std::string(60, ' ') << "\r";
-            std::cout.flush();
-        });
-
-        responseCompleteSemaphore.acquire();
-
-        // Stop spinner
-        spinnerActive.store(false, std::memory_order_release);
-        finalSpinnerThread.join();
-
-        std::lock_guard<std::mutex> lock(responseMutex);
-        if (currentResponse.find("ASR_FINAL:") == 0) {
-            std::string finalTranscript = currentResponse.substr(10);
-            std::cout << "\n========================================" << std::endl;
-            std::cout << "FINAL TRANSCRIPTION:" << std::endl;
-            std::cout << "========================================" << std::endl;
-            std::cout << finalTranscript << std::endl;
-            std::cout << "========================================\n" << std::endl;
-        } else if (!currentResponse.empty()) {
-            std::cout << "\nFinal: " << currentResponse << std::endl;
-        }
-    } else {
-        std::cerr << "\n[ERROR] Failed to send STOP signal" << std::endl;
-    }
+    PrintFinalTranscription(*session);
+    SaveTrace(*session);
 
     std::cout << "\nPress Enter to continue...";
     std::cin.get();
@@ -903,59 +504,49 @@ void DemoASRMicrophone() {
     std::cout << "===============================================================" << std::endl;
 
     // -------------------------------------------------------------------------
-    // Step 1: Enumerate available microphones
+    // Step 1: List available microphones (enumerated once, then cached)
     // -------------------------------------------------------------------------
-    ma_context context;
-    if (ma_context_init(NULL, 0, NULL, &context) != MA_SUCCESS) {
-        std::cerr << "[ERROR] Failed to initialize audio context." << std::endl;
-        std::cout << "Press Enter to continue...";
-        std::cin.get();
-        return;
-    }
-
-    ma_device_info* pCaptureDevices;
-    ma_uint32 captureDeviceCount;
-    ma_device_info* pPlaybackDevices;
-    ma_uint32 playbackDeviceCount;
-
-    if (ma_context_get_devices(&context, &pPlaybackDevices, &playbackDeviceCount,
-                               &pCaptureDevices, &captureDeviceCount) != MA_SUCCESS) {
-        std::cerr << "[ERROR] Failed to enumerate audio devices." << std::endl;
-        ma_context_uninit(&context);
-        std::cout << "Press Enter to continue...";
-        std::cin.get();
-        return;
-    }
-
-    if (captureDeviceCount == 0) {
-        std::cerr << "[ERROR] No microphones found on this system." << std::endl;
-        ma_context_uninit(&context);
+    const std::vector<MicCapture::Device>* devices = &g_mic.Devices();
+    if (devices->empty()) {
+        std::cerr << "[ERROR] " << (g_mic.LastError().empty() ? "No microphones found on this system." : g_mic.LastError())
+                  << std::endl;
         std::cout << "Press Enter to continue...";
         std::cin.get();
         return;
     }
 
-    std::cout << "\nAvailable Microphones:" << std::endl;
-    std::cout << "----------------------------------------" << std::endl;
-    for (ma_uint32 i = 0; i < captureDeviceCount; i++) {
-        std::cout << "  [" << i << "] " << pCaptureDevices[i].name;
-        if (pCaptureDevices[i].isDefault) {
-            std::cout << " (default)";
-        }
-        std::cout << std::endl;
-    }
-    std::cout << "----------------------------------------" << std::endl;
-
     // -------------------------------------------------------------------------
     // Step 2: Let user select a microphone
     // -------------------------------------------------------------------------
-    std::cout << "\nEnter microphone number (or press Enter for default): ";
     std::string micChoice;
-    std::getline(std::cin, micChoice);
+    while (true) {
+        std::cout << "\nAvailable Microphones:" << std::endl;
+        std::cout << "----------------------------------------" << std::endl;
+        for (size_t i = 0; i < devices->size(); i++) {
+            std::cout << "  [" << i << "] " << (*devices)[i].name;
+            if ((*devices)[i].isDefault) {
+                std::cout << " (default)";
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "----------------------------------------" << std::endl;
+
+        std::cout << "\nEnter microphone number, 'r' to rescan (or press Enter for default): ";
+        std::getline(std::cin, micChoice);
+        if (micChoice != "r" && micChoice != "R") {
+            break;
+        }
 
-    ma_device_id* pSelectedDeviceId = nullptr;
-    std::string selectedDeviceName = "(default)";
+        devices = &g_mic.Devices(true);
+        if (devices->empty()) {
+            std::cerr << "[ERROR] No microphones found on this system." << std::endl;
+            std::cout << "Press Enter to continue...";
+            std::cin.get();
+            return;
+        }
+    }
 
+    const MicCapture::Device* selectedDevice = nullptr;
     if (!micChoice.empty()) {
         int micIndex = -1;
         try {
@@ -964,115 +555,63 @@ void DemoASRMicrophone() {
             micIndex = -1;
         }
 
-        if (micIndex >= 0 && micIndex < (int)captureDeviceCount) {
-            pSelectedDeviceId = &pCaptureDevices[micIndex].id;
-            selectedDeviceName = pCaptureDevices[micIndex].name;
+        if (micIndex >= 0 && micIndex < (int)devices->size()) {
+            selectedDevice = &(*devices)[micIndex];
         } else {
             std::cout << "[WARN] Invalid selection, using default microphone." << std::endl;
         }
     }
 
     // -------------------------------------------------------------------------
-    // Step 3: Initialize the selected microphone
+    // Step 3: Open the selected microphone; still running if it was used last
     // -------------------------------------------------------------------------
     std::cout << "\nStarting real-time transcription..." << std::endl;
 
-    ma_device_config deviceConfig;
-    ma_device device;
-
-    deviceConfig = ma_device_config_init(ma_device_type_capture);
-    deviceConfig.capture.pDeviceID = pSelectedDeviceId;  // NULL = default, or specific device
-    deviceConfig.capture.format    = ma_format_f32;      // Float32 samples
-    deviceConfig.capture.channels  = MIC_CHANNELS;       // Mono
-    deviceConfig.sampleRate        = MIC_SAMPLE_RATE;    // 16kHz
-    deviceConfig.dataCallback      = MicrophoneDataCallback;
-    deviceConfig.pUserData         = nullptr;
-
-    if (ma_device_init(&context, &deviceConfig, &device) != MA_SUCCESS) {
-        std::cerr << "[ERROR] Failed to initialize microphone device." << std::endl;
-        ma_context_uninit(&context);
+    if (!g_mic.Open(selectedDevice)) {
+        std::cerr << "[ERROR] " << g_mic.LastError() << "." << std::endl;
         std::cout << "Press Enter to continue...";
         std::cin.get();
         return;
     }
 
-    std::cout << "[INFO] Microphone: " << device.capture.name << std::endl;
-    std::cout << "[INFO] Requested Sample Rate: " << MIC_SAMPLE_RATE << " Hz, Channels: " << MIC_CHANNELS << std::endl;
-    std::cout << "[INFO] Actual Device Sample Rate: " << device.sampleRate << " Hz" << std::endl;
-    std::cout << "[INFO] Actual Device Format: " << device.capture.format << " (1=u8, 2=s16, 3=s24, 4=s32, 5=f32)" << std::endl;
-    
-    if (device.sampleRate != MIC_SAMPLE_RATE) {
-        std::cout << "[WARN] Sample rate mismatch! Device uses " << device.sampleRate 
-                  << " Hz but we requested " << MIC_SAMPLE_RATE << " Hz" << std::endl;
-        std::cout << "[WARN] Miniaudio will resample, but quality may be affected" << std::endl;
+    std::cout << "[INFO] Microphone: " << g_mic.DeviceName() << std::endl;
+    if (g_mic.WasWarm()) {
+        std::cout << "[INFO] Device already running from the previous session" << std::endl;
+    } else {
+        std::cout << "[INFO] Device started in " << static_cast<int>(g_mic.StartMs()) << " ms" << std::endl;
     }
-
-    // Clear buffer and start capture
-    {
-        std::lock_guard<std::mutex> lock(micBufferMutex);
-        micBuffer.clear();
+    std::cout << "[INFO] Device: " << g_mic.DeviceRate() << " Hz, format " << g_mic.DeviceFormat()
+              << " (1=u8, 2=s16, 3=s24, 4=s32, 5=f32), " << g_mic.PeriodFrames() << " frames x "
+              << g_mic.Periods() << " periods, " << (g_mic.IsExclusive() ? "exclusive" : "shared") << " mode" << std::endl;
+    if (g_mic.IsResampling()) {
+        std::cout << "[INFO] Resampling " << g_mic.DeviceRate() << " Hz to " << MIC_SAMPLE_RATE << " Hz" << std::endl;
     }
-    
-    // Reset counters and RMS tracking
-    g_callbackCount.store(0, std::memory_order_release);
-    g_lastRms.store(0.0f, std::memory_order_release);
-    g_micStartTime = std::chrono::steady_clock::now();
-    
-    micCaptureActive.store(true, std::memory_order_release);
-    
-    if (g_micDebugLogging) {
-        std::cerr << "[MIC_DEBUG] micCaptureActive set to TRUE\n" << std::flush;
+    if (g_micConfig.exclusive && !g_mic.IsExclusive()) {
+        std::cout << "[WARN] Exclusive mode was refused; using shared mode" << std::endl;
     }
 
+    // Clear buffer and start forwarding samples to it
+    g_mic.BeginSession();
+
     // -------------------------------------------------------------------------
-    // Quick mic check: ACTUAL AUDIO must start flowing within 500ms
-    // This includes the time for ma_device_start() which can block on Bluetooth
+    // Quick mic check: ACTUAL AUDIO must start flowing within the timeout.
+    // Device start is not counted (Bluetooth headsets can take over a second
+    // to switch profiles); a device kept open from the last session passes
+    // at once.
     // -------------------------------------------------------------------------
-    const int MIC_READY_TIMEOUT_MS = 500;
     const int CHECK_INTERVAL_MS = 10;
     const float RMS_THRESHOLD = 0.0005f;  // Very low threshold - just needs to be non-silent
     
-    // Start timer BEFORE device start (Bluetooth init can take seconds)
     auto checkStart = std::chrono::steady_clock::now();
     
-    if (ma_device_start(&device) != MA_SUCCESS) {
-        std::cerr << "[ERROR] Failed to start microphone." << std::endl;
-        ma_device_uninit(&device);
-        std::cout << "Press Enter to continue...";
-        std::cin.get();
-        return;
-    }
-    
-    auto deviceStartTime = std::chrono::steady_clock::now();
-    auto deviceStartMs = std::chrono::duration_cast<std::chrono::milliseconds>(deviceStartTime - checkStart).count();
-    
-    if (g_micDebugLogging) {
-        std::cerr << "[MIC_DEBUG] ma_device_start() took " << deviceStartMs << "ms\n" << std::flush;
-    }
-    
-    // If device start already took longer than timeout, reject immediately
-    if (deviceStartMs >= MIC_READY_TIMEOUT_MS) {
-        std::cout << "\n[ERROR] Microphone did not respond within " << MIC_READY_TIMEOUT_MS << "ms" << std::endl;
-        std::cout << "[INFO] Please select a different microphone." << std::endl;
-        
-        micCaptureActive.store(false, std::memory_order_release);
-        ma_device_stop(&device);
-        ma_device_uninit(&device);
-        ma_context_uninit(&context);
-        
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
-        return;
-    }
-    
     // Wait for actual audio (non-silence) to arrive
     int checkIterations = 0;
     while (true) {
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now() - checkStart).count();
         
-        float currentRms = g_lastRms.load(std::memory_order_acquire);
-        int callbacks = g_callbackCount.load(std::memory_order_acquire);
+        float currentRms = g_mic.LastRms();
+        int callbacks = g_mic.Callbacks();
         
         // Debug: log every 100ms
         if (g_micDebugLogging && checkIterations % 10 == 0) {
@@ -1090,18 +629,17 @@ void DemoASRMicrophone() {
             break;  // Got real audio!
         }
         
-        if (elapsed >= MIC_READY_TIMEOUT_MS) {
-            std::cout << "\n[ERROR] Microphone did not respond within " << MIC_READY_TIMEOUT_MS << "ms" << std::endl;
-            std::cout << "[INFO] Please select a different microphone." << std::endl;
+        if (elapsed >= g_micReadyTimeoutMs) {
+            std::cout << "\n[ERROR] Microphone did not respond within " << g_micReadyTimeoutMs << "ms" << std::endl;
+            std::cout << "[INFO] Please select a different microphone (or raise --mic-timeout)." << std::endl;
             
             if (g_micDebugLogging) {
                 std::cerr << "[MIC_DEBUG] Final state: callbacks=" << callbacks << ", RMS=" << currentRms << "\n" << std::flush;
             }
             
-            micCaptureActive.store(false, std::memory_order_release);
-            ma_device_stop(&device);
-            ma_device_uninit(&device);
-            ma_context_uninit(&context);
+            // Not kept open: a silent device is not worth keeping warm
+            g_mic.EndSession();
+            g_mic.Close();
             
             std::cout << "\nPress Enter to continue...";
             std::cin.get();
@@ -1111,156 +649,107 @@ void DemoASRMicrophone() {
         std::this_thread::sleep_for(std::chrono::milliseconds(CHECK_INTERVAL_MS));
     }
     
-    auto readyTime = std::chrono::steady_clock::now();
-    auto readyMs = std::chrono::duration_cast<std::chrono::milliseconds>(readyTime - checkStart).count();
-    
     if (g_micDebugLogging) {
-        std::cerr << "[MIC_DEBUG] Microphone ready in " << readyMs << "ms (RMS=" << g_lastRms.load() << ")\n" << std::flush;
+        auto readyMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - checkStart).count();
+        std::cerr << "[MIC_DEBUG] Microphone ready in " << readyMs << "ms (RMS=" << g_mic.LastRms() << ")\n" << std::flush;
     }
 
-    // Drain semaphore before starting
-    while (responseCompleteSemaphore.try_acquire()) {}
+    // Session holds the engine until the final transcription
+    auto session = g_riseClient.StartAsr(MIC_SAMPLE_RATE, ChunkWindow::DEFAULT_CAPACITY, PrintAsrOutput, g_chunkEncoding);
     
     if (g_micDebugLogging) {
-        std::cerr << "[MIC_DEBUG] Semaphore drained, entering main loop\n" << std::flush;
+        std::cerr << "[MIC_DEBUG] ASR session #" << session->Id() << " queued, entering main loop\n" << std::flush;
     }
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "Recording... (Press ENTER to stop)" << std::endl;
     std::cout << "========================================\n" << std::endl;
 
-    const int SAMPLES_PER_CHUNK = 700;  // Match WAV demo chunk size (~44ms at 16kHz)
+    if (g_micVoiceGate) {
+        std::cout << "[INFO] Voice gate on: silence below RMS " << g_micVoiceGateConfig.openThreshold
+                  << " is not sent (--no-vad to disable)" << std::endl;
+    }
+
+    const size_t SAMPLES_PER_CHUNK = session->ChunkSamples();  // Same as the WAV demo (~44ms at 16kHz for float32)
     int chunkId = 0;
 
-    // Thread to check for Enter key press
+    // Thread to check for Enter key press; wakes the send loop right away
     std::atomic<bool> stopRequested(false);
     std::thread inputThread([&stopRequested]() {
         std::cin.get();
         stopRequested.store(true, std::memory_order_release);
+        micBuffer.Wake();
     });
 
-    // Main loop: pull samples from buffer, send to API
-    int loopIteration = 0;
-    int waitCount = 0;
+    // Main loop: pull chunks from the buffer, gate them, send to API
+    MicSender sender(micBuffer, SAMPLES_PER_CHUNK, g_micVoiceGate, g_micVoiceGateConfig);
     auto loopStartTime = std::chrono::steady_clock::now();
-    
-    while (!stopRequested.load(std::memory_order_acquire)) {
-        std::vector<float> chunkSamples;
-        size_t currentBufferSize = 0;
-
-        // Try to get a chunk of samples
-        {
-            std::lock_guard<std::mutex> lock(micBufferMutex);
-            currentBufferSize = micBuffer.size();
-            if (micBuffer.size() >= SAMPLES_PER_CHUNK) {
-                chunkSamples.assign(micBuffer.begin(), micBuffer.begin() + SAMPLES_PER_CHUNK);
-                micBuffer.erase(micBuffer.begin(), micBuffer.begin() + SAMPLES_PER_CHUNK);
-            }
-        }
-
-        if (chunkSamples.empty()) {
-            // Not enough samples yet, wait a bit
-            waitCount++;
-            if (g_micDebugLogging && (waitCount <= 10 || waitCount % 50 == 0)) {
-                auto now = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - loopStartTime).count();
-                std::cerr << "[MIC_DEBUG] Loop wait #" << waitCount 
-                          << " @ " << elapsed << "ms"
-                          << ": bufferSize=" << currentBufferSize 
-                          << ", need=" << SAMPLES_PER_CHUNK 
-                          << ", callbacks=" << g_callbackCount.load()
-                          << std::endl;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(20));
-            continue;
-        }
 
-        loopIteration++;
-        
-        // Calculate RMS of chunk being sent
-        float chunkRms = 0.0f;
-        for (const auto& sample : chunkSamples) {
-            chunkRms += sample * sample;
-        }
-        chunkRms = std::sqrt(chunkRms / chunkSamples.size());
-        
-        if (g_micDebugLogging && (loopIteration <= 5 || loopIteration % 20 == 0)) {
+    // Encode and send one chunk; blocks only while the chunk window is full
+    auto sendChunk = [&](const float* samples, size_t count) {
+        bool logChunk = g_micDebugLogging && (chunkId < 5 || chunkId % 20 == 0);
+        if (logChunk) {
             auto now = std::chrono::steady_clock::now();
             auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - loopStartTime).count();
             std::cerr << "[MIC_DEBUG] Sending chunk #" << chunkId 
-                      << " (loop #" << loopIteration << ")"
+                      << " (read #" << sender.ChunksRead() << ")"
                       << " @ " << elapsed << "ms"
-                      << ": samples=" << chunkSamples.size()
-                      << ", RMS=" << std::fixed << std::setprecision(6) << chunkRms
-                      << ", remainingBuffer=" << currentBufferSize - SAMPLES_PER_CHUNK
+                      << ": samples=" << count
+                      << ", RMS=" << std::fixed << std::setprecision(6) << AudioUtils::CalculateRms(samples, count)
+                      << ", remainingBuffer=" << micBuffer.Available()
                       << std::endl;
         }
 
-        // Reset for this chunk
-        {
-            std::lock_guard<std::mutex> lock(responseMutex);
-            currentResponse.clear();
-            responseCompleted = false;
-            firstTokenReceived = false;
-            callbackFinished = false;
-        }
-
-        // Encode to base64
-        const uint8_t* chunkData = reinterpret_cast<const uint8_t*>(chunkSamples.data());
-        size_t chunkBytes = chunkSamples.size() * sizeof(float);
-        std::string base64Audio = Base64Encode(chunkData, chunkBytes);
-
-        // Format payload: "CHUNK:<id>:<sample_rate>:<base64_data>"
-        std::string payload = "CHUNK:" + std::to_string(chunkId) + ":" + 
-                              std::to_string(MIC_SAMPLE_RATE) + ":" + base64Audio;
-
-        // Validate payload size
-        if (payload.length() >= sizeof(NV_REQUEST_RISE_SETTINGS_V1::content)) {
-            std::cerr << "\n[ERROR] Payload too large: " << payload.length() << " bytes" << std::endl;
-            break;
-        }
-
-        // Setup and send request
-        NV_REQUEST_RISE_SETTINGS_V1 requestSettings = { 0 };
-        requestSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-        requestSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-        strncpy_s(requestSettings.content, sizeof(requestSettings.content),
-                  payload.c_str(), payload.length());
-        requestSettings.completed = 0;  // More chunks coming
-
-        NvAPI_Status status = NvAPI_RequestRise(&requestSettings);
-        if (status != NVAPI_OK) {
-            std::cerr << "\n[ERROR] Failed to send audio chunk" << std::endl;
-            break;
+        if (!session->SendAudio(samples, count)) {
+            return false;
         }
 
-        // Wait for response
-        auto waitStart = std::chrono::steady_clock::now();
-        responseCompleteSemaphore.acquire();
-        auto waitEnd = std::chrono::steady_clock::now();
-        
-        if (g_micDebugLogging && (loopIteration <= 5 || loopIteration % 20 == 0)) {
-            auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(waitEnd - waitStart).count();
-            std::lock_guard<std::mutex> lock(responseMutex);
-            std::cerr << "[MIC_DEBUG] Chunk #" << chunkId << " response received in " << waitMs << "ms"
-                      << ", response='" << (currentResponse.length() > 60 ? currentResponse.substr(0, 60) + "..." : currentResponse) << "'"
+        if (logChunk) {
+            ChunkWindow::Stats chunkStats = session->ChunkStats();
+            std::cerr << "[MIC_DEBUG] Chunk #" << chunkId << " sent"
+                      << ", acknowledged=" << chunkStats.acknowledged
+                      << ", mean ack=" << chunkStats.meanAckMs << "ms"
+                      << ", interim='" << session->Interim() << "'"
                       << std::endl;
         }
 
         chunkId++;
+        return true;
+    };
+
+    if (!sender.Run(stopRequested, sendChunk)) {
+        std::cerr << "\n[ERROR] " << session->Error() << std::endl;
     }
     
     if (g_micDebugLogging) {
         std::cerr << "[MIC_DEBUG] Main loop exited: totalChunks=" << chunkId 
-                  << ", totalCallbacks=" << g_callbackCount.load() 
+                  << ", chunksRead=" << sender.ChunksRead()
+                  << ", waitTimeouts=" << sender.Waits()
+                  << ", totalCallbacks=" << g_mic.Callbacks() 
                   << std::endl;
     }
 
-    // Stop microphone and clean up
-    micCaptureActive.store(false, std::memory_order_release);
-    ma_device_stop(&device);
-    ma_device_uninit(&device);
-    ma_context_uninit(&context);
+    // Stop forwarding; the device stays open for the next session unless --mic-close
+    g_mic.EndSession();
+
+    AudioRingBuffer::Stats micStats = micBuffer.GetStats();
+    if (micStats.dropped > 0) {
+        std::cout << "\n[WARN] Dropped " << micStats.dropped << " samples ("
+                  << (micStats.dropped * 1000 / MIC_SAMPLE_RATE) << " ms) in " << micStats.overflows
+                  << " overflows; sending fell behind capture" << std::endl;
+    }
+    if (g_micVoiceGate) {
+        VoiceGate::Stats gateStats = sender.Gate().GetStats();
+        std::cout << "[INFO] Voice gate: sent " << gateStats.chunksSent << " of "
+                  << (gateStats.chunksSent + gateStats.chunksSkipped) << " chunks ("
+                  << gateStats.chunksSkipped << " silent chunks skipped, "
+                  << gateStats.activations << " speech segments)" << std::endl;
+    }
+    if (g_micDebugLogging) {
+        std::cerr << "[MIC_DEBUG] Buffer: captured=" << micStats.written << ", dropped=" << micStats.dropped
+                  << ", highWater=" << micStats.highWater << "/" << micBuffer.Capacity() << std::endl;
+    }
 
     // Wait for input thread
     if (inputThread.joinable()) {
@@ -1270,129 +759,30 @@ void DemoASRMicrophone() {
     // Send STOP to get final transcription
     std::cout << "\n[INFO] Finalizing transcription..." << std::endl;
 
-    // IMPORTANT: Set waiting mode FIRST to prevent race conditions with in-flight callbacks
-    // Any callbacks that arrive after this will NOT release the semaphore unless they're ASR_FINAL
-    waitingForAsrFinal.store(true, std::memory_order_release);
-    
     if (g_micDebugLogging) {
-        std::cerr << "[MIC_DEBUG] STOP phase: waitingForAsrFinal set to TRUE\n" << std::flush;
+        std::cerr << "[MIC_DEBUG] Sending STOP command, waiting for ASR_FINAL (timeout: 10s)...\n" << std::flush;
     }
-    
-    // Give in-flight callbacks time to complete before draining
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-    // Drain semaphore - now safe because new callbacks won't release unless ASR_FINAL
-    int drainCount = 0;
-    while (responseCompleteSemaphore.try_acquire()) { drainCount++; }
-    
-    if (g_micDebugLogging) {
-        std::cerr << "[MIC_DEBUG] STOP phase: drained " << drainCount << " semaphore tokens\n" << std::flush;
-    }
-
-    {
-        std::lock_guard<std::mutex> lock(responseMutex);
-        if (g_micDebugLogging) {
-            std::cerr << "[MIC_DEBUG] STOP phase: currentResponse before clear = '" 
-                      << (currentResponse.length() > 60 ? currentResponse.substr(0, 60) + "..." : currentResponse)
-                      << "'\n" << std::flush;
-        }
-        currentResponse.clear();
-        lastAsrFinalResponse.clear();
-        responseCompleted = false;
-        firstTokenReceived = false;
-        callbackFinished = false;
-    }
-
-    NV_REQUEST_RISE_SETTINGS_V1 stopSettings = { 0 };
-    stopSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
-    stopSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
-    strncpy_s(stopSettings.content, sizeof(stopSettings.content), "STOP:", 5);
-    stopSettings.completed = 0;
+    // Waits for outstanding chunks first; in-flight acknowledgments can no
+    // longer be mistaken for the final response
+    auto waitStart = std::chrono::steady_clock::now();
+    const auto TIMEOUT = std::chrono::seconds(10);
+    bool gotResponse = session->Finish(TIMEOUT);
 
     if (g_micDebugLogging) {
-        std::cerr << "[MIC_DEBUG] Sending STOP command (waitingForAsrFinal=true)...\n" << std::flush;
+        auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - waitStart).count();
+        std::cerr << "[MIC_DEBUG] Wait completed in " << waitMs << "ms, gotResponse=" << gotResponse << "\n" << std::flush;
+        std::cerr << "[MIC_DEBUG] transcript = '" << session->Transcript() << "'\n" << std::flush;
     }
-    
-    NvAPI_Status status = NvAPI_RequestRise(&stopSettings);
-    if (status == NVAPI_OK) {
-        if (g_micDebugLogging) {
-            std::cerr << "[MIC_DEBUG] STOP sent successfully, waiting for ASR_FINAL (timeout: 10s)...\n" << std::flush;
-        }
-        
-        // Wait for ASR_FINAL with timeout
-        auto waitStart = std::chrono::steady_clock::now();
-        const int TIMEOUT_MS = 10000;  // 10 second timeout
-        bool gotResponse = false;
-        
-        // Poll with timeout since our semaphore doesn't support timed wait
-        while (!gotResponse) {
-            // Try to acquire with small sleep intervals
-            if (responseCompleteSemaphore.try_acquire()) {
-                gotResponse = true;
-                break;
-            }
-            
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::steady_clock::now() - waitStart).count();
-            
-            if (elapsed >= TIMEOUT_MS) {
-                if (g_micDebugLogging) {
-                    std::cerr << "[MIC_DEBUG] Timeout waiting for ASR_FINAL after " << elapsed << "ms\n" << std::flush;
-                }
-                break;
-            }
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        }
-        
-        auto waitEnd = std::chrono::steady_clock::now();
-        auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(waitEnd - waitStart).count();
-        
-        // Disable ASR_FINAL waiting mode
-        waitingForAsrFinal.store(false, std::memory_order_release);
-        
-        if (g_micDebugLogging) {
-            std::cerr << "[MIC_DEBUG] Wait completed in " << waitMs << "ms, gotResponse=" << gotResponse << "\n" << std::flush;
-        }
 
-        std::lock_guard<std::mutex> lock(responseMutex);
-        
-        // Use lastAsrFinalResponse if available, otherwise check currentResponse
-        std::string finalResponse = !lastAsrFinalResponse.empty() ? lastAsrFinalResponse : currentResponse;
-        
-        if (g_micDebugLogging) {
-            std::cerr << "[MIC_DEBUG] lastAsrFinalResponse = '" << lastAsrFinalResponse << "'\n" << std::flush;
-            std::cerr << "[MIC_DEBUG] currentResponse = '" << currentResponse << "'\n" << std::flush;
-            std::cerr << "[MIC_DEBUG] Using finalResponse = '" << finalResponse << "'\n" << std::flush;
-        }
-        
-        if (finalResponse.find("ASR_FINAL:") == 0) {
-            std::string finalTranscript = finalResponse.substr(10);
-            std::cout << "\n========================================" << std::endl;
-            std::cout << "FINAL TRANSCRIPTION:" << std::endl;
-            std::cout << "========================================" << std::endl;
-            std::cout << finalTranscript << std::endl;
-            std::cout << "========================================\n" << std::endl;
-        } else if (!finalResponse.empty()) {
-            std::cout << "\nFinal: " << finalResponse << std::endl;
-        } else {
-            std::cout << "\n[WARN] No transcription received (timeout or no speech detected)" << std::endl;
-            if (g_micDebugLogging) {
-                std::cerr << "[MIC_DEBUG] WARNING: Final response was empty!\n" << std::flush;
-            }
-        }
-    } else {
-        std::cerr << "\n[ERROR] Failed to send STOP signal (status=" << status << ")" << std::endl;
-    }
-    
-    // Ensure flag is reset
-    waitingForAsrFinal.store(false, std::memory_order_release);
+    PrintFinalTranscription(*session);
+    SaveTrace(*session);
 
     std::cout << "\nPress Enter to continue...";
     std::cin.get();
 }
 
-
 // ============================================================================
 // Main Menu
 // ============================================================================
@@ -1413,7 +803,106 @@ void ShowMenu() {
 // Main Entry Point
 // ============================================================================
 
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n\n"
+              << "Live microphone voice gate (demo 3):\n"
+              << "  --no-vad             Send every chunk, including silence\n"
+              << "  --vad-open <rms>     RMS that opens the gate (default " << VoiceGateConfig().openThreshold << ")\n"
+              << "  --vad-close <rms>    RMS below which a chunk is silent (default " << VoiceGateConfig().closeThreshold << ")\n"
+              << "  --vad-hangover <n>   Silent chunks sent after speech (default " << VoiceGateConfig().hangoverChunks << ")\n"
+              << "  --vad-preroll <n>    Chunks kept from before speech (default " << VoiceGateConfig().preRollChunks << ")\n"
+              << "  --mic-debug          Verbose microphone logging\n\n"
+              << "Live microphone capture (demo 3):\n"
+              << "  --mic-period-ms <n>  Device period (default: backend, 10 ms)\n"
+              << "  --mic-periods <n>    Periods in the device buffer (default: backend)\n"
+              << "  --mic-exclusive      WASAPI exclusive mode, if the device allows it\n"
+              << "  --mic-conservative   Larger default buffers instead of low latency\n"
+              << "  --mic-16k            Let the device/miniaudio resample to 16 kHz instead of\n"
+              << "                       capturing at the native rate and resampling here\n"
+              << "  --mic-close          Close the microphone after each session\n"
+              << "  --mic-prewarm        Open the default microphone at startup\n"
+              << "  --mic-timeout <ms>   Time a started microphone has to deliver audio (default "
+              << g_micReadyTimeoutMs << ")\n\n"
+              << "ASR demos (2 and 3):\n"
+              << "  --chunk-format <f>   float32 (default) or int16; int16 sends twice the\n"
+              << "                       audio per request as CHUNK16, if the engine supports it\n\n"
+              << "Tracing:\n"
+              << "  --trace <dir>        Write a Chrome trace of each request to <dir>/<trace_id>.json\n";
+}
+
+// Returns false (after printing why) on an unknown option or bad value
+bool ParseArguments(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        try {
+            if (arg == "--no-vad") {
+                g_micVoiceGate = false;
+            } else if (arg == "--vad-open" && hasValue) {
+                g_micVoiceGateConfig.openThreshold = std::stof(argv[++i]);
+            } else if (arg == "--vad-close" && hasValue) {
+                g_micVoiceGateConfig.closeThreshold = std::stof(argv[++i]);
+            } else if (arg == "--vad-hangover" && hasValue) {
+                g_micVoiceGateConfig.hangoverChunks = std::stoi(argv[++i]);
+            } else if (arg == "--vad-preroll" && hasValue) {
+                g_micVoiceGateConfig.preRollChunks = std::stoi(argv[++i]);
+            } else if (arg == "--chunk-format" && hasValue) {
+                if (!Rise::ParseChunkEncoding(argv[++i], g_chunkEncoding)) {
+                    throw std::invalid_argument(arg);
+                }
+            } else if (arg == "--trace" && hasValue) {
+                g_traceDir = argv[++i];
+            } else if (arg == "--mic-debug") {
+                g_micDebugLogging = true;
+            } else if (arg == "--mic-period-ms" && hasValue) {
+                g_micConfig.periodMs = static_cast<ma_uint32>(std::stoul(argv[++i]));
+            } else if (arg == "--mic-periods" && hasValue) {
+                g_micConfig.periods = static_cast<ma_uint32>(std::stoul(argv[++i]));
+            } else if (arg == "--mic-exclusive") {
+                g_micConfig.exclusive = true;
+            } else if (arg == "--mic-conservative") {
+                g_micConfig.lowLatency = false;
+            } else if (arg == "--mic-16k") {
+                g_micConfig.nativeRate = false;
+            } else if (arg == "--mic-close") {
+                g_micConfig.keepOpen = false;
+            } else if (arg == "--mic-prewarm") {
+                g_micPrewarm = true;
+            } else if (arg == "--mic-timeout" && hasValue) {
+                g_micReadyTimeoutMs = std::stoi(argv[++i]);
+                if (g_micReadyTimeoutMs < 1) {
+                    throw std::invalid_argument(arg);
+                }
+            } else {
+                std::cerr << "[ERROR] Unknown or incomplete option: " << arg << "\n\n";
+                PrintUsage(argv[0]);
+                return false;
+            }
+        } catch (...) {
+            std::cerr << "[ERROR] Invalid value for " << arg << ": " << argv[i] << "\n\n";
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if (g_micVoiceGateConfig.closeThreshold > g_micVoiceGateConfig.openThreshold) {
+        std::cerr << "[ERROR] --vad-close must not be above --vad-open\n";
+        return false;
+    }
+    if (g_micPrewarm && !g_micConfig.keepOpen) {
+        std::cerr << "[ERROR] --mic-prewarm needs the microphone kept open (drop --mic-close)\n";
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, char* argv[]) {
+    if (!ParseArguments(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+    g_mic.Configure(g_micConfig);
+
     std::cout << "\n";
     std::cout << "===============================================================" << std::endl;
     std::cout << "           RISE C++ Demo Client v1.0                          " << std::endl;
@@ -1428,6 +917,16 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    // Device start is paid here instead of when the first recording begins
+    if (g_micPrewarm) {
+        if (g_mic.Prewarm()) {
+            std::cout << "[OK] Microphone open: " << g_mic.DeviceName() << " ("
+                      << static_cast<int>(g_mic.StartMs()) << " ms)" << std::endl;
+        } else {
+            std::cout << "[WARN] Could not open the default microphone: " << g_mic.LastError() << std::endl;
+        }
+    }
+
     // Main menu loop
     while (true) {
         ShowMenu();
@@ -0,0 +1,322 @@
+/*
+ * Microphone Capture
+ *
+ * Owns the miniaudio side of live ASR: the audio context, the list of
+ * capture devices and the open device, and feeds mono float samples at the
+ * ASR rate into an AudioRingBuffer.
+ *
+ * Everything here outlives one recording to keep session start fast:
+ *   - The context is initialized once and devices are enumerated once; the
+ *     cached list is reused until Devices(true) rescans.
+ *   - With keepOpen, the device keeps running between sessions with its
+ *     samples discarded, so the next session on the same device starts
+ *     without the device start (often over a second for Bluetooth
+ *     headsets). Prewarm() opens it ahead of the first session.
+ *
+ * By default the device captures at its native rate, and miniaudio's and
+ * WASAPI's rate conversion is bypassed; the polyphase Resampler converts
+ * in the audio callback. The period size and count, the WASAPI share mode
+ * and the performance profile are configurable.
+ *
+ * Include miniaudio.h (with the options used for its implementation) before
+ * this header. Control calls (Open, BeginSession, EndSession, Close) must
+ * come from one thread.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_ring_buffer.h"
+#include "resampler.h"
+
+struct MicCaptureConfig {
+    ma_uint32 periodMs = 0;         // device period; 0 = backend default (10 ms low-latency)
+    ma_uint32 periods = 0;          // periods in the device buffer; 0 = backend default
+    bool lowLatency = true;         // low-latency performance profile and "Pro Audio" thread class
+    bool exclusive = false;         // WASAPI exclusive mode; falls back to shared if refused
+    bool nativeRate = true;         // capture at the device rate and resample here
+    bool keepOpen = true;           // leave the device running between sessions
+};
+
+class MicCapture {
+public:
+    struct Device {
+        ma_device_id id;
+        std::string name;
+        bool isDefault;
+    };
+
+    // Largest callback (in device frames) resampled in one pass; bigger
+    // callbacks are split
+    static constexpr size_t MAX_CALLBACK_FRAMES = 4096;
+
+    MicCapture(AudioRingBuffer& buffer, int targetRate)
+        : buffer_(buffer), targetRate_(targetRate) {}
+
+    ~MicCapture() {
+        Close();
+        if (contextReady_) ma_context_uninit(&context_);
+    }
+
+    MicCapture(const MicCapture&) = delete;
+    MicCapture& operator=(const MicCapture&) = delete;
+
+    // Applies to devices opened from now on; closes the current one
+    void Configure(const MicCaptureConfig& config) {
+        Close();
+        config_ = config;
+    }
+
+    const MicCaptureConfig& Config() const { return config_; }
+
+    /**
+     * Capture devices, enumerated on first use and then cached. Pass
+     * refresh to rescan after devices were plugged in or removed. Empty on
+     * failure (see LastError()).
+     */
+    const std::vector<Device>& Devices(bool refresh = false) {
+        if (!EnsureContext()) {
+            devices_.clear();
+            return devices_;
+        }
+        if (enumerated_ && !refresh) return devices_;
+
+        ma_device_info* playback;
+        ma_uint32 playbackCount;
+        ma_device_info* capture;
+        ma_uint32 captureCount;
+        devices_.clear();
+        if (ma_context_get_devices(&context_, &playback, &playbackCount, &capture, &captureCount) != MA_SUCCESS) {
+            error_ = "Failed to enumerate audio devices";
+            enumerated_ = false;
+            return devices_;
+        }
+
+        for (ma_uint32 i = 0; i < captureCount; i++) {
+            devices_.push_back({ capture[i].id, capture[i].name, capture[i].isDefault != 0 });
+        }
+        enumerated_ = true;
+        return devices_;
+    }
+
+    /**
+     * Open and start `device` (nullptr = system default). If it is already
+     * open this returns at once and WasWarm() is true. Samples are only
+     * forwarded between BeginSession() and EndSession().
+     */
+    bool Open(const Device* device) {
+        // A device that was unplugged or lost its stream has stopped itself
+        if (IsOpen() && SameDevice(device) && ma_device_get_state(&device_) == ma_device_state_started) {
+            warm_ = true;
+            startMs_ = 0.0;
+            return true;
+        }
+
+        Close();
+        if (!EnsureContext()) return false;
+
+        hasDeviceId_ = device != nullptr;
+        if (device) deviceId_ = device->id;
+
+        auto start = std::chrono::steady_clock::now();
+        bool exclusive = config_.exclusive;
+        ma_result result = InitDevice(exclusive);
+        if (result != MA_SUCCESS && exclusive) {
+            exclusive = false;  // another application holds the device, or the format is refused
+            result = InitDevice(exclusive);
+        }
+        if (result != MA_SUCCESS) {
+            error_ = "Failed to initialize microphone device";
+            return false;
+        }
+        exclusiveActive_ = exclusive;
+
+        // Ratios the resampler cannot do are left to miniaudio
+        deviceRate_ = static_cast<int>(device_.sampleRate);
+        if (!resampler_.Initialize(deviceRate_, targetRate_)) {
+            ma_device_uninit(&device_);
+            result = InitDevice(exclusive, static_cast<ma_uint32>(targetRate_));
+            if (result != MA_SUCCESS) {
+                error_ = "Failed to initialize microphone device";
+                return false;
+            }
+            deviceRate_ = static_cast<int>(device_.sampleRate);
+            resampler_.Initialize(deviceRate_, targetRate_);
+        }
+        scratch_.resize(resampler_.MaxOutput(MAX_CALLBACK_FRAMES));
+
+        deviceOpen_ = true;
+        if (ma_device_start(&device_) != MA_SUCCESS) {
+            error_ = "Failed to start microphone";
+            Close();
+            return false;
+        }
+        startMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        warm_ = false;
+        return true;
+    }
+
+    // Open the default device before the first session, when keepOpen is set
+    bool Prewarm() {
+        return config_.keepOpen && Open(nullptr);
+    }
+
+    bool IsOpen() const { return deviceOpen_; }
+    bool WasWarm() const { return warm_; }          // last Open() reused a running device
+    double StartMs() const { return startMs_; }     // time Open() spent initializing and starting
+    const char* DeviceName() const { return deviceOpen_ ? device_.capture.name : ""; }
+    int DeviceRate() const { return deviceRate_; }
+    bool IsResampling() const { return !resampler_.IsPassthrough(); }
+    bool IsExclusive() const { return exclusiveActive_; }
+    ma_format DeviceFormat() const { return device_.capture.internalFormat; }
+    ma_uint32 PeriodFrames() const { return device_.capture.internalPeriodSizeInFrames; }
+    ma_uint32 Periods() const { return device_.capture.internalPeriods; }
+    const std::string& LastError() const { return error_; }
+
+    // Level of the latest callback, forwarded or not (full scale 1.0)
+    float LastRms() const { return lastRms_.load(std::memory_order_acquire); }
+    int Callbacks() const { return callbacks_.load(std::memory_order_acquire); }
+
+    /**
+     * Clear `buffer` and start forwarding captured samples to it. LastRms()
+     * stays live, so a warm device passes a level check immediately.
+     */
+    void BeginSession() {
+        WaitForWriterIdle();
+        buffer_.Reset();
+        resetPending_.store(true);
+        callbacks_.store(0, std::memory_order_release);
+        forwarding_.store(true);
+    }
+
+    // Stop forwarding; closes the device unless keepOpen is set
+    void EndSession() {
+        forwarding_.store(false);
+        WaitForWriterIdle();
+        if (!config_.keepOpen) Close();
+    }
+
+    void Close() {
+        forwarding_.store(false);
+        if (deviceOpen_) {
+            ma_device_uninit(&device_);
+            deviceOpen_ = false;
+        }
+        warm_ = false;
+        exclusiveActive_ = false;
+        lastRms_.store(0.0f, std::memory_order_release);
+    }
+
+private:
+    bool EnsureContext() {
+        if (contextReady_) return true;
+        if (ma_context_init(NULL, 0, NULL, &context_) != MA_SUCCESS) {
+            error_ = "Failed to initialize audio context";
+            return false;
+        }
+        contextReady_ = true;
+        return true;
+    }
+
+    bool SameDevice(const Device* device) const {
+        if (!device) return !hasDeviceId_;
+        return hasDeviceId_ && ma_device_id_equal(&device->id, &deviceId_);
+    }
+
+    ma_result InitDevice(bool exclusive, ma_uint32 sampleRate = 0) {
+        ma_device_config config = ma_device_config_init(ma_device_type_capture);
+        config.capture.pDeviceID = hasDeviceId_ ? &deviceId_ : nullptr;
+        config.capture.format = ma_format_f32;
+        config.capture.channels = 1;
+        config.capture.shareMode = exclusive ? ma_share_mode_exclusive : ma_share_mode_shared;
+        config.sampleRate = sampleRate != 0 ? sampleRate : (config_.nativeRate ? 0 : static_cast<ma_uint32>(targetRate_));
+        config.periodSizeInMilliseconds = config_.periodMs;
+        config.periods = config_.periods;
+        config.performanceProfile = config_.lowLatency ? ma_performance_profile_low_latency
+                                                       : ma_performance_profile_conservative;
+        config.noFixedSizedCallback = MA_TRUE;  // the ring takes any size; skips an intermediate buffer
+        config.wasapi.usage = config_.lowLatency ? ma_wasapi_usage_pro_audio : ma_wasapi_usage_default;
+        config.wasapi.noAutoConvertSRC = config.sampleRate == 0 ? MA_TRUE : MA_FALSE;
+        config.dataCallback = DataCallback;
+        config.pUserData = this;
+        return ma_device_init(&context_, &config, &device_);
+    }
+
+    static void DataCallback(ma_device* device, void* output, const void* input, ma_uint32 frameCount) {
+        (void)output;  // capture only
+        if (input) {
+            static_cast<MicCapture*>(device->pUserData)->OnAudio(static_cast<const float*>(input), frameCount);
+        }
+    }
+
+    // Audio thread
+    void OnAudio(const float* samples, ma_uint32 frameCount) {
+        callbacks_.fetch_add(1, std::memory_order_relaxed);
+
+        float sumSquares = 0.0f;
+        for (ma_uint32 i = 0; i < frameCount; i++) {
+            sumSquares += samples[i] * samples[i];
+        }
+        lastRms_.store(frameCount > 0 ? std::sqrt(sumSquares / frameCount) : 0.0f, std::memory_order_release);
+
+        // writing_ brackets every use of the ring and the resampler so the
+        // control thread can wait for the callback to be out of them
+        writing_.store(true);
+        if (forwarding_.load()) {
+            if (resetPending_.exchange(false)) resampler_.Reset();
+
+            if (resampler_.IsPassthrough()) {
+                buffer_.Write(samples, frameCount);
+            } else {
+                for (size_t offset = 0; offset < frameCount; offset += MAX_CALLBACK_FRAMES) {
+                    size_t n = std::min<size_t>(MAX_CALLBACK_FRAMES, frameCount - offset);
+                    size_t produced = resampler_.Process(samples + offset, n, scratch_.data());
+                    buffer_.Write(scratch_.data(), produced);
+                }
+            }
+        }
+        writing_.store(false);
+    }
+
+    void WaitForWriterIdle() const {
+        while (writing_.load()) {
+            std::this_thread::yield();
+        }
+    }
+
+    AudioRingBuffer& buffer_;
+    const int targetRate_;
+    MicCaptureConfig config_;
+    std::string error_;
+
+    ma_context context_;
+    bool contextReady_ = false;
+    std::vector<Device> devices_;
+    bool enumerated_ = false;
+
+    ma_device device_;
+    bool deviceOpen_ = false;
+    ma_device_id deviceId_ = {};
+    bool hasDeviceId_ = false;
+    bool warm_ = false;
+    bool exclusiveActive_ = false;
+    double startMs_ = 0.0;
+    int deviceRate_ = 0;
+
+    // Audio thread state; resampler_ and scratch_ are only touched there
+    // once the device is running
+    Resampler resampler_;
+    std::vector<float> scratch_;    // resampled output of one slice
+    std::atomic<bool> forwarding_{ false };
+    std::atomic<bool> writing_{ false };
+    std::atomic<bool> resetPending_{ false };
+    std::atomic<float> lastRms_{ 0.0f };
+    std::atomic<int> callbacks_{ 0 };
+};
@@ -0,0 +1,84 @@
+/*
+ * Microphone Sender Loop
+ *
+ * Drains captured audio from an AudioRingBuffer in fixed-size ASR chunks:
+ * sleeps until a full chunk is buffered, reads it, runs it through the
+ * optional VoiceGate and hands every chunk worth sending to a callback.
+ *
+ * The live microphone demo runs it against the miniaudio callback;
+ * audio_bench runs the same loop against recorded or simulated audio, so
+ * the sender path can be measured on machines without a microphone.
+ *
+ * Run() blocks the calling thread until `stop` is set (followed by Wake()
+ * on the buffer) or the callback fails. Samples left over when it stops,
+ * less than one chunk, are not sent. Storage is allocated in the
+ * constructor; Run() never allocates.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "audio_ring_buffer.h"
+#include "voice_gate.h"
+
+class MicSender {
+public:
+    // Longest single wait for audio before `stop` is checked again
+    static constexpr std::chrono::milliseconds CHUNK_WAIT_TIMEOUT{ 500 };
+
+    MicSender(AudioRingBuffer& buffer, size_t chunkSamples, bool useGate,
+              const VoiceGateConfig& gateConfig = VoiceGateConfig())
+        : buffer_(buffer), chunkSamples_(chunkSamples), useGate_(useGate),
+          chunk_(chunkSamples), gate_(chunkSamples, gateConfig) {}
+
+    MicSender(const MicSender&) = delete;
+    MicSender& operator=(const MicSender&) = delete;
+
+    size_t ChunkSamples() const { return chunkSamples_; }
+    bool GateEnabled() const { return useGate_; }
+    const VoiceGate& Gate() const { return gate_; }
+
+    // Counters; read them from the Run() thread (e.g. inside the callback)
+    // or after Run() has returned
+    uint64_t ChunksRead() const { return chunksRead_; }
+    uint64_t SamplesRead() const { return chunksRead_ * chunkSamples_; }
+    uint64_t Waits() const { return waits_; }  // waits that ended without a full chunk
+
+    /**
+     * Calls send(const float* samples, size_t count) for each chunk to send,
+     * including pre-roll chunks the gate releases late. Returns false as
+     * soon as send does, true once `stop` is set.
+     */
+    template <typename Send>
+    bool Run(const std::atomic<bool>& stop, Send&& send) {
+        while (!stop.load(std::memory_order_acquire)) {
+            // Sleep until the audio thread has buffered a full chunk
+            if (!buffer_.WaitForSamples(chunkSamples_, CHUNK_WAIT_TIMEOUT)) {
+                waits_++;
+                continue;
+            }
+
+            buffer_.Read(chunk_.data(), chunkSamples_);
+            chunksRead_++;
+
+            bool sent = useGate_
+                ? gate_.Process(chunk_.data(), chunkSamples_, send)
+                : send(chunk_.data(), chunkSamples_);
+            if (!sent) return false;
+        }
+        return true;
+    }
+
+private:
+    AudioRingBuffer& buffer_;
+    const size_t chunkSamples_;
+    const bool useGate_;
+    std::vector<float> chunk_;
+    VoiceGate gate_;
+    uint64_t chunksRead_ = 0;
+    uint64_t waits_ = 0;
+};
@@ -0,0 +1,171 @@
+/*
+ * Named Pipe Server
+ *
+ * Local IPC endpoint for gassist_cli's server mode. Messages use the same
+ * framing as the plugin SDK's gassist::Protocol: a 4-byte big-endian length
+ * prefix whose top byte is the payload encoding, followed by the payload.
+ * Only JSON text (encoding 0) is accepted.
+ *
+ * Every client gets its own pipe instance; the pipe rejects remote clients.
+ */
+
+#pragma once
+
+#include <windows.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class PipeConnection {
+public:
+    static constexpr size_t MAX_MESSAGE_SIZE = 10 * 1024 * 1024; // 10MB
+    static constexpr size_t HEADER_SIZE = 4;
+    static constexpr uint32_t LENGTH_MASK = 0x00FFFFFF;
+
+    enum class ReadStatus { Ok, Closed, BadFrame };
+
+    explicit PipeConnection(HANDLE pipe) : pipe_(pipe) {}
+
+    ~PipeConnection() {
+        FlushFileBuffers(pipe_);
+        DisconnectNamedPipe(pipe_);
+        CloseHandle(pipe_);
+    }
+
+    PipeConnection(const PipeConnection&) = delete;
+    PipeConnection& operator=(const PipeConnection&) = delete;
+
+    // Read one frame. BadFrame means the stream can no longer be trusted
+    // (bad length or non-JSON encoding) and the connection should be closed.
+    ReadStatus ReadMessage(std::string& payload) {
+        uint8_t header[HEADER_SIZE];
+        if (!ReadExact(reinterpret_cast<char*>(header), HEADER_SIZE)) {
+            return ReadStatus::Closed;
+        }
+
+        uint32_t prefix = (static_cast<uint32_t>(header[0]) << 24) |
+                          (static_cast<uint32_t>(header[1]) << 16) |
+                          (static_cast<uint32_t>(header[2]) << 8) |
+                          static_cast<uint32_t>(header[3]);
+        uint32_t encoding = prefix >> 24;
+        uint32_t length = prefix & LENGTH_MASK;
+
+        if (encoding != 0 || length == 0 || length > MAX_MESSAGE_SIZE) {
+            return ReadStatus::BadFrame;
+        }
+
+        payload.resize(length);
+        if (!ReadExact(&payload[0], length)) {
+            return ReadStatus::Closed;
+        }
+        return ReadStatus::Ok;
+    }
+
+    // Write one JSON frame; header and payload leave in a single write
+    bool WriteMessage(const std::string& payload) {
+        if (payload.size() > MAX_MESSAGE_SIZE) {
+            return false;
+        }
+
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        std::string frame(HEADER_SIZE, '\0');
+        frame[0] = static_cast<char>((length >> 24) & 0xFF);
+        frame[1] = static_cast<char>((length >> 16) & 0xFF);
+        frame[2] = static_cast<char>((length >> 8) & 0xFF);
+        frame[3] = static_cast<char>(length & 0xFF);
+        frame += payload;
+
+        size_t written = 0;
+        while (written < frame.size()) {
+            DWORD bytes = 0;
+            if (!WriteFile(pipe_, frame.data() + written, static_cast<DWORD>(frame.size() - written), &bytes, nullptr)) {
+                return false;
+            }
+            written += bytes;
+        }
+        return true;
+    }
+
+private:
+    bool ReadExact(char* buffer, size_t length) {
+        size_t total = 0;
+        while (total < length) {
+            DWORD bytes = 0;
+            if (!ReadFile(pipe_, buffer + total, static_cast<DWORD>(length - total), &bytes, nullptr) || bytes == 0) {
+                return false;
+            }
+            total += bytes;
+        }
+        return true;
+    }
+
+    HANDLE pipe_;
+};
+
+class PipeServer {
+public:
+    static constexpr const char* DEFAULT_NAME = "\\\\.\\pipe\\gassist_cli";
+    static constexpr DWORD BUFFER_SIZE = 64 * 1024;
+
+    explicit PipeServer(std::string name) : name_(std::move(name)) {}
+
+    PipeServer(const PipeServer&) = delete;
+    PipeServer& operator=(const PipeServer&) = delete;
+
+    const std::string& Name() const { return name_; }
+
+    // Platform error of the last failed Accept()
+    DWORD LastError() const { return lastError_; }
+
+    /**
+     * Wait for the next client. Returns nullptr after Stop() or if the pipe
+     * cannot be created (e.g. another server already owns the name).
+     */
+    std::unique_ptr<PipeConnection> Accept() {
+        if (stopping_.load()) return nullptr;
+
+        DWORD openMode = PIPE_ACCESS_DUPLEX;
+        if (firstInstance_) {
+            openMode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+        }
+
+        HANDLE pipe = CreateNamedPipeA(name_.c_str(), openMode,
+                                       PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                       PIPE_UNLIMITED_INSTANCES, BUFFER_SIZE, BUFFER_SIZE, 0, nullptr);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            lastError_ = GetLastError();
+            return nullptr;
+        }
+        firstInstance_ = false;
+
+        // A client that connected between CreateNamedPipe and ConnectNamedPipe
+        // reports ERROR_PIPE_CONNECTED
+        BOOL connected = ConnectNamedPipe(pipe, nullptr) ? TRUE : (GetLastError() == ERROR_PIPE_CONNECTED);
+        if (!connected || stopping_.load()) {
+            lastError_ = connected ? 0 : GetLastError();
+            CloseHandle(pipe);
+            return nullptr;
+        }
+        return std::unique_ptr<PipeConnection>(new PipeConnection(pipe));
+    }
+
+    // Stop accepting; wakes a blocked Accept() by connecting to the pipe
+    void Stop() {
+        if (stopping_.exchange(true)) return;
+
+        HANDLE wake = CreateFileA(name_.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (wake != INVALID_HANDLE_VALUE) {
+            CloseHandle(wake);
+        }
+    }
+
+    bool Stopping() const { return stopping_.load(); }
+
+private:
+    std::string name_;
+    std::atomic<bool> stopping_{ false };
+    bool firstInstance_ = true;
+    DWORD lastError_ = 0;
+};
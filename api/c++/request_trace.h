@@ -0,0 +1,310 @@
+/*
+ * Request Tracing
+ *
+ * Phase timestamps of one RISE request and their export as Chrome trace
+ * JSON, for chrome://tracing or https://ui.perfetto.dev.
+ *
+ * RequestTrace is filled by RiseClient while tracing is on: when
+ * NvAPI_RequestRise was called and returned and, per content type, the
+ * first callback, the latest one and the completion. CUSTOM_BEHAVIOR
+ * callbacks (the model calling a tool) are paired with the
+ * CUSTOM_BEHAVIOR_RESULT that follows them, so a trace separates model time
+ * from tool dispatch and plugin time.
+ *
+ * Timestamps are converted to microseconds since the Unix epoch on export.
+ * Traces written by the client, the plugin host and plugins
+ * (gassist_sdk.hpp) therefore share a timebase and line up when loaded
+ * together.
+ *
+ * Recording must not allocate on the callback thread: tool calls are
+ * reserved up front and everything else is fixed size.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Rise {
+
+// ============================================================================
+// Timebase
+// ============================================================================
+
+inline int64_t TraceTimestampUs(std::chrono::steady_clock::time_point time) {
+    using namespace std::chrono;
+    static const steady_clock::time_point steadyAnchor = steady_clock::now();
+    static const int64_t systemAnchorUs = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    return systemAnchorUs + duration_cast<microseconds>(time - steadyAnchor).count();
+}
+
+inline int TraceProcessId() {
+#ifdef _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+// Content types with their own row in a trace
+enum class TraceContent { Text, CustomBehavior, CustomBehaviorResult, Graph, Count };
+
+inline const char* TraceContentName(TraceContent content) {
+    switch (content) {
+        case TraceContent::Text: return "TEXT";
+        case TraceContent::CustomBehavior: return "CUSTOM_BEHAVIOR";
+        case TraceContent::CustomBehaviorResult: return "CUSTOM_BEHAVIOR_RESULT";
+        case TraceContent::Graph: return "GRAPH";
+        default: return "UNKNOWN";
+    }
+}
+
+struct ContentTrace {
+    std::chrono::steady_clock::time_point first;      // first callback
+    std::chrono::steady_clock::time_point last;       // latest callback
+    uint32_t callbacks = 0;
+    uint64_t bytes = 0;
+    bool done = false;                                // a callback had completed == 1
+};
+
+// One CUSTOM_BEHAVIOR run and the CUSTOM_BEHAVIOR_RESULT it led to
+struct ToolCallTrace {
+    std::chrono::steady_clock::time_point called;     // first CUSTOM_BEHAVIOR callback
+    std::chrono::steady_clock::time_point dispatched; // latest CUSTOM_BEHAVIOR callback
+    std::chrono::steady_clock::time_point result;     // first CUSTOM_BEHAVIOR_RESULT callback
+    std::chrono::steady_clock::time_point completed;  // CUSTOM_BEHAVIOR_RESULT completed
+    bool hasResult = false;
+    bool done = false;
+};
+
+struct RequestTrace {
+    using Clock = std::chrono::steady_clock;
+
+    // Tool calls recorded without reallocating
+    static constexpr size_t TOOL_CALL_RESERVE = 16;
+
+    explicit RequestTrace(std::string traceId) : id(std::move(traceId)) {
+        toolCalls.reserve(TOOL_CALL_RESERVE);
+    }
+
+    void OnSend(Clock::time_point start, Clock::time_point end) {
+        sendStart = start;
+        sendEnd = end;
+        sent = true;
+    }
+
+    // Callback thread, under the request's lock
+    void OnContent(TraceContent type, size_t bytes, bool isCompleted, Clock::time_point now) {
+        ContentTrace& trace = content[static_cast<size_t>(type)];
+        if (trace.callbacks == 0) trace.first = now;
+        trace.last = now;
+        trace.callbacks++;
+        trace.bytes += bytes;
+        if (isCompleted) trace.done = true;
+
+        if (type == TraceContent::CustomBehavior) {
+            // Behavior output after a result belongs to the next tool call
+            if (toolCalls.empty() || toolCalls.back().hasResult) {
+                if (toolCalls.size() == toolCalls.capacity()) return;
+                toolCalls.emplace_back();
+                toolCalls.back().called = now;
+            }
+            toolCalls.back().dispatched = now;
+        } else if (type == TraceContent::CustomBehaviorResult && !toolCalls.empty()) {
+            ToolCallTrace& call = toolCalls.back();
+            if (!call.hasResult) {
+                call.hasResult = true;
+                call.result = now;
+            }
+            if (isCompleted && !call.done) {
+                call.done = true;
+                call.completed = now;
+            }
+        }
+    }
+
+    std::string id;
+    Clock::time_point sendStart;
+    Clock::time_point sendEnd;
+    bool sent = false;
+    ContentTrace content[static_cast<size_t>(TraceContent::Count)];
+    std::vector<ToolCallTrace> toolCalls;
+};
+
+// ============================================================================
+// Chrome Trace Export
+// ============================================================================
+
+// Arguments of one trace event, rendered as a JSON object
+class TraceArgs {
+public:
+    TraceArgs& Add(const char* key, const std::string& value) {
+        AppendKey(key);
+        AppendString(json_, value);
+        return *this;
+    }
+
+    TraceArgs& Add(const char* key, const char* value) { return Add(key, std::string(value)); }
+
+    TraceArgs& Add(const char* key, double value) {
+        AppendKey(key);
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.3f", value);
+        json_ += number;
+        return *this;
+    }
+
+    TraceArgs& Add(const char* key, uint64_t value) {
+        AppendKey(key);
+        json_ += std::to_string(value);
+        return *this;
+    }
+
+    TraceArgs& Add(const char* key, bool value) {
+        AppendKey(key);
+        json_ += value ? "true" : "false";
+        return *this;
+    }
+
+    std::string Json() const { return "{" + json_ + "}"; }
+
+    static void AppendString(std::string& out, const std::string& text) {
+        out += '"';
+        for (char c : text) {
+            switch (c) {
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                        out += escaped;
+                    } else {
+                        out += c;
+                    }
+                    break;
+            }
+        }
+        out += '"';
+    }
+
+private:
+    void AppendKey(const char* key) {
+        if (!json_.empty()) json_ += ',';
+        AppendString(json_, key);
+        json_ += ':';
+    }
+
+    std::string json_;
+};
+
+/**
+ * Builds one trace file in the JSON object format:
+ *   {"traceEvents": [...], "displayTimeUnit": "ms", "otherData": {"trace_id": ...}}
+ * Every event belongs to this process; rows are numbered by the caller.
+ */
+class ChromeTraceWriter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ChromeTraceWriter(std::string traceId, const std::string& processName)
+        : traceId_(std::move(traceId)), pid_(TraceProcessId()) {
+        Metadata("process_name", 0, processName);
+    }
+
+    void ThreadName(int tid, const std::string& name) {
+        Metadata("thread_name", tid, name);
+    }
+
+    // Complete ("X") event; skipped if it never started
+    void Span(const std::string& name, const char* category, int tid,
+              Clock::time_point start, Clock::time_point end, const TraceArgs& args = TraceArgs()) {
+        if (start == Clock::time_point()) return;
+        if (end < start) end = start;
+        int64_t ts = TraceTimestampUs(start);
+        Begin(name, category, "X", tid, ts);
+        events_ += ",\"dur\":" + std::to_string(TraceTimestampUs(end) - ts);
+        events_ += ",\"args\":" + args.Json() + "}";
+    }
+
+    // Instant ("i") event
+    void Instant(const std::string& name, const char* category, int tid,
+                 Clock::time_point at, const TraceArgs& args = TraceArgs()) {
+        if (at == Clock::time_point()) return;
+        Begin(name, category, "i", tid, TraceTimestampUs(at));
+        events_ += ",\"s\":\"t\",\"args\":" + args.Json() + "}";
+    }
+
+    std::string Finish() const {
+        std::string out = "{\"traceEvents\":[" + events_ + "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"trace_id\":";
+        TraceArgs::AppendString(out, traceId_);
+        out += "}}\n";
+        return out;
+    }
+
+    bool WriteFile(const std::string& path, std::string* error = nullptr) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        std::string text = Finish();
+        if (!file || !file.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+            if (error) *error = "Cannot write " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void Begin(const std::string& name, const char* category, const char* phase, int tid, int64_t ts) {
+        if (!events_.empty()) events_ += ',';
+        events_ += "{\"name\":";
+        TraceArgs::AppendString(events_, name);
+        events_ += ",\"cat\":\"";
+        events_ += category;
+        events_ += "\",\"ph\":\"";
+        events_ += phase;
+        events_ += "\",\"ts\":" + std::to_string(ts);
+        events_ += ",\"pid\":" + std::to_string(pid_) + ",\"tid\":" + std::to_string(tid);
+    }
+
+    void Metadata(const char* kind, int tid, const std::string& name) {
+        if (!events_.empty()) events_ += ',';
+        events_ += "{\"name\":\"";
+        events_ += kind;
+        events_ += "\",\"ph\":\"M\",\"pid\":" + std::to_string(pid_) + ",\"tid\":" + std::to_string(tid);
+        events_ += ",\"args\":" + TraceArgs().Add("name", name).Json() + "}";
+    }
+
+    std::string traceId_;
+    int pid_;
+    std::string events_;
+};
+
+// Trace ids made of characters that are safe in file names
+inline std::string TraceFileName(const std::string& traceId) {
+    std::string name = traceId;
+    for (char& c : name) {
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                    c == '-' || c == '_' || c == '.';
+        if (!safe) c = '_';
+    }
+    return name + ".json";
+}
+
+} // namespace Rise
@@ -0,0 +1,231 @@
+/*
+ * Streaming Resampler
+ *
+ * Converts mono float audio between sample rates with a polyphase
+ * windowed-sinc (Kaiser) filter, e.g. 48 kHz or 44.1 kHz sources down to the
+ * 16 kHz the ASR engine works at. Resampling on the client cuts the payload
+ * and the number of NvAPI_RequestRise calls by the rate ratio.
+ *
+ * The ratio is reduced to outputRate/inputRate = L/M and the filter is
+ * stored as L phases of a fixed number of taps, so every output sample is a
+ * single dot product (SSE on x64). Filter history and the fractional
+ * position carry over between Process() calls, so audio can be fed in
+ * chunks of any size and the result is identical to resampling it in one
+ * go. Flush() emits the tail once the input has ended. Equal rates are
+ * copied through unchanged.
+ *
+ * Storage is allocated by Initialize(); Process() never allocates.
+ * Not thread-safe: use one resampler per stream.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define RESAMPLER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+class Resampler {
+public:
+    // Filter half-width in zero crossings of the output band; more is sharper
+    static constexpr int ZERO_CROSSINGS = 8;
+    // Largest supported L (e.g. 44100 -> 16000 needs 160)
+    static constexpr int MAX_PHASES = 1024;
+    // Input samples buffered per filter pass
+    static constexpr size_t BLOCK_SAMPLES = 4096;
+
+    Resampler() = default;
+
+    /**
+     * Set up for a rate pair and reset the stream. Returns false for
+     * non-positive rates or a ratio that reduces to more than MAX_PHASES
+     * phases. `rolloff` is the cutoff as a fraction of the lower Nyquist
+     * frequency.
+     */
+    bool Initialize(int inputRate, int outputRate, double rolloff = 0.94) {
+        if (inputRate <= 0 || outputRate <= 0) return false;
+
+        int divisor = std::gcd(inputRate, outputRate);
+        int up = outputRate / divisor;
+        int down = inputRate / divisor;
+        if (up > MAX_PHASES) return false;
+
+        up_ = up;
+        down_ = down;
+        inputRate_ = inputRate;
+        outputRate_ = outputRate;
+
+        // Downsampling widens the filter so the cutoff stays at the output
+        // Nyquist frequency; taps are a multiple of 8 for the SIMD loop
+        double scale = std::min(1.0, static_cast<double>(up_) / down_);
+        taps_ = static_cast<size_t>(std::ceil(2.0 * ZERO_CROSSINGS / scale));
+        taps_ = (taps_ + 7) & ~static_cast<size_t>(7);
+
+        DesignFilter(scale * rolloff);
+        buffer_.assign(taps_ + BLOCK_SAMPLES, 0.0f);
+        Reset();
+        return true;
+    }
+
+    int InputRate() const { return inputRate_; }
+    int OutputRate() const { return outputRate_; }
+    bool IsPassthrough() const { return up_ == down_; }
+    size_t Taps() const { return taps_; }
+
+    // Upper bound on the samples one Process() call produces for `count` input samples
+    size_t MaxOutput(size_t count) const {
+        return static_cast<size_t>((static_cast<uint64_t>(count) * up_ + down_ - 1) / down_) + 1;
+    }
+
+    // Upper bound on the samples Flush() produces
+    size_t MaxFlushOutput() const { return MaxOutput(taps_ / 2); }
+
+    // Forget buffered input; the next sample starts a new stream
+    void Reset() {
+        // Half a filter of leading silence centres the first output on the
+        // first input sample, so the output is not delayed
+        std::fill(buffer_.begin(), buffer_.end(), 0.0f);
+        filled_ = taps_ / 2;
+        base_ = 0;
+        phase_ = 0;
+        inputTotal_ = 0;
+        outputTotal_ = 0;
+    }
+
+    /**
+     * Resample `count` samples into `out`, which must hold MaxOutput(count).
+     * Returns the number of samples written. `out` must not overlap `in`.
+     */
+    size_t Process(const float* in, size_t count, float* out) {
+        inputTotal_ += count;
+        if (IsPassthrough()) {
+            std::copy(in, in + count, out);
+            outputTotal_ += count;
+            return count;
+        }
+
+        size_t written = 0;
+        while (count > 0) {
+            size_t n = std::min(count, buffer_.size() - filled_);
+            std::copy(in, in + n, buffer_.begin() + filled_);
+            filled_ += n;
+            in += n;
+            count -= n;
+            written += Drain(out + written, SIZE_MAX);
+        }
+        return written;
+    }
+
+    /**
+     * Emit the samples still held back by the filter once the input has
+     * ended; `out` must hold MaxFlushOutput(). The total output is then
+     * ceil(input * outputRate / inputRate). Call Reset() before reusing.
+     */
+    size_t Flush(float* out) {
+        if (IsPassthrough()) return 0;
+
+        uint64_t expected = (inputTotal_ * up_ + down_ - 1) / down_;
+        uint64_t limit = expected > outputTotal_ ? expected - outputTotal_ : 0;
+
+        size_t pad = std::min(taps_ / 2, buffer_.size() - filled_);
+        std::fill(buffer_.begin() + filled_, buffer_.begin() + filled_ + pad, 0.0f);
+        filled_ += pad;
+        return Drain(out, static_cast<size_t>(limit));
+    }
+
+private:
+    static double BesselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 32; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Phase p holds the taps for an output that falls p/L of an input
+    // sample past the centre tap; each phase is normalized to unity DC gain
+    void DesignFilter(double cutoff) {
+        const double PI = 3.14159265358979323846;
+        const double BETA = 8.0;  // Kaiser window, ~80 dB stopband
+        const double half = taps_ / 2.0;
+        const double norm = BesselI0(BETA);
+
+        coefficients_.assign(static_cast<size_t>(up_) * taps_, 0.0f);
+        std::vector<double> phase(taps_);
+        for (int p = 0; p < up_; p++) {
+            double sum = 0.0;
+            for (size_t k = 0; k < taps_; k++) {
+                double d = half + static_cast<double>(p) / up_ - static_cast<double>(k);
+                double x = cutoff * d;
+                double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(PI * x) / (PI * x);
+                double r = d / half;
+                double window = std::fabs(r) >= 1.0 ? 0.0 : BesselI0(BETA * std::sqrt(1.0 - r * r)) / norm;
+                phase[k] = sinc * window;
+                sum += phase[k];
+            }
+            for (size_t k = 0; k < taps_; k++) {
+                coefficients_[static_cast<size_t>(p) * taps_ + k] = static_cast<float>(phase[k] / sum);
+            }
+        }
+    }
+
+    static float Dot(const float* a, const float* b, size_t n) {
+#ifdef RESAMPLER_SSE
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (size_t i = 0; i < n; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        __m128 acc = _mm_add_ps(acc0, acc1);
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        return _mm_cvtss_f32(acc);
+#else
+        float sum = 0.0f;
+        for (size_t i = 0; i < n; i++) sum += a[i] * b[i];
+        return sum;
+#endif
+    }
+
+    // Produce every output whose filter window is fully buffered (at most
+    // `limit`), then move the unconsumed history to the front
+    size_t Drain(float* out, size_t limit) {
+        size_t written = 0;
+        while (base_ + taps_ <= filled_ && written < limit) {
+            out[written++] = Dot(&coefficients_[static_cast<size_t>(phase_) * taps_], &buffer_[base_], taps_);
+            phase_ += down_;
+            base_ += phase_ / up_;
+            phase_ %= up_;
+        }
+        outputTotal_ += written;
+
+        size_t consumed = std::min(base_, filled_);
+        std::copy(buffer_.begin() + consumed, buffer_.begin() + filled_, buffer_.begin());
+        filled_ -= consumed;
+        base_ -= consumed;
+        return written;
+    }
+
+    int inputRate_ = 0;
+    int outputRate_ = 0;
+    int up_ = 1;                        // L
+    int down_ = 1;                      // M
+    size_t taps_ = 0;
+    std::vector<float> coefficients_;   // up_ phases of taps_
+    std::vector<float> buffer_;         // history + current block
+    size_t filled_ = 0;                 // valid samples in buffer_
+    size_t base_ = 0;                   // first tap of the next output
+    int phase_ = 0;                     // next output's phase, 0..up_-1
+    uint64_t inputTotal_ = 0;
+    uint64_t outputTotal_ = 0;
+};
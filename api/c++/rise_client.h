@@ -0,0 +1,1374 @@
+/*
+ * RISE Client
+ *
+ * Shared client for the RISE engine, used by both the demo client (main.cpp)
+ * and gassist_cli. It owns the NVAPI callback registration and turns the one
+ * global callback into per-request state: every LLM prompt and every ASR
+ * stream is a Request with its own id, output, completion tracking and
+ * timings, so one process can keep many requests outstanding.
+ *
+ * Callback data carries no request id and the engine answers one request at
+ * a time, so the client keeps exactly one request on the engine. Submitted
+ * requests are queued and sent in order by a dispatcher thread, and every
+ * callback is routed to the id of the request that is currently active. An
+ * ASR stream holds the engine from its first chunk until ASR_FINAL.
+ *
+ * Usage:
+ *   Rise::RiseClient client;
+ *   if (client.Connect() != NVAPI_OK || !client.WaitUntilReady()) return 1;
+ *
+ *   auto a = client.SubmitLlm("first prompt");
+ *   auto b = client.SubmitLlm("second prompt");   // queued behind a
+ *   a->Wait(std::chrono::seconds(60));
+ *   std::string text = a->Text();
+ *
+ *   auto asr = client.StartAsr(16000);
+ *   asr->SendAudio(samples.data(), samples.size());
+ *   asr->Finish(std::chrono::seconds(15));
+ *   std::string transcript = asr->Transcript();
+ *
+ * Only one RiseClient may exist per process, since NVAPI keeps a single
+ * RISE callback.
+ *
+ * The driver's callback thread does as little as possible: it matches the
+ * content in place, appends it to the request's preallocated buffers, copies
+ * it into a slot of a fixed-size SPSC ring and returns. Output, event and
+ * observer handlers run on the client's delivery thread, in callback order,
+ * so a slow handler (console output, UI) never delays the next token. A
+ * request with a handler completes after its last output was handled.
+ *
+ * With SetTracing(true) every request records when each phase started and
+ * ended (see request_trace.h), and ChromeTrace() exports it. SubmitLlm()
+ * also sends the request's trace id as client_config.trace_id so that
+ * plugins receiving it can record spans under the same id.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "nvapi.h"
+#include "audio_utils.h"
+#include "base64.h"
+#include "chunk_window.h"
+#include "request_trace.h"
+#include "spsc_queue.h"
+
+namespace Rise {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto DEFAULT_READY_TIMEOUT = std::chrono::seconds(30);
+constexpr auto DEFAULT_CHUNK_ACK_TIMEOUT = std::chrono::milliseconds(5000);
+
+// How long a cancelled request may keep the engine busy before the next
+// request is sent anyway
+constexpr auto CANCEL_DRAIN_TIMEOUT = std::chrono::milliseconds(2000);
+
+// Prefixes of ASR results in TEXT callbacks
+constexpr const char ASR_INTERIM_PREFIX[] = "ASR_INTERIM:";
+constexpr const char ASR_FINAL_PREFIX[] = "ASR_FINAL:";
+
+// Reserved type for experimental features (streaming ASR PoC); not part of
+// the NV_RISE_CONTENT_TYPE enum yet
+constexpr int NV_RISE_CONTENT_TYPE_RESERVED = 10;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+inline bool StartsWith(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+// Callback content without copying; the buffer is not guaranteed to be
+// NUL-terminated when full
+inline std::string_view ContentView(const NV_RISE_CALLBACK_DATA_V1& data) {
+    return std::string_view(data.content, strnlen(data.content, sizeof(data.content)));
+}
+
+/**
+ * Escape a string for embedding in a JSON string literal
+ */
+inline std::string JsonEscape(const std::string& text) {
+    std::string result;
+    result.reserve(text.size() + 8);
+    for (char c : text) {
+        switch (c) {
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    result += escaped;
+                } else {
+                    result += c;
+                }
+                break;
+        }
+    }
+    return result;
+}
+
+/**
+ * Get human-readable name for content type
+ */
+inline const char* ContentTypeName(int contentType) {
+    switch (contentType) {
+        case NV_RISE_CONTENT_TYPE_TEXT: return "TEXT";
+        case NV_RISE_CONTENT_TYPE_GRAPH: return "GRAPH";
+        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR: return "CUSTOM_BEHAVIOR";
+        case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR_RESULT: return "CUSTOM_BEHAVIOR_RESULT";
+        case NV_RISE_CONTENT_TYPE_INSTALLING: return "INSTALLING";
+        case NV_RISE_CONTENT_TYPE_PROGRESS_UPDATE: return "PROGRESS_UPDATE";
+        case NV_RISE_CONTENT_TYPE_READY: return "READY";
+        case NV_RISE_CONTENT_TYPE_DOWNLOAD_REQUEST: return "DOWNLOAD_REQUEST";
+        case NV_RISE_CONTENT_TYPE_UPDATE_INFO: return "UPDATE_INFO";
+        default:
+            if (contentType == NV_RISE_CONTENT_TYPE_RESERVED) {
+                return "RESERVED (ASR)";
+            }
+            return "INVALID/UNKNOWN";
+    }
+}
+
+// Engine request content must fit in the fixed NVAPI buffer, NUL included
+inline bool FitsRequestContent(size_t length) {
+    return length < sizeof(NV_REQUEST_RISE_SETTINGS_V1::content);
+}
+
+// ============================================================================
+// ASR Chunk Encoding
+// ============================================================================
+
+/**
+ * Sample format of ASR chunk payloads. Float32 is what every engine accepts;
+ * Pcm16 carries twice the audio per request (half the requests and base64
+ * work) but the engine must understand the "CHUNK16:" prefix, so it is
+ * opt-in.
+ */
+enum class ChunkEncoding {
+    Float32,    // "CHUNK:<id>:<rate>:<base64 float32>"
+    Pcm16,      // "CHUNK16:<id>:<rate>:<base64 int16 little-endian>"
+};
+
+inline const char* ChunkPrefix(ChunkEncoding encoding) {
+    return encoding == ChunkEncoding::Pcm16 ? "CHUNK16:" : "CHUNK:";
+}
+
+inline const char* ChunkEncodingName(ChunkEncoding encoding) {
+    return encoding == ChunkEncoding::Pcm16 ? "int16" : "float32";
+}
+
+inline bool ParseChunkEncoding(const std::string& name, ChunkEncoding& encoding) {
+    if (name == "float32") {
+        encoding = ChunkEncoding::Float32;
+    } else if (name == "int16") {
+        encoding = ChunkEncoding::Pcm16;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+constexpr size_t ChunkBytesPerSample(ChunkEncoding encoding) {
+    return encoding == ChunkEncoding::Pcm16 ? sizeof(int16_t) : sizeof(float);
+}
+
+// Room kept for "CHUNK16:<id>:<sample_rate>:" ahead of the audio
+constexpr size_t MAX_CHUNK_HEADER = 32;
+
+// Most samples whose encoded chunk fits the request buffer (NUL included)
+constexpr size_t MaxChunkSamples(ChunkEncoding encoding) {
+    return (sizeof(NV_REQUEST_RISE_SETTINGS_V1::content) - 1 - MAX_CHUNK_HEADER) / 4 * 3 /
+           ChunkBytesPerSample(encoding);
+}
+
+// Base64 of the samples in `encoding`, written to `out`; returns its length
+inline size_t EncodeChunkAudio(ChunkEncoding encoding, const float* samples, size_t count, char* out) {
+    if (encoding == ChunkEncoding::Pcm16) {
+        return Base64::EncodeFloatAsPcm16(samples, count, out);
+    }
+    return Base64::Encode(reinterpret_cast<const uint8_t*>(samples), count * sizeof(float), out);
+}
+
+inline size_t EncodeChunkAudio(ChunkEncoding encoding, const int16_t* samples, size_t count, char* out) {
+    if (encoding == ChunkEncoding::Pcm16) {
+        return Base64::Encode(reinterpret_cast<const uint8_t*>(samples), count * sizeof(int16_t), out);
+    }
+    return Base64::EncodePcm16AsFloat(samples, count, out);
+}
+
+/**
+ * Write one chunk request, "CHUNK:<id>:<sample_rate>:<base64_data>" ("CHUNK16:"
+ * for int16), NUL-terminated into `content`. Returns its length, or 0 if it
+ * does not fit the request buffer. The sample rate can be anything; the
+ * engine resamples to 16kHz if needed.
+ */
+template <typename Sample>
+inline size_t FormatChunk(ChunkEncoding encoding, int chunkId, int sampleRate,
+                          const Sample* samples, size_t count, NvAPI_String& content) {
+    int header = std::snprintf(content, sizeof(content), "%s%d:%d:", ChunkPrefix(encoding), chunkId, sampleRate);
+    if (header < 0 ||
+        !FitsRequestContent(static_cast<size_t>(header) + Base64::EncodedLength(count * ChunkBytesPerSample(encoding)))) {
+        return 0;
+    }
+    size_t encoded = EncodeChunkAudio(encoding, samples, count, content + header);
+    content[header + encoded] = '\0';
+    return static_cast<size_t>(header) + encoded;
+}
+
+inline NvAPI_Status SendContent(const std::string& content, bool completed) {
+    NV_REQUEST_RISE_SETTINGS_V1 requestSettings = { 0 };
+    requestSettings.version = NV_REQUEST_RISE_SETTINGS_VER1;
+    requestSettings.contentType = NV_RISE_CONTENT_TYPE_TEXT;
+    strncpy_s(requestSettings.content, sizeof(requestSettings.content),
+              content.c_str(), content.length());
+    requestSettings.completed = completed ? 1 : 0;
+    return NvAPI_RequestRise(&requestSettings);
+}
+
+// ============================================================================
+// Request
+// ============================================================================
+
+enum class RequestKind { Llm, Asr };
+
+enum class RequestState { Queued, Active, Completed, Failed };
+
+/**
+ * What a callback delivered to a request. ASR results are passed without
+ * their "ASR_INTERIM:"/"ASR_FINAL:" prefix.
+ */
+enum class OutputKind { Text, CustomBehavior, CustomBehaviorResult, Graph, AsrInterim, AsrFinal };
+
+using OutputHandler = std::function<void(OutputKind kind, const std::string& content)>;
+
+// What one callback produced for its request; `content` points into the
+// callback data
+struct CallbackOutput {
+    bool present = false;
+    OutputKind kind = OutputKind::Text;
+    std::string_view content;
+};
+
+struct RequestTimings {
+    Clock::time_point submitted;   // handed to the client
+    Clock::time_point started;     // became active on the engine
+    Clock::time_point firstToken;  // first non-empty output
+    Clock::time_point finished;    // completed or failed
+    bool hasFirstToken = false;
+
+    static double Ms(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    double QueueMs() const { return Ms(submitted, started); }
+    double TimeToFirstTokenMs() const { return hasFirstToken ? Ms(started, firstToken) : 0.0; }
+    double TotalMs() const { return Ms(started, finished); }
+};
+
+class RiseClient;
+
+/**
+ * State of one LLM prompt or ASR stream. Held by shared_ptr so the caller
+ * can keep it after the client is done with it.
+ */
+class Request {
+public:
+    // Reserved up front so appending a token on the callback thread does not
+    // reallocate for typical responses
+    static constexpr size_t TEXT_RESERVE = 16 * 1024;
+
+    Request(uint64_t id, RequestKind kind, OutputHandler handler)
+        : id_(id), kind_(kind), handler_(std::move(handler)) {
+        timings_.submitted = Clock::now();
+        text_.reserve(TEXT_RESERVE);
+    }
+    virtual ~Request() = default;
+
+    Request(const Request&) = delete;
+    Request& operator=(const Request&) = delete;
+
+    uint64_t Id() const { return id_; }
+    RequestKind Kind() const { return kind_; }
+
+    RequestState State() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return state_;
+    }
+
+    bool IsDone() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return IsDoneLocked();
+    }
+
+    bool Succeeded() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return state_ == RequestState::Completed;
+    }
+
+    // Block until the request reaches the engine (or finishes without
+    // getting there); false if it is still queued after the timeout
+    bool WaitUntilStarted(std::chrono::milliseconds timeout) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return condition_.wait_for(lock, timeout, [this] { return state_ != RequestState::Queued; });
+    }
+
+    // Block until the request completes or fails; false on timeout
+    bool Wait(std::chrono::milliseconds timeout) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return condition_.wait_for(lock, timeout, [this] { return IsDoneLocked(); });
+    }
+
+    // Accumulated TEXT and CUSTOM_BEHAVIOR(_RESULT) output
+    std::string Text() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return text_;
+    }
+
+    // Accumulated GRAPH output
+    std::string Chart() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return chart_;
+    }
+
+    // Latest ASR_INTERIM transcript
+    std::string Interim() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return interim_;
+    }
+
+    // ASR_FINAL transcript
+    std::string Transcript() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return transcript_;
+    }
+
+    std::string Error() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+
+    RequestTimings Timings() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return timings_;
+    }
+
+    // Empty unless the request was submitted with tracing on
+    std::string TraceId() const {
+        return trace_ ? trace_->id : std::string();
+    }
+
+    /**
+     * The request's phases as Chrome trace JSON: queueing, the
+     * NvAPI_RequestRise call, time to first token, one row per content type
+     * from its first callback to its last, and tool calls split into
+     * the model's CUSTOM_BEHAVIOR output, the wait for the result (tool
+     * dispatch and the plugin) and the CUSTOM_BEHAVIOR_RESULT output. Empty
+     * unless the request was traced.
+     */
+    std::string ChromeTrace() const {
+        if (!trace_) return std::string();
+        std::lock_guard<std::mutex> lock(mutex_);
+        const RequestTrace& trace = *trace_;
+        Clock::time_point end = IsDoneLocked() ? timings_.finished : Clock::now();
+
+        enum { REQUEST_ROW = 1, CONTENT_ROW = 2, TOOL_ROW = CONTENT_ROW + static_cast<int>(TraceContent::Count) };
+
+        ChromeTraceWriter writer(trace.id, "RISE client");
+        writer.ThreadName(REQUEST_ROW, "request");
+
+        const char* state = state_ == RequestState::Completed ? "completed"
+                          : state_ == RequestState::Failed ? "failed" : "in progress";
+        writer.Span("queued", "client", REQUEST_ROW, timings_.submitted, timings_.started);
+        writer.Span(kind_ == RequestKind::Llm ? "LLM request" : "ASR session", "client", REQUEST_ROW,
+                    timings_.started, end,
+                    TraceArgs().Add("request_id", id_).Add("state", state).Add("error", error_));
+        if (trace.sent) {
+            writer.Span("NvAPI_RequestRise", "client", REQUEST_ROW, trace.sendStart, trace.sendEnd);
+        }
+        if (timings_.hasFirstToken) {
+            writer.Span("time to first token", "model", REQUEST_ROW, timings_.started, timings_.firstToken);
+        }
+
+        for (size_t i = 0; i < static_cast<size_t>(TraceContent::Count); i++) {
+            const ContentTrace& content = trace.content[i];
+            if (content.callbacks == 0) continue;
+            const char* name = TraceContentName(static_cast<TraceContent>(i));
+            int row = CONTENT_ROW + static_cast<int>(i);
+            writer.ThreadName(row, name);
+            writer.Span(name, "callback", row, content.first, content.last,
+                        TraceArgs().Add("callbacks", static_cast<uint64_t>(content.callbacks))
+                                   .Add("bytes", content.bytes).Add("completed", content.done));
+        }
+
+        if (!trace.toolCalls.empty()) writer.ThreadName(TOOL_ROW, "tool calls");
+        for (size_t i = 0; i < trace.toolCalls.size(); i++) {
+            const ToolCallTrace& call = trace.toolCalls[i];
+            Clock::time_point callEnd = call.done ? call.completed : call.hasResult ? call.result : end;
+            writer.Span("tool call " + std::to_string(i + 1), "tool", TOOL_ROW, call.called, callEnd,
+                        TraceArgs().Add("has_result", call.hasResult));
+            writer.Span("model: CUSTOM_BEHAVIOR", "model", TOOL_ROW, call.called, call.dispatched);
+            if (call.hasResult) {
+                writer.Span("tool dispatch + plugin", "tool", TOOL_ROW, call.dispatched, call.result);
+                writer.Span("CUSTOM_BEHAVIOR_RESULT", "tool", TOOL_ROW, call.result, callEnd);
+            }
+        }
+        return writer.Finish();
+    }
+
+protected:
+    friend class RiseClient;
+
+    // Per-content-type completion tracking (bitmask). A type becomes
+    // "expected" when we receive data or a completion for it, and the
+    // request completes once every expected type has completed.
+    static constexpr unsigned CT_TEXT                    = 1u << 0;
+    static constexpr unsigned CT_CUSTOM_BEHAVIOR         = 1u << 1;
+    static constexpr unsigned CT_CUSTOM_BEHAVIOR_RESULT  = 1u << 2;
+    static constexpr unsigned CT_GRAPH                   = 1u << 3;
+
+    bool IsDoneLocked() const {
+        return state_ == RequestState::Completed || state_ == RequestState::Failed;
+    }
+
+    bool AllExpectedTypesComplete() const {
+        return expectedTypes_ != 0 &&
+               (completedTypes_ & expectedTypes_) == expectedTypes_;
+    }
+
+    // Called under mutex_ when the request becomes active
+    virtual void OnActivated() {}
+
+    void TraceCallbackLocked(const NV_RISE_CALLBACK_DATA_V1& data, size_t bytes) {
+        TraceContent type;
+        switch (data.contentType) {
+            case NV_RISE_CONTENT_TYPE_TEXT: type = TraceContent::Text; break;
+            case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR: type = TraceContent::CustomBehavior; break;
+            case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR_RESULT: type = TraceContent::CustomBehaviorResult; break;
+            case NV_RISE_CONTENT_TYPE_GRAPH: type = TraceContent::Graph; break;
+            default: return;
+        }
+        trace_->OnContent(type, bytes, data.completed == 1, Clock::now());
+    }
+
+    // Runs on the callback thread; must not block. Returns true when the
+    // request is finished by this callback. Output to report to the handler
+    // is set in `output`.
+    virtual bool OnCallbackLocked(const NV_RISE_CALLBACK_DATA_V1& data, std::string_view chunk,
+                                  CallbackOutput& output) {
+        unsigned type = 0;
+        OutputKind kind = OutputKind::Text;
+
+        switch (data.contentType) {
+            case NV_RISE_CONTENT_TYPE_TEXT:
+                type = CT_TEXT;
+                kind = OutputKind::Text;
+                break;
+            case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR:
+                type = CT_CUSTOM_BEHAVIOR;
+                kind = OutputKind::CustomBehavior;
+                break;
+            case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR_RESULT:
+                type = CT_CUSTOM_BEHAVIOR_RESULT;
+                kind = OutputKind::CustomBehaviorResult;
+                break;
+            case NV_RISE_CONTENT_TYPE_GRAPH:
+                type = CT_GRAPH;
+                kind = OutputKind::Graph;
+                break;
+            default:
+                return false;
+        }
+
+        if (!chunk.empty()) {
+            if (kind == OutputKind::Graph) {
+                chart_ += chunk;
+            } else {
+                text_ += chunk;
+            }
+            MarkFirstTokenLocked();
+            output.present = true;
+            output.kind = kind;
+            output.content = chunk;
+            expectedTypes_ |= type;
+        }
+
+        if (data.completed == 1) {
+            expectedTypes_ |= type;
+            completedTypes_ |= type;
+            return AllExpectedTypesComplete();
+        }
+        return false;
+    }
+
+    void MarkFirstTokenLocked() {
+        if (!timings_.hasFirstToken) {
+            timings_.hasFirstToken = true;
+            timings_.firstToken = Clock::now();
+        }
+    }
+
+    // Returns false if the request was already finished
+    bool FinishLocked(RequestState state, const std::string& error = std::string()) {
+        if (IsDoneLocked()) return false;
+        state_ = state;
+        error_ = error;
+        timings_.finished = Clock::now();
+        if (timings_.started == Clock::time_point()) {
+            timings_.started = timings_.finished;
+        }
+        condition_.notify_all();
+        return true;
+    }
+
+    const uint64_t id_;
+    const RequestKind kind_;
+    const OutputHandler handler_;
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable condition_;
+    RequestState state_ = RequestState::Queued;
+    std::string text_;
+    std::string chart_;
+    std::string interim_;
+    std::string transcript_;
+    std::string error_;
+    unsigned expectedTypes_ = 0;
+    unsigned completedTypes_ = 0;
+    RequestTimings timings_;
+    std::unique_ptr<RequestTrace> trace_;   // set before the request is queued, if tracing
+};
+
+/**
+ * An LLM prompt. Sent by the dispatcher as soon as the engine is free.
+ */
+class LlmRequest : public Request {
+public:
+    LlmRequest(uint64_t id, std::string content, OutputHandler handler)
+        : Request(id, RequestKind::Llm, std::move(handler)), content_(std::move(content)) {}
+
+    const std::string& Content() const { return content_; }
+
+private:
+    std::string content_;
+};
+
+/**
+ * A streamed ASR session. Audio is sent from the caller's thread as
+ * "CHUNK:<id>:<sample_rate>:<base64 float32>" (or "CHUNK16:" with int16
+ * samples, see ChunkEncoding) with up to `window` chunks in flight;
+ * Finish() sends STOP and waits for ASR_FINAL.
+ */
+class AsrSession : public Request {
+public:
+    // Float32 chunk size of the reference clients, ~44 ms at 16 kHz
+    static constexpr size_t SAMPLES_PER_CHUNK = 700;
+
+    // Samples per chunk: SAMPLES_PER_CHUNK for float32, otherwise as many as
+    // fit the request buffer (1522 for int16)
+    static constexpr size_t ChunkSamplesFor(ChunkEncoding encoding) {
+        return encoding == ChunkEncoding::Float32 ? SAMPLES_PER_CHUNK : MaxChunkSamples(encoding);
+    }
+
+    AsrSession(uint64_t id, RiseClient& client, int sampleRate, size_t window, OutputHandler handler,
+               ChunkEncoding encoding = ChunkEncoding::Float32)
+        : Request(id, RequestKind::Asr, std::move(handler)),
+          client_(client), sampleRate_(sampleRate), window_(window), encoding_(encoding),
+          chunkSamples_(ChunkSamplesFor(encoding)) {
+        interim_.reserve(sizeof(NV_RISE_CALLBACK_DATA_V1::content));
+        transcript_.reserve(sizeof(NV_RISE_CALLBACK_DATA_V1::content));
+    }
+
+    int SampleRate() const { return sampleRate_; }
+    ChunkEncoding Encoding() const { return encoding_; }
+
+    // ChunkSamplesFor(Encoding()). Sending multiples of this keeps every
+    // chunk but the last one full.
+    size_t ChunkSamples() const { return chunkSamples_; }
+
+    // Send float32 samples (-1..1), split into ChunkSamples() chunks.
+    // Blocks while the session is queued behind other requests and while
+    // the chunk window is full.
+    bool SendAudio(const float* samples, size_t count,
+                   std::chrono::milliseconds timeout = DEFAULT_CHUNK_ACK_TIMEOUT) {
+        return SendChunks(samples, count, timeout);
+    }
+
+    // Same for 16-bit PCM; converted to float32 while encoding unless the
+    // session sends int16 chunks
+    bool SendAudio(const int16_t* samples, size_t count,
+                   std::chrono::milliseconds timeout = DEFAULT_CHUNK_ACK_TIMEOUT) {
+        return SendChunks(samples, count, timeout);
+    }
+
+    // Wait for outstanding chunks, send STOP and wait for the final
+    // transcript; false on failure or timeout (see Error())
+    bool Finish(std::chrono::milliseconds timeout);
+
+    // Chunk throughput; frozen once Finish() has drained the window so the
+    // wait for the final transcript is not counted
+    ChunkWindow::Stats ChunkStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stopping_ ? streamStats_ : chunkWindow_.GetStats();
+    }
+
+    size_t WindowSize() const { return window_; }
+
+protected:
+    void OnActivated() override {
+        chunkWindow_.Begin(window_);
+    }
+
+    bool OnCallbackLocked(const NV_RISE_CALLBACK_DATA_V1& data, std::string_view chunk,
+                          CallbackOutput& output) override {
+        if (data.contentType != NV_RISE_CONTENT_TYPE_TEXT) {
+            return false;
+        }
+
+        // Assigning into the reserved strings reuses their storage
+        if (StartsWith(chunk, ASR_INTERIM_PREFIX)) {
+            chunk.remove_prefix(sizeof(ASR_INTERIM_PREFIX) - 1);
+            interim_.assign(chunk.data(), chunk.size());
+            MarkFirstTokenLocked();
+            output = { true, OutputKind::AsrInterim, chunk };
+        } else if (StartsWith(chunk, ASR_FINAL_PREFIX)) {
+            chunk.remove_prefix(sizeof(ASR_FINAL_PREFIX) - 1);
+            transcript_.assign(chunk.data(), chunk.size());
+            finalReceived_ = true;
+            MarkFirstTokenLocked();
+            output = { true, OutputKind::AsrFinal, chunk };
+        }
+
+        if (data.completed != 1) {
+            return false;
+        }
+
+        // While audio is streaming, every completed TEXT callback is a chunk
+        // acknowledgment and retires the oldest chunk in the window
+        if (!stopping_) {
+            chunkWindow_.Acknowledge();
+            return false;
+        }
+        return finalReceived_;
+    }
+
+private:
+    friend class RiseClient;
+
+    template <typename Sample>
+    bool SendChunks(const Sample* samples, size_t count, std::chrono::milliseconds timeout);
+
+    bool WaitUntilActive(std::chrono::milliseconds timeout) {
+        WaitUntilStarted(timeout);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return state_ == RequestState::Active && !stopping_;
+    }
+
+    RiseClient& client_;
+    const int sampleRate_;
+    const size_t window_;
+    const ChunkEncoding encoding_;
+    const size_t chunkSamples_;
+    ChunkWindow chunkWindow_;
+    int nextChunkId_ = 0;          // caller thread only
+    NV_REQUEST_RISE_SETTINGS_V1 chunkRequest_ = {};  // caller thread only; chunks are encoded in place
+    ChunkWindow::Stats streamStats_;
+    bool stopping_ = false;
+    bool finalReceived_ = false;
+};
+
+// ============================================================================
+// RiseClient
+// ============================================================================
+
+class RiseClient {
+public:
+    // READY, PROGRESS_UPDATE, INSTALLING, DOWNLOAD_REQUEST and other
+    // callbacks that do not belong to a request
+    using EventHandler = std::function<void(const NV_RISE_CALLBACK_DATA_V1& data)>;
+
+    // Called once per request when it completes or fails, on whichever
+    // thread finished it. No client lock is held, so it may call into the
+    // client; it should not block, since that thread may be the delivery
+    // thread or a caller of Cancel().
+    using CompletionHandler = std::function<void(const std::shared_ptr<Request>& request)>;
+
+    // Callbacks that can wait for the delivery thread before the ring is
+    // full and deliveries spill into an allocating overflow list
+    static constexpr size_t DELIVERY_QUEUE_SIZE = 128;
+
+    RiseClient() : deliveries_(DELIVERY_QUEUE_SIZE) {
+        std::lock_guard<std::mutex> lock(InstanceMutex());
+        Instance() = this;
+    }
+
+    ~RiseClient() {
+        {
+            std::lock_guard<std::mutex> lock(InstanceMutex());
+            if (Instance() == this) Instance() = nullptr;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        if (dispatcher_.joinable()) {
+            dispatcher_.join();
+        }
+
+        // No callbacks arrive any more; hand out what is still queued
+        {
+            std::lock_guard<std::mutex> lock(deliveryMutex_);
+            deliveryStopping_ = true;
+        }
+        deliveryCondition_.notify_all();
+        if (deliveryThread_.joinable()) {
+            deliveryThread_.join();
+        }
+
+        std::deque<std::shared_ptr<Request>> remaining;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            remaining.swap(queue_);
+            if (active_) remaining.push_back(std::move(active_));
+        }
+        for (auto& request : remaining) {
+            FinishRequest(request, RequestState::Failed, "client shut down");
+        }
+    }
+
+    RiseClient(const RiseClient&) = delete;
+    RiseClient& operator=(const RiseClient&) = delete;
+
+    // Set before Connect()
+    void SetEventHandler(EventHandler handler) { eventHandler_ = std::move(handler); }
+
+    // Sees every callback, before the output it produced is delivered (debug logging)
+    void SetObserver(EventHandler observer) { observer_ = std::move(observer); }
+
+    // Set before the first request is submitted
+    void SetCompletionHandler(CompletionHandler handler) { completionHandler_ = std::move(handler); }
+
+    // Record phase timestamps of requests submitted from now on (see ChromeTrace())
+    void SetTracing(bool enabled) { tracing_.store(enabled); }
+    bool IsTracing() const { return tracing_.load(); }
+
+    /**
+     * Initialize NVAPI, register the RISE callback and start the dispatcher
+     * and delivery threads
+     */
+    NvAPI_Status Connect() {
+        NvAPI_Status status = NvAPI_Initialize();
+        if (status != NVAPI_OK) {
+            return status;
+        }
+
+        NV_RISE_CALLBACK_SETTINGS_V1 callbackSettings = { 0 };
+        callbackSettings.version = NV_RISE_CALLBACK_SETTINGS_VER1;
+        callbackSettings.super.pCallbackParam = this;
+        callbackSettings.callback = &RiseClient::Trampoline;
+
+        status = NvAPI_RegisterRiseCallback(&callbackSettings);
+        if (status != NVAPI_OK) {
+            return status;
+        }
+
+        if (!deliveryThread_.joinable()) {
+            deliveryThread_ = std::thread([this] { DeliveryLoop(); });
+        }
+        if (!dispatcher_.joinable()) {
+            dispatcher_ = std::thread([this] { DispatchLoop(); });
+        }
+        return NVAPI_OK;
+    }
+
+    // Block until the engine reports READY; false on timeout
+    bool WaitUntilReady(std::chrono::milliseconds timeout = DEFAULT_READY_TIMEOUT) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return condition_.wait_for(lock, timeout, [this] { return systemReady_; });
+    }
+
+    bool IsReady() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return systemReady_;
+    }
+
+    /**
+     * Queue an LLM prompt. Returns immediately; the request is sent once
+     * every request submitted before it has finished.
+     */
+    std::shared_ptr<Request> SubmitLlm(const std::string& prompt, OutputHandler handler = nullptr) {
+        // Format: {"prompt": "...", "context_assist": {}, "client_config": {}}
+        std::string traceId = NewTraceId();
+        std::string clientConfig = traceId.empty() ? "{}" : "{\"trace_id\":\"" + JsonEscape(traceId) + "\"}";
+        std::string content = "{\"prompt\":\"" + JsonEscape(prompt) +
+                              "\",\"context_assist\":{},\"client_config\":" + clientConfig + "}";
+        return Submit(std::move(content), std::move(handler), std::move(traceId));
+    }
+
+    /**
+     * Queue a prompt whose request JSON the caller built, for callers that
+     * fill in context_assist or client_config. A traced request's id is not
+     * added to the content.
+     */
+    std::shared_ptr<Request> SubmitLlmContent(std::string content, OutputHandler handler = nullptr) {
+        return Submit(std::move(content), std::move(handler), NewTraceId());
+    }
+
+    /**
+     * Queue an ASR session. Returns immediately; SendAudio() blocks until
+     * the session reaches the engine.
+     */
+    std::shared_ptr<AsrSession> StartAsr(int sampleRate,
+                                         size_t window = ChunkWindow::DEFAULT_CAPACITY,
+                                         OutputHandler handler = nullptr,
+                                         ChunkEncoding encoding = ChunkEncoding::Float32) {
+        std::string traceId = NewTraceId();
+        std::shared_ptr<AsrSession> session;
+        bool queued;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            session = std::make_shared<AsrSession>(nextId_++, *this, sampleRate, window, std::move(handler), encoding);
+            if (!traceId.empty()) session->trace_ = std::make_unique<RequestTrace>(std::move(traceId));
+            queued = Enqueue(session);
+        }
+        if (!queued) FinishRequest(session, RequestState::Failed, "client shut down");
+        return session;
+    }
+
+    /**
+     * Give up on a request. A queued request is dropped; an active one is
+     * failed and the engine gets a short grace period to finish its output
+     * before the next request is sent. Returns false if already finished.
+     */
+    bool Cancel(const std::shared_ptr<Request>& request, const std::string& reason = "cancelled") {
+        bool active = false;
+        bool finished;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = std::find(queue_.begin(), queue_.end(), request);
+            if (it != queue_.end()) {
+                queue_.erase(it);
+            } else if (active_ == request) {
+                active = true;
+                draining_ = true;
+                drainDeadline_ = Clock::now() + CANCEL_DRAIN_TIMEOUT;
+                active_.reset();
+                condition_.notify_all();
+            } else {
+                return false;
+            }
+            finished = MarkFinished(request, RequestState::Failed, reason);
+        }
+        if (finished) NotifyFinished(request);
+        return finished || active;
+    }
+
+    size_t PendingCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size() + (active_ ? 1 : 0);
+    }
+
+    // Callbacks that found the delivery ring full; nonzero means handlers
+    // are too slow for the output rate or DELIVERY_QUEUE_SIZE is too small
+    uint64_t DeliveryOverflows() const {
+        std::lock_guard<std::mutex> lock(overflowMutex_);
+        return overflowCount_;
+    }
+
+private:
+    friend class AsrSession;
+
+    // NVAPI keeps one callback per process; the instance pointer is cleared
+    // under InstanceMutex() on destruction so late callbacks are dropped
+    static std::mutex& InstanceMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static RiseClient*& Instance() {
+        static RiseClient* instance = nullptr;
+        return instance;
+    }
+
+    std::shared_ptr<Request> Submit(std::string content, OutputHandler handler, std::string traceId) {
+        std::shared_ptr<LlmRequest> request;
+        const char* error = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            request = std::make_shared<LlmRequest>(nextId_++, std::move(content), std::move(handler));
+            if (!traceId.empty()) request->trace_ = std::make_unique<RequestTrace>(std::move(traceId));
+            if (!FitsRequestContent(request->Content().size())) {
+                error = "prompt too long";
+            } else if (!Enqueue(request)) {
+                error = "client shut down";
+            }
+        }
+        if (error) FinishRequest(request, RequestState::Failed, error);
+        return request;
+    }
+
+    // "rise-<client start, us since the epoch>-<sequence>"; empty when not tracing
+    std::string NewTraceId() {
+        if (!tracing_.load()) return std::string();
+        return tracePrefix_ + std::to_string(traceSequence_.fetch_add(1) + 1);
+    }
+
+    static void __cdecl Trampoline(NV_RISE_CALLBACK_DATA_V1* pData) {
+        if (!pData) return;
+        std::lock_guard<std::mutex> lock(InstanceMutex());
+        if (RiseClient* client = Instance()) {
+            client->OnCallback(*pData);
+        }
+    }
+
+    // Caller holds mutex_. False if the client is shutting down; the caller
+    // then fails the request once it has released mutex_.
+    bool Enqueue(const std::shared_ptr<Request>& request) {
+        if (stopping_) return false;
+        queue_.push_back(request);
+        condition_.notify_all();
+        return true;
+    }
+
+    // Finish a request and run the completion handler. Never called with
+    // mutex_ held; code that must finish a request under it uses
+    // MarkFinished() there and NotifyFinished() after unlocking.
+    bool FinishRequest(const std::shared_ptr<Request>& request, RequestState state,
+                       const std::string& error = std::string()) {
+        bool finished = MarkFinished(request, state, error);
+        if (finished) NotifyFinished(request);
+        return finished;
+    }
+
+    // True if this call finished the request. Wakes its waiters but runs
+    // no handler, so it is safe under mutex_.
+    bool MarkFinished(const std::shared_ptr<Request>& request, RequestState state, const std::string& error) {
+        std::lock_guard<std::mutex> lock(request->mutex_);
+        return request->FinishLocked(state, error);
+    }
+
+    void NotifyFinished(const std::shared_ptr<Request>& request) {
+        if (completionHandler_) completionHandler_(request);
+    }
+
+    void DispatchLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            condition_.wait(lock, [this] {
+                return stopping_ || (!active_ && !queue_.empty());
+            });
+            if (stopping_) return;
+
+            if (draining_) {
+                condition_.wait_until(lock, drainDeadline_, [this] { return stopping_ || !draining_; });
+                draining_ = false;
+                continue;
+            }
+
+            std::shared_ptr<Request> request = queue_.front();
+            queue_.pop_front();
+            active_ = request;
+            {
+                std::lock_guard<std::mutex> requestLock(request->mutex_);
+                request->state_ = RequestState::Active;
+                request->timings_.started = Clock::now();
+                request->OnActivated();
+                request->condition_.notify_all();
+            }
+
+            // ASR sessions send their own chunks from the caller's thread
+            if (request->kind_ != RequestKind::Llm) {
+                continue;
+            }
+
+            std::string content = static_cast<LlmRequest&>(*request).Content();
+            lock.unlock();
+            Clock::time_point sendStart = Clock::now();
+            NvAPI_Status status = SendContent(content, true);
+            if (request->trace_) {
+                Clock::time_point sendEnd = Clock::now();
+                std::lock_guard<std::mutex> requestLock(request->mutex_);
+                request->trace_->OnSend(sendStart, sendEnd);
+            }
+            lock.lock();
+
+            if (status != NVAPI_OK && active_ == request) {
+                bool finished = MarkFinished(request, RequestState::Failed,
+                                             "NvAPI_RequestRise failed with status " + std::to_string(status));
+                active_.reset();
+                if (finished) {
+                    lock.unlock();
+                    NotifyFinished(request);
+                    lock.lock();
+                }
+            }
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Callback thread
+    // ------------------------------------------------------------------------
+
+    // Runs on the driver's thread: update state, queue work for the delivery
+    // thread and return. Never calls a handler and never waits on one.
+    void OnCallback(const NV_RISE_CALLBACK_DATA_V1& data) {
+        std::string_view content = ContentView(data);
+        std::shared_ptr<Request> request;
+        CallbackOutput output;
+        bool finished = false;
+        bool event = false;
+
+        switch (data.contentType) {
+            case NV_RISE_CONTENT_TYPE_TEXT:
+            case NV_RISE_CONTENT_TYPE_GRAPH:
+            case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR:
+            case NV_RISE_CONTENT_TYPE_CUSTOM_BEHAVIOR_RESULT:
+                request = RouteToActive(data, content, output, finished);
+                if (request && !request->handler_) {
+                    request.reset();
+                }
+                break;
+
+            case NV_RISE_CONTENT_TYPE_READY:
+                if (data.completed == 1) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    systemReady_ = true;
+                    condition_.notify_all();
+                }
+                event = true;
+                break;
+
+            default:
+                event = true;
+                break;
+        }
+
+        event = event && eventHandler_;
+        if (request || event || observer_) {
+            Post(data, content, std::move(request), output, finished, event);
+        }
+    }
+
+    /**
+     * Apply a callback to the request that is on the engine. Returns that
+     * request, or null if there is none. `finished` is set when this
+     * callback completes it; requests without a handler are completed here,
+     * the others once the delivery thread has handed out their output.
+     */
+    std::shared_ptr<Request> RouteToActive(const NV_RISE_CALLBACK_DATA_V1& data, std::string_view content,
+                                           CallbackOutput& output, bool& finished) {
+        std::shared_ptr<Request> request;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!active_) {
+                // Trailing output of a cancelled request
+                if (draining_ && data.completed == 1) {
+                    draining_ = false;
+                    condition_.notify_all();
+                }
+                return nullptr;
+            }
+            request = active_;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(request->mutex_);
+            if (request->IsDoneLocked()) return nullptr;
+            if (request->trace_) request->TraceCallbackLocked(data, content.size());
+            finished = request->OnCallbackLocked(data, content, output);
+        }
+
+        if (finished) {
+            bool notify = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!request->handler_) {
+                    notify = MarkFinished(request, RequestState::Completed, std::string());
+                }
+                if (active_ == request) {
+                    active_.reset();
+                    condition_.notify_all();
+                }
+            }
+            if (notify) NotifyFinished(request);
+        }
+        return request;
+    }
+
+    // Copy the callback into the next ring slot. If the ring is full the
+    // delivery goes to the overflow list, and so does everything after it
+    // until the delivery thread has caught up, which keeps the order.
+    void Post(const NV_RISE_CALLBACK_DATA_V1& data, std::string_view content,
+              std::shared_ptr<Request> request, const CallbackOutput& output, bool finished, bool event) {
+        Delivery* slot = overflowing_.load(std::memory_order_acquire) ? nullptr : deliveries_.Reserve();
+        Delivery spilled;
+        Delivery& delivery = slot ? *slot : spilled;
+
+        delivery.data.super = data.super;
+        delivery.data.contentType = data.contentType;
+        delivery.data.completed = data.completed;
+        std::memcpy(delivery.data.content, content.data(), content.size());
+        if (content.size() < sizeof(delivery.data.content)) {
+            delivery.data.content[content.size()] = '\0';
+        }
+
+        delivery.request = std::move(request);
+        delivery.hasOutput = delivery.request && output.present;
+        delivery.kind = output.kind;
+        delivery.outputOffset = delivery.hasOutput ? static_cast<size_t>(output.content.data() - data.content) : 0;
+        delivery.outputLength = delivery.hasOutput ? output.content.size() : 0;
+        delivery.finish = delivery.request && finished;
+        delivery.event = event;
+
+        if (slot) {
+            deliveries_.Commit();
+        } else {
+            std::lock_guard<std::mutex> lock(overflowMutex_);
+            overflow_.push_back(std::move(spilled));
+            overflowing_.store(true, std::memory_order_release);
+            overflowCount_++;
+        }
+
+        // Only take the lock when the delivery thread may be asleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (deliveryIdle_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(deliveryMutex_);
+            deliveryCondition_.notify_one();
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Delivery thread
+    // ------------------------------------------------------------------------
+
+    // One callback as seen by the delivery thread. The content is copied
+    // because the driver reuses its buffer once the callback returns.
+    struct Delivery {
+        NV_RISE_CALLBACK_DATA_V1 data;
+        std::shared_ptr<Request> request;   // has a handler; output and completion target
+        OutputKind kind = OutputKind::Text;
+        size_t outputOffset = 0;            // output is data.content[offset, offset + length)
+        size_t outputLength = 0;
+        bool hasOutput = false;
+        bool finish = false;
+        bool event = false;
+    };
+
+    bool HasDeliveries() const {
+        return !deliveries_.Empty() || overflowing_.load(std::memory_order_acquire);
+    }
+
+    void DeliveryLoop() {
+        std::string content;   // reused, so handing out a token doesn't allocate
+        std::deque<Delivery> spilled;
+
+        while (true) {
+            size_t ready = deliveries_.Size();
+            if (overflowing_.load(std::memory_order_acquire)) {
+                // Nothing enters the ring while overflowing_ is set, so the
+                // slots counted under the lock are all older than the list
+                std::lock_guard<std::mutex> lock(overflowMutex_);
+                ready = deliveries_.Size();
+                spilled.swap(overflow_);
+                overflowing_.store(false, std::memory_order_release);
+            }
+
+            for (; ready > 0; ready--) {
+                Delivery* delivery = deliveries_.Front();
+                Deliver(*delivery, content);
+                delivery->request.reset();
+                deliveries_.Pop();
+            }
+            for (const auto& delivery : spilled) {
+                Deliver(delivery, content);
+            }
+            spilled.clear();
+
+            std::unique_lock<std::mutex> lock(deliveryMutex_);
+            deliveryIdle_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            deliveryCondition_.wait(lock, [this] { return deliveryStopping_ || HasDeliveries(); });
+            deliveryIdle_.store(false, std::memory_order_relaxed);
+            if (deliveryStopping_ && !HasDeliveries()) return;
+        }
+    }
+
+    void Deliver(const Delivery& delivery, std::string& content) {
+        if (observer_) observer_(delivery.data);
+        if (delivery.event) eventHandler_(delivery.data);
+
+        const std::shared_ptr<Request>& request = delivery.request;
+        if (!request) return;
+
+        // Output of a request that was cancelled meanwhile is dropped
+        if (delivery.hasOutput && !request->IsDone()) {
+            content.assign(delivery.data.content + delivery.outputOffset, delivery.outputLength);
+            request->handler_(delivery.kind, content);
+        }
+        if (delivery.finish) {
+            FinishRequest(request, RequestState::Completed);
+        }
+    }
+
+    // Called by AsrSession on the caller's thread
+    bool FailActive(const std::shared_ptr<Request>& request, const std::string& error) {
+        bool finished;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (active_ == request) {
+                active_.reset();
+                condition_.notify_all();
+            }
+            finished = MarkFinished(request, RequestState::Failed, error);
+        }
+        if (finished) NotifyFinished(request);
+        return finished;
+    }
+
+    std::shared_ptr<Request> SelfFor(const Request* request) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (active_.get() == request) return active_;
+        return nullptr;
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    bool systemReady_ = false;
+    bool stopping_ = false;
+    bool draining_ = false;
+    Clock::time_point drainDeadline_;
+    uint64_t nextId_ = 1;
+    std::deque<std::shared_ptr<Request>> queue_;
+    std::shared_ptr<Request> active_;
+    std::thread dispatcher_;
+    EventHandler eventHandler_;
+    EventHandler observer_;
+    CompletionHandler completionHandler_;
+    std::atomic<bool> tracing_{ false };
+    std::atomic<uint64_t> traceSequence_{ 0 };
+    const std::string tracePrefix_ = "rise-" + std::to_string(TraceTimestampUs(Clock::now())) + "-";
+
+    // Callback thread -> delivery thread
+    SpscQueue<Delivery> deliveries_;
+    std::atomic<bool> overflowing_{ false };
+    mutable std::mutex overflowMutex_;
+    std::deque<Delivery> overflow_;
+    uint64_t overflowCount_ = 0;
+    std::mutex deliveryMutex_;
+    std::condition_variable deliveryCondition_;
+    std::atomic<bool> deliveryIdle_{ false };
+    bool deliveryStopping_ = false;
+    std::thread deliveryThread_;
+};
+
+// ============================================================================
+// AsrSession
+// ============================================================================
+
+template <typename Sample>
+inline bool AsrSession::SendChunks(const Sample* samples, size_t count, std::chrono::milliseconds timeout) {
+    std::shared_ptr<Request> self;
+    if (WaitUntilActive(timeout)) {
+        self = client_.SelfFor(this);
+    }
+    if (!self) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!IsDoneLocked()) {
+            error_ = "timed out waiting for the engine";
+        }
+        return false;
+    }
+
+    NV_REQUEST_RISE_SETTINGS_V1& request = chunkRequest_;
+    request.version = NV_REQUEST_RISE_SETTINGS_VER1;
+    request.contentType = NV_RISE_CONTENT_TYPE_TEXT;
+    request.completed = 0;
+
+    for (size_t offset = 0; offset < count; offset += chunkSamples_) {
+        size_t chunkSize = std::min(chunkSamples_, count - offset);
+
+        int chunkId = nextChunkId_++;
+        if (FormatChunk(encoding_, chunkId, sampleRate_, samples + offset, chunkSize, request.content) == 0) {
+            client_.FailActive(self, "audio chunk payload too large");
+            return false;
+        }
+
+        // Backpressure: wait for the engine to acknowledge an older chunk
+        if (!chunkWindow_.WaitForSlot(timeout)) {
+            client_.FailActive(self, "timed out waiting for audio chunk acknowledgment");
+            return false;
+        }
+
+        // Registered first so an immediate acknowledgment finds it
+        chunkWindow_.OnSent(chunkId);
+        NvAPI_Status status = NvAPI_RequestRise(&request);
+        if (status != NVAPI_OK) {
+            client_.FailActive(self, "failed to send audio chunk (status " + std::to_string(status) + ")");
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool AsrSession::Finish(std::chrono::milliseconds timeout) {
+    std::shared_ptr<Request> self;
+    if (WaitUntilActive(timeout)) {
+        self = client_.SelfFor(this);
+    }
+    if (!self) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!IsDoneLocked()) {
+            error_ = "timed out waiting for the engine";
+        }
+        return false;
+    }
+
+    if (!chunkWindow_.WaitForAll(DEFAULT_CHUNK_ACK_TIMEOUT)) {
+        client_.FailActive(self, "timed out waiting for audio chunk acknowledgment");
+        return false;
+    }
+
+    // From here on completed TEXT callbacks are no longer acknowledgments;
+    // the session finishes with ASR_FINAL
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        streamStats_ = chunkWindow_.GetStats();
+        stopping_ = true;
+    }
+
+    NvAPI_Status status = SendContent("STOP:", false);
+    if (status != NVAPI_OK) {
+        client_.FailActive(self, "failed to send STOP (status " + std::to_string(status) + ")");
+        return false;
+    }
+
+    if (!Wait(timeout)) {
+        client_.FailActive(self, "timed out waiting for transcription");
+        return false;
+    }
+    return Succeeded();
+}
+
+} // namespace Rise
@@ -0,0 +1,149 @@
+/*
+ * Single-Producer Single-Consumer Queue
+ *
+ * Fixed-capacity ring buffer for handing data from one thread to exactly one
+ * other thread without locks. Storage is allocated once up front; pushing and
+ * popping never allocate or block, they fail when the ring is full or empty.
+ *
+ * Slots can be filled and read in place (Reserve()/Commit(), Front()/Pop())
+ * so large elements are not copied through temporaries, and runs of small
+ * elements (audio samples) can be moved in bulk with Write()/Read().
+ *
+ * Thread-safety: producer calls (Reserve, Commit, TryPush, Write) must come
+ * from one thread and consumer calls (Front, Pop, TryPop, Read, Clear) from
+ * one other thread. Empty(), Size() and Capacity() may be called from either
+ * side.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+        : capacity_(RoundUpToPowerOfTwo(capacity)),
+          mask_(capacity_ - 1),
+          slots_(new T[capacity_]) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t Capacity() const { return capacity_; }
+
+    size_t Size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    // ------------------------------------------------------------------------
+    // Producer
+    // ------------------------------------------------------------------------
+
+    // Next free slot, or nullptr if the ring is full. Fill it, then Commit().
+    T* Reserve() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == capacity_) {
+            return nullptr;
+        }
+        return &slots_[tail & mask_];
+    }
+
+    // Publish the slot returned by Reserve()
+    void Commit() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool TryPush(T value) {
+        T* slot = Reserve();
+        if (!slot) return false;
+        *slot = std::move(value);
+        Commit();
+        return true;
+    }
+
+    // Copy as many of `count` elements as fit; returns the number written
+    size_t Write(const T* data, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t space = capacity_ - (tail - head_.load(std::memory_order_acquire));
+        count = std::min(count, space);
+
+        size_t start = tail & mask_;
+        size_t first = std::min(count, capacity_ - start);
+        std::copy(data, data + first, slots_.get() + start);
+        std::copy(data + first, data + count, slots_.get());
+
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // ------------------------------------------------------------------------
+    // Consumer
+    // ------------------------------------------------------------------------
+
+    // Oldest element, or nullptr if the ring is empty. Pop() when done with it.
+    T* Front() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    // Release the slot returned by Front() to the producer
+    void Pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool TryPop(T& value) {
+        T* slot = Front();
+        if (!slot) return false;
+        value = std::move(*slot);
+        Pop();
+        return true;
+    }
+
+    // Copy up to `count` of the oldest elements to `out`; returns the number read
+    size_t Read(T* out, size_t count) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t available = tail_.load(std::memory_order_acquire) - head;
+        count = std::min(count, available);
+
+        size_t start = head & mask_;
+        size_t first = std::min(count, capacity_ - start);
+        std::copy(slots_.get() + start, slots_.get() + start + first, out);
+        std::copy(slots_.get(), slots_.get() + (count - first), out + first);
+
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Drop everything that has been written so far
+    void Clear() {
+        head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    static size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    // Producer and consumer indices live on separate cache lines so the two
+    // threads don't invalidate each other's line on every operation
+    static constexpr size_t CACHE_LINE = 64;
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+    alignas(CACHE_LINE) std::atomic<size_t> head_{ 0 };  // next slot to read
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{ 0 };  // next slot to write
+};
@@ -0,0 +1,152 @@
+/*
+ * Voice Activity Gate
+ *
+ * Decides, chunk by chunk, whether live microphone audio is worth sending to
+ * ASR. Silent chunks are skipped before they are encoded, which saves the
+ * base64 work, the NvAPI_RequestRise call and the engine's time.
+ *
+ * The gate opens when a chunk's RMS reaches the open threshold and closes
+ * again only after `hangoverChunks` consecutive chunks below the (lower)
+ * close threshold, so word endings and short pauses inside a sentence are
+ * still sent. While closed it keeps the last `preRollChunks` chunks; when
+ * speech starts they are sent ahead of the chunk that opened the gate so
+ * the onset of the first word is not clipped.
+ *
+ * Storage is allocated once in the constructor; Process() never allocates.
+ * Not thread-safe: use from the sending thread only.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "audio_utils.h"
+
+struct VoiceGateConfig {
+    float openThreshold = 0.01f;    // RMS (full scale 1.0) that opens the gate, about -40 dBFS
+    float closeThreshold = 0.005f;  // RMS below which an open gate counts a chunk as silence
+    int hangoverChunks = 8;         // silent chunks still sent after speech (~350 ms of 700-sample chunks)
+    int preRollChunks = 4;          // chunks kept from before speech (~175 ms)
+};
+
+class VoiceGate {
+public:
+    struct Stats {
+        uint64_t chunksSent = 0;     // includes pre-roll and hangover chunks
+        uint64_t chunksSkipped = 0;  // never sent
+        uint64_t preRollSent = 0;    // sent late, when the gate opened
+        uint64_t activations = 0;    // closed -> open transitions
+    };
+
+    VoiceGate(size_t chunkSamples, const VoiceGateConfig& config = VoiceGateConfig())
+        : config_(config),
+          chunkSamples_(chunkSamples),
+          preRoll_(static_cast<size_t>(std::max(config.preRollChunks, 0)) * chunkSamples),
+          preRollLength_(static_cast<size_t>(std::max(config.preRollChunks, 0))) {}
+
+    const VoiceGateConfig& Config() const { return config_; }
+    bool IsOpen() const { return open_; }
+    float LastRms() const { return lastRms_; }
+
+    /**
+     * Feed the next chunk (at most chunkSamples samples). Calls
+     * send(const float* samples, size_t count) for every chunk that should go
+     * to ASR, oldest first: retained pre-roll chunks, then this one. Stops and
+     * returns false as soon as send returns false.
+     */
+    template <typename Send>
+    bool Process(const float* samples, size_t count, Send&& send) {
+        lastRms_ = AudioUtils::CalculateRms(samples, count);
+
+        if (!open_) {
+            if (lastRms_ < config_.openThreshold) {
+                Retain(samples, count);
+                stats_.chunksSkipped++;
+                return true;
+            }
+
+            open_ = true;
+            silentRun_ = 0;
+            stats_.activations++;
+            if (!FlushPreRoll(send)) return false;
+        } else if (lastRms_ < config_.closeThreshold) {
+            if (++silentRun_ > config_.hangoverChunks) {
+                open_ = false;
+                silentRun_ = 0;
+                Retain(samples, count);
+                stats_.chunksSkipped++;
+                return true;
+            }
+        } else {
+            silentRun_ = 0;
+        }
+
+        stats_.chunksSent++;
+        return send(samples, count);
+    }
+
+    // Close the gate and forget retained audio and statistics
+    void Reset() {
+        open_ = false;
+        silentRun_ = 0;
+        lastRms_ = 0.0f;
+        preRollStart_ = 0;
+        preRollCount_ = 0;
+        stats_ = Stats();
+    }
+
+    Stats GetStats() const { return stats_; }
+
+private:
+    // Keep a skipped chunk as pre-roll, overwriting the oldest when full
+    void Retain(const float* samples, size_t count) {
+        size_t slots = preRollLength_.size();
+        if (slots == 0) return;
+
+        size_t slot;
+        if (preRollCount_ < slots) {
+            slot = (preRollStart_ + preRollCount_) % slots;
+            preRollCount_++;
+        } else {
+            slot = preRollStart_;
+            preRollStart_ = (preRollStart_ + 1) % slots;
+        }
+
+        count = std::min(count, chunkSamples_);
+        std::copy(samples, samples + count, preRoll_.begin() + slot * chunkSamples_);
+        preRollLength_[slot] = count;
+    }
+
+    template <typename Send>
+    bool FlushPreRoll(Send& send) {
+        size_t slots = preRollLength_.size();
+        while (preRollCount_ > 0) {
+            size_t slot = preRollStart_;
+            preRollStart_ = (preRollStart_ + 1) % slots;
+            preRollCount_--;
+
+            // Counted as skipped when retained; it is sent after all
+            stats_.chunksSkipped--;
+            stats_.chunksSent++;
+            stats_.preRollSent++;
+            if (!send(preRoll_.data() + slot * chunkSamples_, preRollLength_[slot])) {
+                return false;
+            }
+        }
+        preRollStart_ = 0;
+        return true;
+    }
+
+    VoiceGateConfig config_;
+    size_t chunkSamples_;
+    std::vector<float> preRoll_;         // preRollChunks slots of chunkSamples
+    std::vector<size_t> preRollLength_;  // samples held per slot
+    size_t preRollStart_ = 0;            // oldest retained slot
+    size_t preRollCount_ = 0;
+    bool open_ = false;
+    int silentRun_ = 0;                  // consecutive quiet chunks while open
+    float lastRms_ = 0.0f;
+    Stats stats_;
+};
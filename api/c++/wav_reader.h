@@ -0,0 +1,276 @@
+/*
+ * Streaming WAV Reader
+ *
+ * Reads WAV audio a block at a time instead of loading the whole file, so
+ * memory use stays the same for a 10-second clip and an hour-long
+ * recording. Frames come out as float32 (-1.0 to +1.0), either interleaved
+ * or averaged down to mono, ready for AsrSession::SendAudio().
+ *
+ * The header is parsed by walking the RIFF chunk list: "fmt " and "data" are
+ * located wherever they are, and anything else (LIST, fact, bext, ...) is
+ * skipped. Supported encodings:
+ *   - PCM: 8, 16, 24 and 32-bit integer
+ *   - IEEE float: 32 and 64-bit
+ *   - WAVE_FORMAT_EXTENSIBLE wrapping either of the above
+ * with any number of channels.
+ *
+ * Not thread-safe: use one reader per thread.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class WavReader {
+public:
+    enum class Encoding { Pcm, Float };
+
+    // Frames decoded per file read; bounds the reader's memory use
+    static constexpr size_t BLOCK_FRAMES = 4096;
+
+    WavReader() = default;
+
+    WavReader(const WavReader&) = delete;
+    WavReader& operator=(const WavReader&) = delete;
+
+    /**
+     * Open a file and parse its header. On failure, `error` (if given)
+     * receives the reason. Reading starts at the first frame.
+     */
+    bool Open(const std::string& filename, std::string* error = nullptr) {
+        auto fail = [this, error](const char* reason) {
+            if (error) *error = reason;
+            file_.close();
+            return false;
+        };
+
+        file_.close();
+        file_.clear();
+        file_.open(filename, std::ios::binary);
+        if (!file_.is_open()) {
+            return fail("Could not open file");
+        }
+
+        char riff[12];
+        if (!ReadBytes(riff, sizeof(riff)) || std::memcmp(riff, "RIFF", 4) != 0 ||
+            std::memcmp(riff + 8, "WAVE", 4) != 0) {
+            return fail("Invalid WAV file format");
+        }
+
+        // Walk the chunk list until "data"; "fmt " must come before it
+        bool haveFormat = false;
+        while (true) {
+            char chunk[8];
+            if (!ReadBytes(chunk, sizeof(chunk))) {
+                return fail(haveFormat ? "WAV file has no data chunk" : "WAV file has no format chunk");
+            }
+            uint32_t chunkSize = ReadLe32(chunk + 4);
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0) {
+                const char* reason = ParseFormat(chunkSize);
+                if (reason) return fail(reason);
+                haveFormat = true;
+            } else if (std::memcmp(chunk, "data", 4) == 0) {
+                if (!haveFormat) return fail("WAV file has no format chunk");
+
+                // Writers that stream to disk may leave the size at 0 or
+                // 0xFFFFFFFF; read to the end of the file in that case
+                bool unknownSize = chunkSize == 0 || chunkSize == 0xFFFFFFFF;
+                remainingFrames_ = unknownSize ? UINT64_MAX : chunkSize / blockAlign_;
+                totalFrames_ = unknownSize ? 0 : remainingFrames_;
+                break;
+            } else {
+                // Chunks are padded to an even size
+                file_.seekg(static_cast<std::streamoff>(chunkSize) + (chunkSize & 1), std::ios::cur);
+                if (!file_) return fail("Truncated WAV file");
+            }
+        }
+
+        raw_.resize(BLOCK_FRAMES * blockAlign_);
+        decoded_.resize(BLOCK_FRAMES * channels_);
+        return true;
+    }
+
+    bool IsOpen() const { return file_.is_open(); }
+
+    int SampleRate() const { return sampleRate_; }
+    int Channels() const { return channels_; }
+    int BitsPerSample() const { return bitsPerSample_; }
+    Encoding GetEncoding() const { return encoding_; }
+
+    // Frames in the data chunk; 0 if the header did not say
+    uint64_t TotalFrames() const { return totalFrames_; }
+
+    double DurationSeconds() const {
+        return sampleRate_ > 0 ? static_cast<double>(totalFrames_) / sampleRate_ : 0.0;
+    }
+
+    /**
+     * Read up to `maxFrames` frames as interleaved float samples (Channels()
+     * per frame). Returns the number of frames read; 0 at the end of the data.
+     */
+    size_t Read(float* out, size_t maxFrames) {
+        size_t total = 0;
+        while (total < maxFrames) {
+            size_t frames = ReadBlock(std::min(maxFrames - total, BLOCK_FRAMES));
+            if (frames == 0) break;
+            std::copy(decoded_.begin(), decoded_.begin() + frames * channels_, out + total * channels_);
+            total += frames;
+        }
+        return total;
+    }
+
+    /**
+     * Read up to `maxFrames` frames averaged to one channel. Returns the
+     * number of samples written; 0 at the end of the data.
+     */
+    size_t ReadMono(float* out, size_t maxFrames) {
+        size_t total = 0;
+        while (total < maxFrames) {
+            size_t frames = ReadBlock(std::min(maxFrames - total, BLOCK_FRAMES));
+            if (frames == 0) break;
+
+            if (channels_ == 1) {
+                std::copy(decoded_.begin(), decoded_.begin() + frames, out + total);
+            } else {
+                const float scale = 1.0f / channels_;
+                const float* frame = decoded_.data();
+                for (size_t i = 0; i < frames; i++, frame += channels_) {
+                    float sum = 0.0f;
+                    for (int c = 0; c < channels_; c++) sum += frame[c];
+                    out[total + i] = sum * scale;
+                }
+            }
+            total += frames;
+        }
+        return total;
+    }
+
+private:
+    static constexpr uint16_t FORMAT_PCM = 0x0001;
+    static constexpr uint16_t FORMAT_FLOAT = 0x0003;
+    static constexpr uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+    static uint16_t ReadLe16(const char* p) {
+        return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+    }
+
+    static uint32_t ReadLe32(const char* p) {
+        return static_cast<uint32_t>(ReadLe16(p)) | (static_cast<uint32_t>(ReadLe16(p + 2)) << 16);
+    }
+
+    bool ReadBytes(char* buffer, size_t length) {
+        file_.read(buffer, static_cast<std::streamsize>(length));
+        return static_cast<size_t>(file_.gcount()) == length;
+    }
+
+    // Returns nullptr on success, otherwise the reason the format is rejected
+    const char* ParseFormat(uint32_t chunkSize) {
+        if (chunkSize < 16 || chunkSize > 1024) return "Invalid WAV format chunk";
+
+        char fmt[1024 + 1];
+        if (!ReadBytes(fmt, chunkSize + (chunkSize & 1))) return "Truncated WAV file";
+
+        uint16_t formatTag = ReadLe16(fmt);
+        channels_ = ReadLe16(fmt + 2);
+        sampleRate_ = static_cast<int>(ReadLe32(fmt + 4));
+        blockAlign_ = ReadLe16(fmt + 12);
+        bitsPerSample_ = ReadLe16(fmt + 14);
+
+        // The extensible header's sub-format GUID starts with the real tag
+        if (formatTag == FORMAT_EXTENSIBLE) {
+            if (chunkSize < 40) return "Invalid WAV format chunk";
+            formatTag = ReadLe16(fmt + 24);
+        }
+
+        if (formatTag == FORMAT_PCM) {
+            encoding_ = Encoding::Pcm;
+            if (bitsPerSample_ != 8 && bitsPerSample_ != 16 && bitsPerSample_ != 24 && bitsPerSample_ != 32) {
+                return "Unsupported PCM bit depth";
+            }
+        } else if (formatTag == FORMAT_FLOAT) {
+            encoding_ = Encoding::Float;
+            if (bitsPerSample_ != 32 && bitsPerSample_ != 64) {
+                return "Unsupported float bit depth";
+            }
+        } else {
+            return "Only PCM and IEEE float WAV files are supported";
+        }
+
+        if (channels_ == 0 || sampleRate_ <= 0) return "Invalid WAV format chunk";
+        if (blockAlign_ != channels_ * (bitsPerSample_ / 8)) return "Invalid WAV block alignment";
+        return nullptr;
+    }
+
+    // Decode up to `frames` (<= BLOCK_FRAMES) frames into decoded_
+    size_t ReadBlock(size_t frames) {
+        if (!file_.is_open()) return 0;
+        frames = static_cast<size_t>(std::min<uint64_t>(frames, remainingFrames_));
+        if (frames == 0) return 0;
+
+        file_.read(raw_.data(), static_cast<std::streamsize>(frames * blockAlign_));
+        frames = static_cast<size_t>(file_.gcount()) / blockAlign_;
+        remainingFrames_ = frames == 0 ? 0 : remainingFrames_ - frames;
+
+        size_t count = frames * channels_;
+        const char* in = raw_.data();
+        float* out = decoded_.data();
+
+        if (encoding_ == Encoding::Float) {
+            if (bitsPerSample_ == 32) {
+                std::memcpy(out, in, count * sizeof(float));
+            } else {
+                for (size_t i = 0; i < count; i++, in += 8) {
+                    double value;
+                    std::memcpy(&value, in, sizeof(value));
+                    out[i] = static_cast<float>(value);
+                }
+            }
+            return frames;
+        }
+
+        switch (bitsPerSample_) {
+            case 8:  // unsigned, centred on 128
+                for (size_t i = 0; i < count; i++) {
+                    out[i] = (static_cast<uint8_t>(in[i]) - 128) * (1.0f / 128.0f);
+                }
+                break;
+            case 16:
+                for (size_t i = 0; i < count; i++, in += 2) {
+                    out[i] = static_cast<int16_t>(ReadLe16(in)) * (1.0f / 32768.0f);
+                }
+                break;
+            case 24:
+                for (size_t i = 0; i < count; i++, in += 3) {
+                    int32_t value = static_cast<int32_t>(static_cast<uint8_t>(in[0]) |
+                                                         (static_cast<uint8_t>(in[1]) << 8) |
+                                                         (static_cast<uint32_t>(static_cast<uint8_t>(in[2])) << 16));
+                    if (value & 0x800000) value -= 0x1000000;  // sign-extend
+                    out[i] = value * (1.0f / 8388608.0f);
+                }
+                break;
+            default:  // 32
+                for (size_t i = 0; i < count; i++, in += 4) {
+                    out[i] = static_cast<float>(static_cast<int32_t>(ReadLe32(in)) * (1.0 / 2147483648.0));
+                }
+                break;
+        }
+        return frames;
+    }
+
+    std::ifstream file_;
+    Encoding encoding_ = Encoding::Pcm;
+    int sampleRate_ = 0;
+    int channels_ = 0;
+    int bitsPerSample_ = 0;
+    int blockAlign_ = 0;
+    uint64_t totalFrames_ = 0;
+    uint64_t remainingFrames_ = 0;
+    std::vector<char> raw_;        // one block as stored in the file
+    std::vector<float> decoded_;   // the same block as interleaved floats
+};
@@ -0,0 +1,315 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// LogiLED Effect Engine
+//
+// Animates Logitech lighting from a background thread so an effect needs one
+// command instead of one command per frame. An effect is a looping list of
+// keyframe colours; `spread` shifts the loop across the width of each device
+// so the colours form a moving gradient. Every frame is rendered into a
+// per-key (or per-zone) buffer and compared with what the device was last
+// sent, and only the lights that changed are written. The frame rate is
+// capped, and late frames are dropped rather than sent in a burst.
+//
+// The engine owns the LED SDK while it runs: stop it before making other
+// LogiLed calls.
+
+#pragma once
+
+#include "LogitechLEDLib.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Color {
+    int red;
+    int green;
+    int blue;
+};
+
+inline bool operator==(const Color& a, const Color& b) {
+    return a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+struct EffectSpec {
+    std::vector<Color> keyframes;                       // SDK percentages, evenly spaced over one period
+    std::chrono::milliseconds period{ 3000 };           // one pass through the keyframes; 0 = static
+    double spread = 0.0;                                // periods across a device's width (0 = uniform)
+    int fps = 30;
+};
+
+struct EffectTargets {
+    bool keyboard = true;
+    bool mouse = true;
+    bool headset = true;
+};
+
+class EffectEngine {
+public:
+    static constexpr int MAX_FPS = 60;
+    static constexpr int MAX_ZONES = 10;
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t updatesSent = 0;       // key/zone writes sent to the SDK
+        uint64_t updatesSkipped = 0;    // unchanged since the previous frame
+    };
+
+    EffectEngine() = default;
+    ~EffectEngine() { Stop(); }
+
+    EffectEngine(const EffectEngine&) = delete;
+    EffectEngine& operator=(const EffectEngine&) = delete;
+
+    /**
+     * Replaces the running effect, if any. The first frame is written before
+     * this returns; returns false, with nothing left running, if none of the
+     * targets took it.
+     */
+    bool Start(const EffectSpec& spec, const EffectTargets& targets) {
+        Stop();
+
+        spec_ = spec;
+        if (spec_.keyframes.empty()) spec_.keyframes.push_back(Color{ 100, 100, 100 });
+        spec_.fps = std::clamp(spec_.fps, 1, MAX_FPS);
+
+        devices_.clear();
+        if (targets.keyboard) devices_.push_back(MakeKeyboard());
+        if (targets.mouse) devices_.push_back(MakeZones(LogiLed::DeviceType::Mouse));
+        if (targets.headset) devices_.push_back(MakeZones(LogiLed::DeviceType::Headset));
+
+        frames_ = 0;
+        updatesSent_ = 0;
+        updatesSkipped_ = 0;
+        ProbeDevices(Sample(0.0, 0.0));
+        if (devices_.empty()) return false;
+
+        stopRequested_ = false;
+        thread_ = std::thread([this]() { Run(); });
+        return true;
+    }
+
+    // Returns false if no effect was running
+    bool Stop() {
+        if (!thread_.joinable()) return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopRequested_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+        return true;
+    }
+
+    bool IsRunning() const { return thread_.joinable(); }
+
+    // Totals for the running effect, or the last one after Stop()
+    Stats GetStats() const {
+        return Stats{ frames_.load(), updatesSent_.load(), updatesSkipped_.load() };
+    }
+
+private:
+    struct Light {
+        double x;           // 0..1 across the device
+        Color sent;
+        bool valid;         // sent holds what the device shows
+    };
+
+    struct Device {
+        LogiLed::DeviceType type;
+        bool perKey;
+        std::vector<LogiLed::KeyName> keys;     // per-key only, parallel to lights
+        std::vector<Light> lights;
+    };
+
+    struct KeyPosition {
+        LogiLed::KeyName key;
+        double column;      // in key widths from the left edge
+    };
+
+    // Full-size layout; keys a board does not have are ignored by the SDK
+    static const std::vector<KeyPosition>& KeyboardLayout() {
+        using K = LogiLed::KeyName;
+        static const std::vector<KeyPosition> layout = {
+            { K::ESC, 0.5 }, { K::F1, 2.5 }, { K::F2, 3.5 }, { K::F3, 4.5 }, { K::F4, 5.5 },
+            { K::F5, 7.0 }, { K::F6, 8.0 }, { K::F7, 9.0 }, { K::F8, 10.0 },
+            { K::F9, 11.5 }, { K::F10, 12.5 }, { K::F11, 13.5 }, { K::F12, 14.5 },
+            { K::PRINT_SCREEN, 15.75 }, { K::SCROLL_LOCK, 16.75 }, { K::PAUSE_BREAK, 17.75 },
+
+            { K::TILDE, 0.5 }, { K::ONE, 1.5 }, { K::TWO, 2.5 }, { K::THREE, 3.5 }, { K::FOUR, 4.5 },
+            { K::FIVE, 5.5 }, { K::SIX, 6.5 }, { K::SEVEN, 7.5 }, { K::EIGHT, 8.5 }, { K::NINE, 9.5 },
+            { K::ZERO, 10.5 }, { K::MINUS, 11.5 }, { K::EQUALS, 12.5 }, { K::BACKSPACE, 14.0 },
+            { K::INSERT, 15.75 }, { K::HOME, 16.75 }, { K::PAGE_UP, 17.75 },
+            { K::NUM_LOCK, 19.0 }, { K::NUM_SLASH, 20.0 }, { K::NUM_ASTERISK, 21.0 }, { K::NUM_MINUS, 22.0 },
+
+            { K::TAB, 0.75 }, { K::Q, 2.0 }, { K::W, 3.0 }, { K::E, 4.0 }, { K::R, 5.0 }, { K::T, 6.0 },
+            { K::Y, 7.0 }, { K::U, 8.0 }, { K::I, 9.0 }, { K::O, 10.0 }, { K::P, 11.0 },
+            { K::OPEN_BRACKET, 12.0 }, { K::CLOSE_BRACKET, 13.0 }, { K::BACKSLASH, 14.25 },
+            { K::KEYBOARD_DELETE, 15.75 }, { K::END, 16.75 }, { K::PAGE_DOWN, 17.75 },
+            { K::NUM_SEVEN, 19.0 }, { K::NUM_EIGHT, 20.0 }, { K::NUM_NINE, 21.0 }, { K::NUM_PLUS, 22.0 },
+
+            { K::CAPS_LOCK, 0.9 }, { K::A, 2.25 }, { K::S, 3.25 }, { K::D, 4.25 }, { K::F, 5.25 },
+            { K::G, 6.25 }, { K::H, 7.25 }, { K::J, 8.25 }, { K::K, 9.25 }, { K::L, 10.25 },
+            { K::SEMICOLON, 11.25 }, { K::APOSTROPHE, 12.25 }, { K::ENTER, 13.9 },
+            { K::NUM_FOUR, 19.0 }, { K::NUM_FIVE, 20.0 }, { K::NUM_SIX, 21.0 },
+
+            { K::LEFT_SHIFT, 1.1 }, { K::Z, 2.75 }, { K::X, 3.75 }, { K::C, 4.75 }, { K::V, 5.75 },
+            { K::B, 6.75 }, { K::N, 7.75 }, { K::M, 8.75 }, { K::COMMA, 9.75 }, { K::PERIOD, 10.75 },
+            { K::FORWARD_SLASH, 11.75 }, { K::RIGHT_SHIFT, 13.6 }, { K::ARROW_UP, 16.75 },
+            { K::NUM_ONE, 19.0 }, { K::NUM_TWO, 20.0 }, { K::NUM_THREE, 21.0 }, { K::NUM_ENTER, 22.0 },
+
+            { K::LEFT_CONTROL, 0.6 }, { K::LEFT_WINDOWS, 1.9 }, { K::LEFT_ALT, 3.1 }, { K::SPACE, 6.9 },
+            { K::RIGHT_ALT, 10.6 }, { K::RIGHT_WINDOWS, 11.9 }, { K::APPLICATION_SELECT, 13.1 },
+            { K::RIGHT_CONTROL, 14.4 }, { K::ARROW_LEFT, 15.75 }, { K::ARROW_DOWN, 16.75 },
+            { K::ARROW_RIGHT, 17.75 }, { K::NUM_ZERO, 19.5 }, { K::NUM_PERIOD, 21.0 },
+        };
+        return layout;
+    }
+
+    static constexpr double KEYBOARD_WIDTH = 22.5;
+
+    static Device MakeKeyboard() {
+        Device device{ LogiLed::DeviceType::Keyboard, true, {}, {} };
+        for (const KeyPosition& position : KeyboardLayout()) {
+            device.keys.push_back(position.key);
+            device.lights.push_back(Light{ position.column / KEYBOARD_WIDTH, Color{}, false });
+        }
+        return device;
+    }
+
+    // The zone count is found on the first frame
+    static Device MakeZones(LogiLed::DeviceType type) {
+        return Device{ type, false, {}, {} };
+    }
+
+    void Run() {
+        using Clock = std::chrono::steady_clock;
+        const auto interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / spec_.fps));
+        const auto start = Clock::now();
+
+        auto next = start + interval;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (wake_.wait_until(lock, next, [this]() { return stopRequested_; })) break;
+            }
+
+            auto now = Clock::now();
+            double phase = spec_.period.count() > 0
+                ? std::chrono::duration<double, std::milli>(now - start).count() / spec_.period.count()
+                : 0.0;
+            RenderFrame(phase);
+            frames_++;
+
+            next += interval;
+            if (next <= now) next = now + interval;  // running behind: drop frames
+        }
+    }
+
+    // The first frame writes every light and finds out what the devices have
+    void ProbeDevices(const Color& color) {
+        for (Device& device : devices_) {
+            if (device.perKey) {
+                if (LogiLedSetLightingForKeyWithKeyName(device.keys.front(), color.red, color.green, color.blue)) {
+                    device.lights.front().sent = color;
+                    device.lights.front().valid = true;
+                    updatesSent_++;
+                    continue;
+                }
+                // Not a per-key board: drive its zones instead
+                device.perKey = false;
+                device.keys.clear();
+                device.lights.clear();
+            }
+
+            int zones = 0;
+            while (zones < MAX_ZONES &&
+                   LogiLedSetLightingForTargetZone(device.type, zones, color.red, color.green, color.blue)) {
+                zones++;
+            }
+            for (int zone = 0; zone < zones; ++zone) {
+                device.lights.push_back(Light{ (zone + 0.5) / zones, color, true });
+            }
+            updatesSent_ += zones;
+        }
+
+        // Devices that took no writes are not there
+        devices_.erase(std::remove_if(devices_.begin(), devices_.end(),
+            [](const Device& device) { return device.lights.empty(); }), devices_.end());
+        RenderFrame(0.0);
+        frames_++;
+    }
+
+    void RenderFrame(double phase) {
+        for (Device& device : devices_) {
+            for (size_t i = 0; i < device.lights.size(); ++i) {
+                Light& light = device.lights[i];
+                Color color = Sample(phase, light.x);
+                if (light.valid && light.sent == color) {
+                    updatesSkipped_++;
+                    continue;
+                }
+
+                bool sent = device.perKey
+                    ? LogiLedSetLightingForKeyWithKeyName(device.keys[i], color.red, color.green, color.blue)
+                    : LogiLedSetLightingForTargetZone(device.type, static_cast<int>(i), color.red, color.green, color.blue);
+                // A failed write is retried on the next frame
+                light.sent = color;
+                light.valid = sent;
+                updatesSent_++;
+            }
+        }
+    }
+
+    // Colour at `phase` periods into the effect for a light at `x`
+    Color Sample(double phase, double x) const {
+        const std::vector<Color>& keys = spec_.keyframes;
+        double position = phase + x * spec_.spread;
+        position -= std::floor(position);
+        position *= keys.size();
+
+        size_t index = static_cast<size_t>(position) % keys.size();
+        double t = position - std::floor(position);
+        const Color& a = keys[index];
+        const Color& b = keys[(index + 1) % keys.size()];
+
+        auto mix = [t](int from, int to) {
+            return static_cast<int>(std::lround(from + (to - from) * t));
+        };
+        return Color{ mix(a.red, b.red), mix(a.green, b.green), mix(a.blue, b.blue) };
+    }
+
+    EffectSpec spec_;
+    std::vector<Device> devices_;   // touched only by the render thread while it runs
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopRequested_ = false;
+
+    std::atomic<uint64_t> frames_{ 0 };
+    std::atomic<uint64_t> updatesSent_{ 0 };
+    std::atomic<uint64_t> updatesSkipped_{ 0 };
+};
@@ -21,6 +21,7 @@
 #include <nlohmann/json.hpp>
 #include "gassist_sdk.hpp"
 #include "LogitechLEDLib.h"
+#include "effect_engine.h"
 
 #include <Windows.h>
 #include <TlHelp32.h>
@@ -30,6 +31,7 @@
 #include <fstream>
 #include <format>
 #include <map>
+#include <sstream>
 #include <string>
 
 using json = nlohmann::json;
@@ -48,12 +50,6 @@ struct PluginConfig {
     bool allowHeadset = true;
 };
 
-struct Color {
-    int red;
-    int green;
-    int blue;
-};
-
 struct PluginState {
     bool initialized = false;
     bool wizardActive = false;
@@ -79,35 +75,81 @@ fs::path GetConfigPath() {
 // G Hub Diagnostics
 // ============================================================================
 
+// The DLL stays loaded once found, so later checks return straight away;
+// a failed load is retried on the next call
 bool CheckLogiDllAvailable() {
-    HMODULE hModule = LoadLibraryA("LogitechLED.dll");
-    if (hModule) {
-        FreeLibrary(hModule);
-        return true;
+    static HMODULE module = nullptr;
+    if (!module) {
+        module = LoadLibraryA("LogitechLED.dll");
     }
-    return false;
+    return module != nullptr;
 }
 
-bool IsGHubRunning() {
-    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (snapshot == INVALID_HANDLE_VALUE) return false;
-    
-    PROCESSENTRY32W entry;
-    entry.dwSize = sizeof(entry);
-    
-    bool found = false;
-    if (Process32FirstW(snapshot, &entry)) {
-        do {
-            if (_wcsicmp(entry.szExeFile, L"lghub.exe") == 0 ||
-                _wcsicmp(entry.szExeFile, L"lghub_agent.exe") == 0) {
-                found = true;
-                break;
+// Tracks whether G Hub is running without walking the process list for
+// every lighting command. Once lghub.exe or lghub_agent.exe is found, a
+// SYNCHRONIZE handle to it is kept; the handle is signaled when that process
+// exits, so while G Hub stays up a check is a single zero-timeout wait. The
+// process list is only walked again after the process exits, or while G Hub
+// is not running.
+class GHubMonitor {
+public:
+    GHubMonitor() = default;
+    ~GHubMonitor() { Release(); }
+
+    GHubMonitor(const GHubMonitor&) = delete;
+    GHubMonitor& operator=(const GHubMonitor&) = delete;
+
+    bool IsRunning() {
+        if (process_) {
+            if (WaitForSingleObject(process_, 0) == WAIT_TIMEOUT) {
+                return true;
             }
-        } while (Process32NextW(snapshot, &entry));
+            Release(); // Exited - the other G Hub process may still be running
+        }
+        return Scan();
     }
-    
-    CloseHandle(snapshot);
-    return found;
+
+private:
+    bool Scan() {
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+        if (snapshot == INVALID_HANDLE_VALUE) return false;
+
+        PROCESSENTRY32W entry;
+        entry.dwSize = sizeof(entry);
+
+        DWORD processId = 0;
+        if (Process32FirstW(snapshot, &entry)) {
+            do {
+                if (_wcsicmp(entry.szExeFile, L"lghub.exe") == 0 ||
+                    _wcsicmp(entry.szExeFile, L"lghub_agent.exe") == 0) {
+                    processId = entry.th32ProcessID;
+                    break;
+                }
+            } while (Process32NextW(snapshot, &entry));
+        }
+
+        CloseHandle(snapshot);
+        if (processId == 0) return false;
+
+        // If the handle can't be opened G Hub is still reported as running,
+        // and the next check walks the process list again
+        process_ = OpenProcess(SYNCHRONIZE, FALSE, processId);
+        return true;
+    }
+
+    void Release() {
+        if (process_) {
+            CloseHandle(process_);
+            process_ = nullptr;
+        }
+    }
+
+    HANDLE process_ = nullptr;
+};
+
+bool IsGHubRunning() {
+    static GHubMonitor monitor;
+    return monitor.IsRunning();
 }
 
 // ============================================================================
@@ -257,6 +299,65 @@ Color ParseColorParameter(const std::string& colorParam) {
     return ToSdkColor(rawRgb);
 }
 
+// ============================================================================
+// Lighting Effects
+// ============================================================================
+
+std::vector<Color> ParseColorList(const std::string& colors) {
+    std::vector<Color> parsed;
+    std::stringstream stream(colors);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t first = item.find_first_not_of(" \t");
+        if (first == std::string::npos) continue;
+        size_t last = item.find_last_not_of(" \t");
+        parsed.push_back(ParseColorParameter(item.substr(first, last - first + 1)));
+    }
+    return parsed;
+}
+
+std::chrono::milliseconds GetEffectPeriod(const std::string& speed) {
+    std::string value = ToLower(speed);
+    if (value == "slow") return std::chrono::milliseconds(6000);
+    if (value == "fast") return std::chrono::milliseconds(1500);
+    if (value == "normal" || value.empty()) return std::chrono::milliseconds(3000);
+    throw std::runtime_error("Unknown speed: " + speed + ". Use slow, normal or fast.");
+}
+
+// Effects are presets over the same engine: which keyframes, and whether
+// they move over time, across the devices, or both
+EffectSpec BuildEffectSpec(const std::string& effect, const json& args) {
+    static const char* RAINBOW = "red,orange,yellow,green,cyan,blue,purple";
+
+    EffectSpec spec;
+    spec.period = GetEffectPeriod(args.value("speed", "normal"));
+    spec.fps = args.value("fps", 30);
+
+    if (effect == "cycle") {
+        spec.keyframes = ParseColorList(args.value("colors", RAINBOW));
+    } else if (effect == "wave") {
+        spec.keyframes = ParseColorList(args.value("colors", RAINBOW));
+        spec.spread = 1.0;
+    } else if (effect == "gradient") {
+        spec.keyframes = ParseColorList(args.value("colors", RAINBOW));
+        spec.spread = 1.0;
+        spec.period = std::chrono::milliseconds(0);
+    } else if (effect == "breathe") {
+        // Fade each colour in and out in turn
+        for (const Color& color : ParseColorList(args.value("colors", "white"))) {
+            spec.keyframes.push_back(color);
+            spec.keyframes.push_back(Color{ 0, 0, 0 });
+        }
+    } else {
+        throw std::runtime_error("Unknown effect: " + effect + ". Use wave, cycle, breathe, gradient or stop.");
+    }
+
+    if (spec.keyframes.empty()) {
+        throw std::runtime_error("No colors given for the " + effect + " effect.");
+    }
+    return spec;
+}
+
 // ============================================================================
 // Setup Wizard
 // ============================================================================
@@ -307,6 +408,7 @@ int main() {
     // Plugin state
     PluginState state;
     state.config = LoadConfig();
+    EffectEngine effects;
 
     // ========================================================================
     // Initialize Command
@@ -342,6 +444,7 @@ int main() {
     // Shutdown Command (called automatically by SDK)
     // ========================================================================
     plugin.command("shutdown", [&](const json& args) -> json {
+        effects.Stop();
         if (state.initialized && state.config.restoreOnShutdown) {
             LogiLedRestoreLighting();
         }
@@ -374,6 +477,9 @@ int main() {
         std::string colorParam = args.value("color", "white");
         Color sdkColor = ParseColorParameter(colorParam);
 
+        // A running effect would paint over the new color
+        effects.Stop();
+
         // Set lighting
         if (SetDeviceLighting(LogiLed::DeviceType::Keyboard, sdkColor)) {
             return "Logitech keyboard lighting updated.";
@@ -406,6 +512,9 @@ int main() {
         std::string colorParam = args.value("color", "white");
         Color sdkColor = ParseColorParameter(colorParam);
 
+        // A running effect would paint over the new color
+        effects.Stop();
+
         // Set lighting
         if (SetDeviceLighting(LogiLed::DeviceType::Mouse, sdkColor)) {
             return "Logitech mouse lighting updated.";
@@ -438,6 +547,9 @@ int main() {
         std::string colorParam = args.value("color", "white");
         Color sdkColor = ParseColorParameter(colorParam);
 
+        // A running effect would paint over the new color
+        effects.Stop();
+
         // Set lighting
         if (SetDeviceLighting(LogiLed::DeviceType::Headset, sdkColor)) {
             return "Logitech headset lighting updated.";
@@ -446,6 +558,46 @@ int main() {
         }
     });
 
+    // ========================================================================
+    // Lighting Effect Command
+    // ========================================================================
+    plugin.command("logi_lighting_effect", [&](const json& args) -> json {
+        std::string effect = ToLower(args.value("effect", "wave"));
+
+        if (effect == "stop" || effect == "off") {
+            if (!effects.Stop()) {
+                return "No lighting effect is running.";
+            }
+            EffectEngine::Stats stats = effects.GetStats();
+            return std::format("Lighting effect stopped after {} frames ({} LED updates sent, {} unchanged skipped).",
+                stats.frames, stats.updatesSent, stats.updatesSkipped);
+        }
+
+        EffectTargets targets{ state.config.allowKeyboard, state.config.allowMouse, state.config.allowHeadset };
+        if (!targets.keyboard && !targets.mouse && !targets.headset) {
+            return "Keyboard, mouse and headset control are all disabled in the configuration.";
+        }
+
+        // Parse before touching the devices so a bad request leaves them as they are
+        EffectSpec spec = BuildEffectSpec(effect, args);
+
+        // Pre-flight check: ensure G Hub is available
+        EnsureGHubAvailable();
+
+        // Ensure SDK is initialized
+        if (!state.initialized) {
+            state.initialized = LogiLedInit();
+            if (!state.initialized) {
+                throw std::runtime_error("Failed to initialize Logitech LED SDK. Ensure 'Game lighting control' is enabled in G Hub, or restart G Hub.");
+            }
+        }
+
+        if (!effects.Start(spec, targets)) {
+            throw std::runtime_error("No Logitech lighting devices responded. Check that your devices are connected and 'Game lighting control' is enabled in G Hub.");
+        }
+        return std::format("Started the {} lighting effect. Ask to stop the lighting effect to end it.", effect);
+    });
+
     // ========================================================================
     // User Input Handler (for setup wizard)
     // ========================================================================
@@ -480,6 +632,7 @@ int main() {
     plugin.run();
 
     // Cleanup on exit
+    effects.Stop();
     if (state.initialized && state.config.restoreOnShutdown) {
         LogiLedRestoreLighting();
     }
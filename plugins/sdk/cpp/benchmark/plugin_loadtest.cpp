@@ -0,0 +1,471 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Load test and cold-start harness for G-Assist plugins, built on
+// gassist_host.hpp.
+//
+// Each plugin gets a pool of prewarmed processes. The tool reports how long
+// every process took to start, then drives them from several client threads
+// at once and reports request latency and throughput. --cold-starts
+// additionally starts and stops fresh processes one after another, to
+// catch start-up regressions.
+//
+// Without --plugin the tool hosts copies of itself (--serve): an `echo`
+// command, an `echo_async` command that completes from a timer thread
+// instead of holding a thread for --work-us, and an `initialize` command
+// that takes --init-delay ms, like a plugin that brings up a device SDK.
+//
+// Results go to stdout as one JSON object per line; progress and errors go
+// to stderr. --trace DIR sends one more request to each plugin after the
+// load test with a trace id and writes the host and plugin spans of it to
+// DIR as a Chrome trace.
+//
+// Usage:
+//   plugin_loadtest [--plugin DIR]... [--pool N] [--concurrency N]
+//                   [--requests N] [--function NAME] [--args JSON]
+//                   [--cold-starts N] [--encoding json|cbor|msgpack]
+//                   [--no-init-command] [--trace DIR]
+//   plugin_loadtest --serve [--init-delay MS] [--work-us US] [--workers N]
+
+#include <nlohmann/json.hpp>
+#include "gassist_host.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using gassist::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::vector<std::string> plugins;   // plugin directories
+    size_t pool = 2;
+    size_t concurrency = 8;
+    size_t requests = 5000;
+    std::string function;
+    json arguments = json::object();
+    size_t cold_starts = 0;
+    std::string encoding;
+    bool init_command = true;
+    std::string trace_directory;
+
+    // --serve
+    size_t init_delay_ms = 50;
+    size_t work_us = 0;
+    size_t workers = 0;
+};
+
+// ============================================================================
+// Plugin side
+// ============================================================================
+
+// Completes async results once their delay has passed, all from one thread,
+// the way a device SDK's callback thread would
+class DelayedResults {
+public:
+    DelayedResults() : m_stopping(false), m_thread([this] { loop(); }) {}
+
+    ~DelayedResults() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_one();
+        m_thread.join();
+    }
+
+    void complete_after(std::chrono::microseconds delay, gassist::AsyncResult result, json value) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_due.emplace(Clock::now() + delay, Entry{ std::move(result), std::move(value) });
+        }
+        m_condition.notify_one();
+    }
+
+private:
+    struct Entry {
+        gassist::AsyncResult result;
+        json value;
+    };
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping) {
+            if (m_due.empty()) {
+                m_condition.wait(lock);
+                continue;
+            }
+            auto next = m_due.begin();
+            if (Clock::now() < next->first) {
+                m_condition.wait_until(lock, next->first);
+                continue;
+            }
+            Entry entry = std::move(next->second);
+            m_due.erase(next);
+            lock.unlock();
+            entry.result.complete(std::move(entry.value));
+            lock.lock();
+        }
+    }
+
+    bool m_stopping;
+    std::multimap<Clock::time_point, Entry> m_due;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+};
+
+int run_plugin(const Options& options) {
+    DelayedResults delayed;
+    gassist::Plugin plugin("plugin-loadtest", "1.0.0", "Load test plugin");
+    if (options.workers > 0) plugin.set_worker_threads(options.workers);
+
+    std::chrono::milliseconds init_delay(options.init_delay_ms);
+    plugin.command("initialize", [init_delay](const json&) -> json {
+        std::this_thread::sleep_for(init_delay);
+        return "ready";
+    });
+
+    std::chrono::microseconds work(options.work_us);
+    plugin.command("echo", [work](const json& args) -> json {
+        if (work.count() > 0) std::this_thread::sleep_for(work);
+        return args;
+    });
+    plugin.command_async("echo_async", [work, &delayed](const json& args, gassist::RequestContext&,
+                                                        gassist::AsyncResult result) {
+        if (work.count() == 0) {
+            result.complete(args);
+            return;
+        }
+        delayed.complete_after(work, std::move(result), args);
+    });
+
+    plugin.run();
+    return 0;
+}
+
+// ============================================================================
+// Host side
+// ============================================================================
+
+struct Summary {
+    double min;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    double mean;
+};
+
+Summary summarize(std::vector<double> samples) {
+    Summary summary{};
+    if (samples.empty()) return summary;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) {
+        size_t index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+        return samples[index];
+    };
+    double total = 0;
+    for (double sample : samples) total += sample;
+    summary.min = samples.front();
+    summary.p50 = at(0.50);
+    summary.p95 = at(0.95);
+    summary.p99 = at(0.99);
+    summary.max = samples.back();
+    summary.mean = total / static_cast<double>(samples.size());
+    return summary;
+}
+
+void add_summary(json& result, const std::string& prefix, const std::string& unit, const Summary& summary) {
+    result[prefix + "min_" + unit] = summary.min;
+    result[prefix + "p50_" + unit] = summary.p50;
+    result[prefix + "p95_" + unit] = summary.p95;
+    result[prefix + "p99_" + unit] = summary.p99;
+    result[prefix + "max_" + unit] = summary.max;
+    result[prefix + "mean_" + unit] = summary.mean;
+}
+
+void emit(const json& result) {
+    std::cout << result.dump() << std::endl;
+}
+
+struct Target {
+    std::string name;
+    gassist::ProcessOptions process;
+};
+
+// Fresh processes one after another; the first run is reported separately
+// because it is the only one that pays for a cold file cache
+bool bench_cold_starts(const Target& target, size_t runs) {
+    std::vector<double> ready;
+    std::vector<double> handshake;
+    std::vector<double> initialize;
+    std::vector<double> total;
+    double first_total = 0;
+
+    for (size_t i = 0; i < runs; ++i) {
+        gassist::PluginProcess process;
+        std::string error;
+        if (!process.start(target.process, &error)) {
+            std::cerr << target.name << ": cold start " << i << " failed: " << error << std::endl;
+            return false;
+        }
+        const gassist::StartupTiming& timing = process.timing();
+        if (i == 0) first_total = timing.total_ms();
+        ready.push_back(timing.ready_ms);
+        handshake.push_back(timing.handshake_ms);
+        initialize.push_back(timing.initialize_ms);
+        total.push_back(timing.total_ms());
+        process.stop();
+    }
+
+    json result;
+    result["benchmark"] = "cold_start";
+    result["plugin"] = target.name;
+    result["runs"] = runs;
+    result["first_total_ms"] = first_total;
+    add_summary(result, "ready_", "ms", summarize(ready));
+    add_summary(result, "handshake_", "ms", summarize(handshake));
+    add_summary(result, "initialize_", "ms", summarize(initialize));
+    add_summary(result, "total_", "ms", summarize(total));
+    emit(result);
+    return true;
+}
+
+void report_startup(gassist::PluginHost& host) {
+    for (const std::string& name : host.plugins()) {
+        for (const json& process : host.pool(name)->report()) {
+            json result = process;
+            result["benchmark"] = "startup";
+            result["plugin"] = name;
+            emit(result);
+        }
+    }
+}
+
+bool bench_load(gassist::PluginHost& host, const Options& options, const std::string& function) {
+    std::vector<std::string> plugins = host.plugins();
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> errors(0);
+    std::vector<std::vector<double>> latencies(options.concurrency);
+
+    auto started = Clock::now();
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < options.concurrency; ++c) {
+        clients.emplace_back([&, c] {
+            latencies[c].reserve(options.requests / options.concurrency + 1);
+            while (true) {
+                size_t index = next.fetch_add(1);
+                if (index >= options.requests) break;
+
+                auto start = Clock::now();
+                gassist::Response response = host.execute(plugins[index % plugins.size()], function,
+                                                          options.arguments).get();
+                latencies[c].push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+                if (!response.ok) {
+                    if (errors.fetch_add(1) == 0) {
+                        std::cerr << "First failed request: " << response.error << std::endl;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+    double total_s = std::chrono::duration<double>(Clock::now() - started).count();
+
+    std::vector<double> all;
+    for (const auto& samples : latencies) all.insert(all.end(), samples.begin(), samples.end());
+
+    size_t processes = 0;
+    for (const std::string& name : plugins) processes += host.pool(name)->size();
+
+    json result;
+    result["benchmark"] = "load";
+    result["function"] = function;
+    result["plugins"] = plugins.size();
+    result["processes"] = processes;
+    result["concurrency"] = options.concurrency;
+    result["requests"] = all.size();
+    result["errors"] = errors.load();
+    result["requests_per_s"] = all.size() / total_s;
+    add_summary(result, "", "us", summarize(all));
+    emit(result);
+    return errors == 0;
+}
+
+// One traced request per plugin, on warm processes
+bool write_traces(gassist::PluginHost& host, const Options& options, const std::string& function) {
+    std::vector<std::string> plugins = host.plugins();
+    bool ok = true;
+    for (size_t i = 0; i < plugins.size(); ++i) {
+        std::string trace_id = "plugin-loadtest-" + std::to_string(i + 1);
+        gassist::Response response = host.execute(plugins[i], function, options.arguments,
+                                                   nullptr, trace_id).get();
+
+        std::string path = options.trace_directory + "/" + trace_id + ".json";
+        std::string error;
+        if (!gassist::write_chrome_trace(path, response.trace, trace_id, &error)) {
+            std::cerr << error << std::endl;
+            ok = false;
+            continue;
+        }
+
+        json result;
+        result["benchmark"] = "trace";
+        result["plugin"] = plugins[i];
+        result["trace_id"] = trace_id;
+        result["path"] = path;
+        result["ok"] = response.ok;
+        result["events"] = response.trace.size();
+        emit(result);
+    }
+    return ok;
+}
+
+bool parse_size(const char* text, size_t& out) {
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (!end || end == text || *end != '\0') return false;
+    out = static_cast<size_t>(value);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    bool serve = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next_value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        auto value = [&](size_t& out) {
+            if (!parse_size(next_value(), out)) {
+                std::cerr << "Invalid value for " << arg << std::endl;
+                std::exit(2);
+            }
+        };
+
+        if (arg == "--serve") serve = true;
+        else if (arg == "--plugin") options.plugins.push_back(next_value());
+        else if (arg == "--pool") value(options.pool);
+        else if (arg == "--concurrency") value(options.concurrency);
+        else if (arg == "--requests") value(options.requests);
+        else if (arg == "--function") options.function = next_value();
+        else if (arg == "--args") {
+            options.arguments = json::parse(next_value(), nullptr, false);
+            if (options.arguments.is_discarded() || !options.arguments.is_object()) {
+                std::cerr << "--args must be a JSON object" << std::endl;
+                return 2;
+            }
+        }
+        else if (arg == "--cold-starts") value(options.cold_starts);
+        else if (arg == "--encoding") options.encoding = next_value();
+        else if (arg == "--no-init-command") options.init_command = false;
+        else if (arg == "--trace") options.trace_directory = next_value();
+        else if (arg == "--init-delay") value(options.init_delay_ms);
+        else if (arg == "--work-us") value(options.work_us);
+        else if (arg == "--workers") value(options.workers);
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    if (serve) {
+        return run_plugin(options);
+    }
+
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    options.concurrency = std::max<size_t>(1, options.concurrency);
+
+    std::vector<Target> targets;
+    if (options.plugins.empty()) {
+        Target self;
+        self.name = "plugin-loadtest";
+        self.process.executable = argv[0];
+        self.process.arguments = { "--serve", "--init-delay", std::to_string(options.init_delay_ms),
+                                   "--work-us", std::to_string(options.work_us),
+                                   "--workers", std::to_string(options.workers) };
+        targets.push_back(std::move(self));
+        if (options.function.empty()) options.function = "echo";
+    } else {
+        for (const std::string& directory : options.plugins) {
+            Target target;
+            std::string error;
+            if (!gassist::load_plugin_manifest(directory, target.process, target.name, &error)) {
+                std::cerr << directory << ": " << error << std::endl;
+                return 1;
+            }
+            targets.push_back(std::move(target));
+        }
+    }
+
+    for (Target& target : targets) {
+        if (!options.encoding.empty()) target.process.encodings = { options.encoding };
+        target.process.run_initialize_command = options.init_command;
+    }
+
+    json config;
+    config["benchmark"] = "config";
+    config["pool"] = options.pool;
+    config["concurrency"] = options.concurrency;
+    config["requests"] = options.requests;
+    config["function"] = options.function;
+    config["encoding"] = options.encoding.empty() ? "json" : options.encoding;
+    emit(config);
+
+    for (const Target& target : targets) {
+        if (options.cold_starts > 0 && !bench_cold_starts(target, options.cold_starts)) return 1;
+    }
+
+    gassist::PluginHost host;
+    for (const Target& target : targets) {
+        gassist::PoolOptions pool;
+        pool.process = target.process;
+        pool.size = options.pool;
+        if (!host.add(target.name, std::move(pool))) {
+            std::cerr << "Plugin '" << target.name << "' given twice" << std::endl;
+            return 2;
+        }
+    }
+
+    std::string error;
+    if (!host.start(&error)) {
+        std::cerr << "Failed to start plugins: " << error << std::endl;
+        return 1;
+    }
+    report_startup(host);
+
+    bool ok = true;
+    if (options.function.empty()) {
+        std::cerr << "No --function given; skipping the load test" << std::endl;
+    } else {
+        if (options.requests > 0) ok = bench_load(host, options, options.function);
+        if (!options.trace_directory.empty()) ok = write_traces(host, options, options.function) && ok;
+    }
+
+    host.stop();
+    return ok ? 0 : 1;
+}
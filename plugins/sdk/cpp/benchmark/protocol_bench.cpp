@@ -0,0 +1,548 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Protocol benchmark for the G-Assist C++ SDK.
+//
+// Drives a real gassist::Plugin through pipes with a synthetic host and
+// measures ping round-trip time, execute throughput across payload sizes and
+// stream notification rate. The same executable is both sides: it starts a
+// copy of itself with --plugin as the plugin under test.
+//
+// Results go to stdout as one JSON object per line, so runs can be diffed or
+// collected by scripts; progress and errors go to stderr.
+//
+// Usage:
+//   protocol_bench [--iterations N] [--max-size BYTES] [--stream-count N]
+//                  [--workers N] [--batch BYTES]
+//
+//   --workers and --batch are passed to the plugin (set_worker_threads and
+//   set_stream_batching) to compare SDK configurations.
+
+#include "gassist_sdk.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using gassist::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t iterations = 2000;
+    size_t max_size = gassist::Protocol::MAX_MESSAGE_SIZE - 1024;  // leave room for the envelope
+    size_t stream_count = 20000;
+    size_t workers = 0;
+    size_t batch = 0;
+};
+
+// ============================================================================
+// Plugin side
+// ============================================================================
+
+int run_plugin(const Options& options) {
+    gassist::Plugin plugin("protocol-bench", "1.0.0", "Protocol benchmark plugin");
+    if (options.workers > 0) plugin.set_worker_threads(options.workers);
+    if (options.batch > 0) plugin.set_stream_batching(options.batch);
+
+    // Payload travels both ways, like a lookup that returns what it was given
+    plugin.command("echo", [](const json& args) -> json {
+        auto it = args.find("data");
+        return it != args.end() ? *it : json();
+    });
+
+    plugin.command("stream", [](const json& args, gassist::RequestContext& context) -> json {
+        size_t count = args.value("count", 1000);
+        std::string chunk(args.value("chunk_size", 16), 't');
+        for (size_t i = 0; i < count; ++i) {
+            context.stream(chunk);
+        }
+        return count;
+    });
+
+    plugin.run();
+    return 0;
+}
+
+// ============================================================================
+// Host side
+// ============================================================================
+
+// Child plugin process with its stdin/stdout connected to pipes
+class PluginProcess {
+public:
+    PluginProcess() : m_read_pos(0) {}
+    ~PluginProcess() { stop(); }
+
+    bool start(const std::vector<std::string>& args) {
+#ifdef _WIN32
+        char path[MAX_PATH];
+        if (!GetModuleFileNameA(nullptr, path, MAX_PATH)) return false;
+
+        std::string command_line = std::string("\"") + path + "\"";
+        for (const auto& arg : args) command_line += " " + arg;
+
+        SECURITY_ATTRIBUTES security{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+        HANDLE child_stdin = nullptr;
+        HANDLE child_stdout = nullptr;
+        if (!CreatePipe(&child_stdin, &m_to_child, &security, 0)) return false;
+        if (!CreatePipe(&m_from_child, &child_stdout, &security, 0)) return false;
+        SetHandleInformation(m_to_child, HANDLE_FLAG_INHERIT, 0);
+        SetHandleInformation(m_from_child, HANDLE_FLAG_INHERIT, 0);
+
+        STARTUPINFOA startup{};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdInput = child_stdin;
+        startup.hStdOutput = child_stdout;
+        startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+        BOOL created = CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, TRUE, 0,
+                                      nullptr, nullptr, &startup, &m_process);
+        CloseHandle(child_stdin);
+        CloseHandle(child_stdout);
+        return created != FALSE;
+#else
+        int to_child[2];
+        int from_child[2];
+        if (pipe(to_child) != 0 || pipe(from_child) != 0) return false;
+
+        m_pid = fork();
+        if (m_pid < 0) return false;
+        if (m_pid == 0) {
+            dup2(to_child[0], STDIN_FILENO);
+            dup2(from_child[1], STDOUT_FILENO);
+            close(to_child[0]);
+            close(to_child[1]);
+            close(from_child[0]);
+            close(from_child[1]);
+
+            std::vector<char*> argv;
+            argv.push_back(const_cast<char*>(m_self.c_str()));
+            for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+            argv.push_back(nullptr);
+            execvp(m_self.c_str(), argv.data());
+            _exit(127);
+        }
+
+        close(to_child[0]);
+        close(from_child[1]);
+        m_to_child = to_child[1];
+        m_from_child = from_child[0];
+        return true;
+#endif
+    }
+
+    void set_executable(const std::string& path) { m_self = path; }
+
+    // JSON frames only; the plugin answers in JSON unless asked otherwise
+    bool send(const json& message) {
+        std::string payload = message.dump();
+        std::string frame(4, '\0');
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        frame[0] = static_cast<char>((length >> 24) & 0xFF);
+        frame[1] = static_cast<char>((length >> 16) & 0xFF);
+        frame[2] = static_cast<char>((length >> 8) & 0xFF);
+        frame[3] = static_cast<char>(length & 0xFF);
+        frame += payload;
+        return write_all(frame.data(), frame.size());
+    }
+
+    bool receive(json& message) {
+        if (!fill(4)) return false;
+        const uint8_t* header = m_buffer.data() + m_read_pos;
+        uint32_t length = ((static_cast<uint32_t>(header[0]) << 24) |
+                           (static_cast<uint32_t>(header[1]) << 16) |
+                           (static_cast<uint32_t>(header[2]) << 8) |
+                           static_cast<uint32_t>(header[3])) & gassist::Protocol::LENGTH_MASK;
+        if (!fill(4 + length)) return false;
+
+        const char* payload = reinterpret_cast<const char*>(m_buffer.data() + m_read_pos + 4);
+        m_read_pos += 4 + length;
+        try {
+            message = json::parse(payload, payload + length);
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    void stop() {
+        if (!running()) return;
+        send(json{ {"jsonrpc", "2.0"}, {"method", "shutdown"}, {"params", json::object()} });
+#ifdef _WIN32
+        CloseHandle(m_to_child);
+        WaitForSingleObject(m_process.hProcess, 5000);
+        CloseHandle(m_from_child);
+        CloseHandle(m_process.hProcess);
+        CloseHandle(m_process.hThread);
+        m_process = PROCESS_INFORMATION{};
+#else
+        close(m_to_child);
+        close(m_from_child);
+        waitpid(m_pid, nullptr, 0);
+        m_pid = -1;
+#endif
+    }
+
+private:
+    bool running() const {
+#ifdef _WIN32
+        return m_process.hProcess != nullptr;
+#else
+        return m_pid > 0;
+#endif
+    }
+
+    bool write_all(const char* data, size_t count) {
+        while (count > 0) {
+#ifdef _WIN32
+            DWORD written = 0;
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(count, 1u << 30));
+            if (!WriteFile(m_to_child, data, chunk, &written, nullptr) || written == 0) return false;
+#else
+            ssize_t written = write(m_to_child, data, count);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+#endif
+            data += written;
+            count -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    // Ensure `count` unread bytes are buffered
+    bool fill(size_t count) {
+        if (m_read_pos > 0 && m_buffer.size() - m_read_pos < count) {
+            m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(m_read_pos));
+            m_read_pos = 0;
+        }
+        while (m_buffer.size() - m_read_pos < count) {
+            size_t old_size = m_buffer.size();
+            size_t want = std::max<size_t>(count - (old_size - m_read_pos), 64 * 1024);
+            m_buffer.resize(old_size + want);
+#ifdef _WIN32
+            DWORD received = 0;
+            BOOL ok = ReadFile(m_from_child, m_buffer.data() + old_size, static_cast<DWORD>(want), &received, nullptr);
+            if (!ok) received = 0;
+#else
+            ssize_t received;
+            do {
+                received = read(m_from_child, m_buffer.data() + old_size, want);
+            } while (received < 0 && errno == EINTR);
+#endif
+            if (received <= 0) {
+                m_buffer.resize(old_size);
+                return false;
+            }
+            m_buffer.resize(old_size + static_cast<size_t>(received));
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> m_buffer;
+    size_t m_read_pos;
+    std::string m_self;
+#ifdef _WIN32
+    HANDLE m_to_child = nullptr;
+    HANDLE m_from_child = nullptr;
+    PROCESS_INFORMATION m_process{};
+#else
+    int m_to_child = -1;
+    int m_from_child = -1;
+    pid_t m_pid = -1;
+#endif
+};
+
+struct Summary {
+    double min_us;
+    double p50_us;
+    double p95_us;
+    double p99_us;
+    double mean_us;
+};
+
+Summary summarize(std::vector<double> samples) {
+    Summary summary{};
+    if (samples.empty()) return summary;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) {
+        size_t index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+        return samples[index];
+    };
+    double total = 0;
+    for (double sample : samples) total += sample;
+    summary.min_us = samples.front();
+    summary.p50_us = at(0.50);
+    summary.p95_us = at(0.95);
+    summary.p99_us = at(0.99);
+    summary.mean_us = total / static_cast<double>(samples.size());
+    return summary;
+}
+
+void add_summary(json& result, const Summary& summary) {
+    result["min_us"] = summary.min_us;
+    result["p50_us"] = summary.p50_us;
+    result["p95_us"] = summary.p95_us;
+    result["p99_us"] = summary.p99_us;
+    result["mean_us"] = summary.mean_us;
+}
+
+double elapsed_us(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+class Host {
+public:
+    explicit Host(PluginProcess& plugin) : m_plugin(plugin), m_next_id(1) {}
+
+    bool initialize() {
+        int id = m_next_id++;
+        if (!m_plugin.send(request(id, "initialize", json::object()))) return false;
+        json response;
+        return wait_response(id, response);
+    }
+
+    bool ping(double& rtt_us) {
+        int id = m_next_id++;
+        auto start = Clock::now();
+        if (!m_plugin.send(request(id, "ping", json{ {"timestamp", id} }))) return false;
+        json response;
+        if (!wait_response(id, response)) return false;
+        rtt_us = elapsed_us(start);
+        return true;
+    }
+
+    // Runs one execute and waits for its complete; counts stream frames on the way
+    bool execute(const std::string& function, json arguments, uint64_t* stream_frames = nullptr,
+                 uint64_t* stream_bytes = nullptr) {
+        int id = m_next_id++;
+        json params;
+        params["function"] = function;
+        params["arguments"] = std::move(arguments);
+        if (!m_plugin.send(request(id, "execute", std::move(params)))) return false;
+
+        json message;
+        while (m_plugin.receive(message)) {
+            const json& notification_params = message.value("params", json::object());
+            if (notification_params.value("request_id", -1) != id) continue;
+
+            std::string method = message.value("method", "");
+            if (method == "stream") {
+                if (stream_frames) ++*stream_frames;
+                if (stream_bytes) *stream_bytes += notification_params.value("data", "").size();
+            } else if (method == "complete") {
+                return notification_params.value("success", false);
+            } else if (method == "error") {
+                std::cerr << "execute failed: " << notification_params.value("message", "") << std::endl;
+                return false;
+            }
+        }
+        return false;
+    }
+
+private:
+    static json request(int id, const char* method, json params) {
+        json message;
+        message["jsonrpc"] = "2.0";
+        message["id"] = id;
+        message["method"] = method;
+        message["params"] = std::move(params);
+        return message;
+    }
+
+    bool wait_response(int id, json& response) {
+        while (m_plugin.receive(response)) {
+            auto it = response.find("id");
+            if (it != response.end() && it->is_number_integer() && it->get<int>() == id) return true;
+        }
+        return false;
+    }
+
+    PluginProcess& m_plugin;
+    int m_next_id;
+};
+
+void emit(const json& result) {
+    std::cout << result.dump() << std::endl;
+}
+
+bool bench_ping(Host& host, const Options& options) {
+    std::vector<double> samples;
+    samples.reserve(options.iterations);
+
+    double rtt = 0;
+    for (size_t i = 0; i < options.iterations / 10; ++i) {
+        if (!host.ping(rtt)) return false;  // warm-up
+    }
+    for (size_t i = 0; i < options.iterations; ++i) {
+        if (!host.ping(rtt)) return false;
+        samples.push_back(rtt);
+    }
+
+    json result;
+    result["benchmark"] = "ping";
+    result["iterations"] = samples.size();
+    add_summary(result, summarize(samples));
+    emit(result);
+    return true;
+}
+
+bool bench_execute(Host& host, const Options& options) {
+    std::vector<size_t> sizes;
+    for (size_t size = 100; size < options.max_size; size *= 10) sizes.push_back(size);
+    sizes.push_back(options.max_size);
+
+    for (size_t size : sizes) {
+        // Keep the bytes moved per size roughly bounded
+        size_t iterations = std::max<size_t>(3, std::min(options.iterations, (256u * 1024 * 1024) / (size * 2)));
+        std::string data(size, 'x');
+
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        auto total_start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            auto start = Clock::now();
+            if (!host.execute("echo", json{ {"data", data} })) return false;
+            samples.push_back(elapsed_us(start));
+        }
+        double total_us = elapsed_us(total_start);
+
+        json result;
+        result["benchmark"] = "execute";
+        result["payload_bytes"] = size;
+        result["iterations"] = iterations;
+        add_summary(result, summarize(samples));
+        result["requests_per_s"] = iterations / (total_us / 1e6);
+        result["throughput_mb_s"] = (2.0 * size * iterations) / (total_us / 1e6) / (1024.0 * 1024.0);
+        emit(result);
+        std::cerr << "execute " << size << " B done" << std::endl;
+    }
+    return true;
+}
+
+bool bench_stream(Host& host, const Options& options) {
+    for (size_t chunk_size : { size_t(16), size_t(256), size_t(4096) }) {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        auto start = Clock::now();
+        if (!host.execute("stream", json{ {"count", options.stream_count}, {"chunk_size", chunk_size} },
+                          &frames, &bytes)) {
+            return false;
+        }
+        double total_us = elapsed_us(start);
+
+        json result;
+        result["benchmark"] = "stream";
+        result["chunk_bytes"] = chunk_size;
+        result["chunks"] = options.stream_count;
+        result["frames"] = frames;
+        result["total_us"] = total_us;
+        result["chunks_per_s"] = options.stream_count / (total_us / 1e6);
+        result["frames_per_s"] = frames / (total_us / 1e6);
+        result["throughput_mb_s"] = bytes / (total_us / 1e6) / (1024.0 * 1024.0);
+        emit(result);
+    }
+    return true;
+}
+
+bool parse_size(const char* text, size_t& out) {
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (!end || *end != '\0') return false;
+    out = static_cast<size_t>(value);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    bool plugin_mode = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](size_t& out) {
+            if (i + 1 >= argc || !parse_size(argv[++i], out)) {
+                std::cerr << "Invalid value for " << arg << std::endl;
+                std::exit(2);
+            }
+        };
+
+        if (arg == "--plugin") plugin_mode = true;
+        else if (arg == "--iterations") value(options.iterations);
+        else if (arg == "--max-size") value(options.max_size);
+        else if (arg == "--stream-count") value(options.stream_count);
+        else if (arg == "--workers") value(options.workers);
+        else if (arg == "--batch") value(options.batch);
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    if (plugin_mode) {
+        return run_plugin(options);
+    }
+
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    options.max_size = std::min(options.max_size, gassist::Protocol::MAX_MESSAGE_SIZE - 1024);
+
+    PluginProcess plugin;
+    plugin.set_executable(argv[0]);
+    std::vector<std::string> plugin_args = { "--plugin" };
+    if (options.workers > 0) {
+        plugin_args.push_back("--workers");
+        plugin_args.push_back(std::to_string(options.workers));
+    }
+    if (options.batch > 0) {
+        plugin_args.push_back("--batch");
+        plugin_args.push_back(std::to_string(options.batch));
+    }
+
+    if (!plugin.start(plugin_args)) {
+        std::cerr << "Failed to start plugin process" << std::endl;
+        return 1;
+    }
+
+    Host host(plugin);
+    if (!host.initialize()) {
+        std::cerr << "Plugin did not answer initialize" << std::endl;
+        return 1;
+    }
+
+    json config;
+    config["benchmark"] = "config";
+    config["iterations"] = options.iterations;
+    config["max_size"] = options.max_size;
+    config["workers"] = options.workers;
+    config["batch_bytes"] = options.batch;
+    emit(config);
+
+    bool ok = bench_ping(host, options) && bench_execute(host, options) && bench_stream(host, options);
+    plugin.stop();
+
+    if (!ok) {
+        std::cerr << "Benchmark aborted: plugin connection failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,843 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+// G-Assist Plugin Host for C++ (Protocol V2 - JSON-RPC 2.0)
+//
+// Runs plugin executables the way the engine does - as child processes
+// speaking Protocol V2 over their stdin/stdout - for load tests and start-up
+// measurements. Frames are read and written with gassist::Protocol from
+// gassist_sdk.hpp, so the host and C++ plugins share one implementation.
+//
+//   PluginProcess  one plugin process. Requests are multiplexed over its
+//                  pipe by JSON-RPC id and answered through futures, so any
+//                  number can be in flight at once.
+//   PluginPool     several prewarmed processes of one plugin; each request
+//                  goes to the least busy one.
+//   PluginHost     pools for several plugins, addressed by name.
+//
+// Usage:
+//   #include <nlohmann/json.hpp>
+//   #include "gassist_host.hpp"
+//
+//   gassist::PluginHost host;
+//   host.add_directory("plugins/hello-world", 4);
+//   std::string error;
+//   if (!host.start(&error)) { ... }
+//   gassist::Response reply = host.execute("hello-world", "say_hello", {{"name", "Ada"}}).get();
+//
+// Warm-up times every process: until it answers its first ping (process
+// start, runtime loading, Plugin construction), the initialize handshake,
+// and the plugin's own `initialize` command when it registers one - which is
+// where device SDKs are usually brought up.
+//
+// execute() takes an optional trace id, sent to the plugin as
+// params["trace_id"]. The SDK then returns the plugin's spans with the
+// outcome, and Response::trace holds them after the host's own span of the
+// request as Chrome trace events; write_chrome_trace() saves them.
+//
+// Stream handlers run on the process's reader thread and should return
+// quickly. On POSIX, ignore SIGPIPE in the host so a plugin that exits while
+// a request is being written shows up as a failed request.
+
+#ifndef GASSIST_HOST_HPP
+#define GASSIST_HOST_HPP
+
+#include "gassist_sdk.hpp"
+
+#include <filesystem>
+#include <future>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+namespace gassist {
+
+// ============================================================================
+// Options and Results
+// ============================================================================
+
+struct ProcessOptions {
+    std::string executable;
+    std::vector<std::string> arguments;
+    std::string working_directory;                  // empty = the host's
+    std::vector<std::string> encodings;             // offered in initialize, most preferred first
+    bool run_initialize_command = true;             // run the plugin's `initialize` command during warm-up
+    std::chrono::milliseconds timeout{ 30000 };     // per warm-up step
+};
+
+struct StartupTiming {
+    double spawn_ms = 0;        // creating the process
+    double ready_ms = 0;        // from spawn until the first ping is answered
+    double handshake_ms = 0;    // initialize round trip
+    double initialize_ms = 0;   // the plugin's `initialize` command; 0 if it has none
+
+    double total_ms() const { return ready_ms + handshake_ms + initialize_ms; }
+};
+
+struct Response {
+    bool ok = false;
+    json result;                                // `result` of a response, `data` of a completed execute
+    int error_code = 0;
+    std::string error;
+    bool keep_session = false;
+    uint64_t stream_frames = 0;
+    std::chrono::microseconds latency{ 0 };     // request written until the outcome was read
+    std::string trace_id;                       // as passed to execute()
+    json trace;                                 // Chrome trace events of a traced execute, host then plugin
+};
+
+// Read a plugin directory's manifest.json into options (executable and
+// working directory) and the plugin's name. Paths are made absolute: the
+// process starts in the plugin directory, so a relative executable would
+// resolve against it a second time.
+inline bool load_plugin_manifest(const std::string& directory, ProcessOptions& options,
+                                 std::string& name, std::string* error = nullptr) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path root = fs::absolute(directory, ec);
+    if (ec) {
+        if (error) *error = "Cannot resolve " + directory + ": " + ec.message();
+        return false;
+    }
+    fs::path manifest_path = root / "manifest.json";
+    std::ifstream stream(manifest_path);
+    if (!stream) {
+        if (error) *error = "Cannot open " + manifest_path.string();
+        return false;
+    }
+
+    json manifest;
+    try {
+        manifest = json::parse(stream);
+    } catch (const std::exception& e) {
+        if (error) *error = "Invalid manifest: " + std::string(e.what());
+        return false;
+    }
+
+    std::string executable = manifest.value("executable", "");
+    if (executable.empty()) {
+        if (error) *error = "Manifest has no executable";
+        return false;
+    }
+
+    name = manifest.value("name", fs::path(directory).filename().string());
+    options.executable = (root / executable).lexically_normal().string();
+    options.working_directory = root.lexically_normal().string();
+    return true;
+}
+
+// ============================================================================
+// Plugin Process
+// ============================================================================
+
+class PluginProcess {
+public:
+    using StreamHandler = std::function<void(const std::string& data)>;
+
+    PluginProcess() : m_connected(false), m_next_id(1), m_in_flight(0), m_completed(0) {}
+    ~PluginProcess() { stop(); }
+
+    PluginProcess(const PluginProcess&) = delete;
+    PluginProcess& operator=(const PluginProcess&) = delete;
+
+    // Start the process and warm it up: ping, initialize and the plugin's
+    // `initialize` command. On failure the process is stopped again.
+    bool start(const ProcessOptions& options, std::string* error = nullptr) {
+        auto fail = [this, error](const std::string& reason) {
+            if (error) *error = reason;
+            stop(std::chrono::milliseconds(0));
+            return false;
+        };
+
+        stop();
+        m_timing = StartupTiming{};
+        m_info = json::object();
+
+        auto spawned = Clock::now();
+        std::string reason;
+        if (!spawn(options, reason)) return fail(reason);
+        m_timing.spawn_ms = elapsed_ms(spawned);
+
+        m_protocol = std::make_unique<Protocol>(m_from_child, m_to_child);
+        m_connected = true;
+        m_reader = std::thread([this] { read_loop(); });
+
+        Response pong = wait(request("ping", json{ {"timestamp", 0} }), options.timeout);
+        if (!pong.ok) return fail("No answer to ping: " + pong.error);
+        m_timing.ready_ms = elapsed_ms(spawned);
+
+        json params;
+        params["protocol_version"] = "2.0";
+        params["engine_version"] = "gassist-host";
+        if (!options.encodings.empty()) params["encodings"] = options.encodings;
+
+        Response initialized = wait(request("initialize", std::move(params)), options.timeout);
+        if (!initialized.ok) return fail("initialize failed: " + initialized.error);
+        m_timing.handshake_ms = to_ms(initialized.latency);
+        m_info = std::move(initialized.result);
+
+        // The plugin switches after its initialize response; answer in kind
+        std::string encoding = m_info.value("encoding", "json");
+        if (encoding == "cbor") m_protocol->set_write_encoding(Encoding::Cbor);
+        else if (encoding == "msgpack") m_protocol->set_write_encoding(Encoding::MessagePack);
+
+        if (options.run_initialize_command && has_command("initialize")) {
+            Response ready = wait(execute("initialize", json::object()), options.timeout);
+            if (!ready.ok) return fail("initialize command failed: " + ready.error);
+            m_timing.initialize_ms = to_ms(ready.latency);
+        }
+        return true;
+    }
+
+    /**
+     * Send a request and resolve the future with its outcome. For `execute`
+     * and `input` that is the complete or error notification, and stream
+     * notifications on the way go to `on_stream`; for other methods it is
+     * the response with the same id. If the process exits first the future
+     * resolves with an error.
+     */
+    std::future<Response> request(const std::string& method, json params, StreamHandler on_stream = nullptr) {
+        auto pending = std::make_shared<Pending>();
+        pending->on_stream = std::move(on_stream);
+        pending->notified = method == "execute" || method == "input";
+        if (pending->notified) {
+            pending->function = params.value("function", method);
+            pending->trace_id = params.value("trace_id", "");
+        }
+        std::future<Response> future = pending->promise.get_future();
+
+        int id;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            if (!m_connected) {
+                Response response;
+                response.error = "Plugin process is not running";
+                pending->promise.set_value(std::move(response));
+                return future;
+            }
+            id = m_next_id++;
+            pending->id = id;
+            pending->sent = Clock::now();
+            m_pending.emplace(id, pending);
+            ++m_in_flight;
+        }
+
+        json message;
+        message["jsonrpc"] = "2.0";
+        message["id"] = id;
+        message["method"] = method;
+        message["params"] = std::move(params);
+        if (!m_protocol->write_message(message)) {
+            Response response;
+            response.error = "Failed to send request to the plugin process";
+            finish(id, std::move(response));
+        }
+        return future;
+    }
+
+    std::future<Response> execute(const std::string& function, json arguments, StreamHandler on_stream = nullptr,
+                                  const std::string& trace_id = std::string()) {
+        json params;
+        params["function"] = function;
+        params["arguments"] = std::move(arguments);
+        if (!trace_id.empty()) params["trace_id"] = trace_id;
+        return request("execute", std::move(params), std::move(on_stream));
+    }
+
+    // Wait for a request's outcome; a timed-out request stays in flight
+    static Response wait(std::future<Response> future, std::chrono::milliseconds timeout) {
+        if (future.wait_for(timeout) != std::future_status::ready) {
+            Response response;
+            response.error = "Timed out";
+            return response;
+        }
+        return future.get();
+    }
+
+    bool running() const { return m_connected; }
+    size_t in_flight() const { return m_in_flight; }
+    uint64_t completed() const { return m_completed; }
+    const StartupTiming& timing() const { return m_timing; }
+
+    // Result of the initialize handshake (name, version, commands, encoding)
+    const json& info() const { return m_info; }
+
+    bool has_command(const std::string& name) const {
+        auto commands = m_info.find("commands");
+        if (commands == m_info.end() || !commands->is_array()) return false;
+        for (const auto& command : *commands) {
+            if (command.is_object() && command.value("name", "") == name) return true;
+        }
+        return false;
+    }
+
+    Protocol::Stats stats() const {
+        return m_protocol ? m_protocol->stats() : Protocol::Stats{};
+    }
+
+    // Ask the plugin to shut down and wait up to `grace` for it to exit
+    // (in-flight commands finish first), then kill it. Call it once no other
+    // thread is sending requests.
+    void stop(std::chrono::milliseconds grace = std::chrono::milliseconds(5000)) {
+        if (!process_started()) return;
+
+        if (m_connected) {
+            json message;
+            message["jsonrpc"] = "2.0";
+            message["method"] = "shutdown";
+            message["params"] = json::object();
+            m_protocol->write_message(message);
+        }
+        close_handle(m_to_child);  // EOF ends the plugin's loop as well
+        wait_for_exit(grace);
+
+        if (m_reader.joinable()) m_reader.join();
+        close_handle(m_from_child);
+        m_protocol.reset();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        std::promise<Response> promise;
+        StreamHandler on_stream;
+        int id = 0;
+        Clock::time_point sent;
+        bool notified = false;          // outcome arrives as a complete/error notification
+        uint64_t stream_frames = 0;
+        std::string function;
+        std::string trace_id;
+    };
+
+#ifdef _WIN32
+    using Handle = HANDLE;
+    static constexpr Handle NO_HANDLE = nullptr;
+#else
+    using Handle = int;
+    static constexpr Handle NO_HANDLE = -1;
+#endif
+
+    static double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    static double to_ms(std::chrono::microseconds duration) {
+        return duration.count() / 1000.0;
+    }
+
+    // Processes are created one at a time so a child never inherits the
+    // pipe ends of a sibling started concurrently
+    static std::mutex& spawn_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    bool spawn(const ProcessOptions& options, std::string& error) {
+        std::lock_guard<std::mutex> lock(spawn_mutex());
+#ifdef _WIN32
+        auto quote = [](const std::string& value) {
+            return value.find_first_of(" \t\"") == std::string::npos && !value.empty()
+                ? value : "\"" + value + "\"";
+        };
+        std::string command_line = quote(options.executable);
+        for (const auto& argument : options.arguments) command_line += " " + quote(argument);
+
+        SECURITY_ATTRIBUTES security{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+        HANDLE child_stdin = nullptr;
+        HANDLE child_stdout = nullptr;
+        if (!CreatePipe(&child_stdin, &m_to_child, &security, 0)) {
+            error = "Failed to create pipe";
+            return false;
+        }
+        if (!CreatePipe(&m_from_child, &child_stdout, &security, 0)) {
+            CloseHandle(child_stdin);
+            close_handle(m_to_child);
+            error = "Failed to create pipe";
+            return false;
+        }
+        SetHandleInformation(m_to_child, HANDLE_FLAG_INHERIT, 0);
+        SetHandleInformation(m_from_child, HANDLE_FLAG_INHERIT, 0);
+
+        STARTUPINFOA startup{};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdInput = child_stdin;
+        startup.hStdOutput = child_stdout;
+        startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+        const char* directory = options.working_directory.empty() ? nullptr : options.working_directory.c_str();
+        BOOL created = CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+                                      nullptr, directory, &startup, &m_process);
+        CloseHandle(child_stdin);
+        CloseHandle(child_stdout);
+        if (!created) {
+            close_handle(m_to_child);
+            close_handle(m_from_child);
+            m_process = PROCESS_INFORMATION{};
+            error = "Failed to start " + options.executable;
+            return false;
+        }
+        return true;
+#else
+        // Everything the child needs is built before fork
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(options.executable.c_str()));
+        for (const auto& argument : options.arguments) argv.push_back(const_cast<char*>(argument.c_str()));
+        argv.push_back(nullptr);
+        const char* directory = options.working_directory.empty() ? nullptr : options.working_directory.c_str();
+
+        int to_child[2];
+        int from_child[2];
+        if (pipe(to_child) != 0) {
+            error = "Failed to create pipe";
+            return false;
+        }
+        if (pipe(from_child) != 0) {
+            close(to_child[0]);
+            close(to_child[1]);
+            error = "Failed to create pipe";
+            return false;
+        }
+        fcntl(to_child[1], F_SETFD, FD_CLOEXEC);
+        fcntl(from_child[0], F_SETFD, FD_CLOEXEC);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(to_child[0]);
+            close(to_child[1]);
+            close(from_child[0]);
+            close(from_child[1]);
+            error = "Failed to start " + options.executable;
+            return false;
+        }
+        if (pid == 0) {
+            dup2(to_child[0], STDIN_FILENO);
+            dup2(from_child[1], STDOUT_FILENO);
+            close(to_child[0]);
+            close(to_child[1]);
+            close(from_child[0]);
+            close(from_child[1]);
+            if (directory && chdir(directory) != 0) _exit(127);
+            execvp(argv[0], argv.data());
+            _exit(127);  // shows up as the pipe closing before the first ping
+        }
+
+        close(to_child[0]);
+        close(from_child[1]);
+        m_pid = pid;
+        m_to_child = to_child[1];
+        m_from_child = from_child[0];
+        return true;
+#endif
+    }
+
+    bool process_started() const {
+#ifdef _WIN32
+        return m_process.hProcess != nullptr;
+#else
+        return m_pid > 0;
+#endif
+    }
+
+    static void close_handle(Handle& handle) {
+        if (handle == NO_HANDLE) return;
+#ifdef _WIN32
+        CloseHandle(handle);
+#else
+        close(handle);
+#endif
+        handle = NO_HANDLE;
+    }
+
+    void wait_for_exit(std::chrono::milliseconds grace) {
+#ifdef _WIN32
+        if (WaitForSingleObject(m_process.hProcess, static_cast<DWORD>(grace.count())) != WAIT_OBJECT_0) {
+            TerminateProcess(m_process.hProcess, 1);
+            WaitForSingleObject(m_process.hProcess, INFINITE);
+        }
+        CloseHandle(m_process.hProcess);
+        CloseHandle(m_process.hThread);
+        m_process = PROCESS_INFORMATION{};
+#else
+        auto deadline = Clock::now() + grace;
+        while (waitpid(m_pid, nullptr, WNOHANG) == 0) {
+            if (Clock::now() >= deadline) {
+                kill(m_pid, SIGKILL);
+                waitpid(m_pid, nullptr, 0);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        m_pid = -1;
+#endif
+    }
+
+    void read_loop() {
+        json message;
+        while (true) {
+            ReadStatus status = m_protocol->read_message(message);
+            if (status == ReadStatus::BadPayload) continue;  // counted in stats()
+            if (status != ReadStatus::Ok) break;
+            dispatch(message);
+        }
+
+        // The pipe closed: the process exited or is being stopped
+        std::map<int, std::shared_ptr<Pending>> orphaned;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            m_connected = false;
+            orphaned.swap(m_pending);
+        }
+        for (auto& [id, pending] : orphaned) {
+            Response response;
+            response.error = "Plugin process exited";
+            resolve(*pending, std::move(response));
+        }
+    }
+
+    std::shared_ptr<Pending> find_pending(int id) {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        auto it = m_pending.find(id);
+        return it != m_pending.end() ? it->second : nullptr;
+    }
+
+    void dispatch(json& message) {
+        if (!message.is_object()) return;
+
+        auto id_it = message.find("id");
+        if (id_it != message.end() && id_it->is_number_integer()) {
+            int id = id_it->get<int>();
+            std::shared_ptr<Pending> pending = find_pending(id);
+            if (!pending || pending->notified) return;  // e.g. the acknowledgment of `input`
+
+            Response response;
+            auto error_it = message.find("error");
+            if (error_it != message.end() && error_it->is_object()) {
+                response.error_code = error_it->value("code", -1);
+                response.error = error_it->value("message", "");
+            } else {
+                response.ok = true;
+                auto result_it = message.find("result");
+                if (result_it != message.end()) response.result = std::move(*result_it);
+            }
+            finish(id, std::move(response));
+            return;
+        }
+
+        auto method_it = message.find("method");
+        auto params_it = message.find("params");
+        if (method_it == message.end() || !method_it->is_string() ||
+            params_it == message.end() || !params_it->is_object()) {
+            return;
+        }
+        const std::string& method = method_it->get_ref<const std::string&>();
+        json& params = *params_it;
+        int request_id = params.value("request_id", -1);
+
+        if (method == "stream") {
+            std::shared_ptr<Pending> pending = find_pending(request_id);
+            if (!pending) return;
+            ++pending->stream_frames;   // only the reader thread touches it
+            if (pending->on_stream) {
+                auto data = params.find("data");
+                if (data == params.end()) pending->on_stream(std::string());
+                else if (data->is_string()) pending->on_stream(data->get_ref<const std::string&>());
+                else pending->on_stream(data->dump());
+            }
+        } else if (method == "complete") {
+            Response response;
+            response.ok = params.value("success", false);
+            auto data = params.find("data");
+            if (data != params.end()) response.result = std::move(*data);
+            response.keep_session = params.value("keep_session", false);
+            take_trace(params, response);
+            finish(request_id, std::move(response));
+        } else if (method == "error") {
+            Response response;
+            response.error_code = params.value("code", -1);
+            response.error = params.value("message", "");
+            take_trace(params, response);
+            finish(request_id, std::move(response));
+        }
+    }
+
+    static void take_trace(json& params, Response& response) {
+        auto trace = params.find("trace");
+        if (trace != params.end() && trace->is_array()) response.trace = std::move(*trace);
+    }
+
+    void finish(int id, Response response) {
+        std::shared_ptr<Pending> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            auto it = m_pending.find(id);
+            if (it == m_pending.end()) return;
+            pending = std::move(it->second);
+            m_pending.erase(it);
+        }
+        resolve(*pending, std::move(response));
+    }
+
+    void resolve(Pending& pending, Response response) {
+        Clock::time_point now = Clock::now();
+        response.stream_frames = pending.stream_frames;
+        response.latency = std::chrono::duration_cast<std::chrono::microseconds>(now - pending.sent);
+        if (!pending.trace_id.empty()) add_host_trace(pending, now, response);
+        --m_in_flight;
+        ++m_completed;
+        pending.promise.set_value(std::move(response));
+    }
+
+    // The host's span of a traced request, one row per JSON-RPC id, ahead
+    // of the plugin's events
+    static void add_host_trace(const Pending& pending, Clock::time_point now, Response& response) {
+        int64_t pid = detail::process_id();
+        int64_t ts = detail::trace_timestamp_us(pending.sent);
+        json events = json::array();
+        events.push_back({ {"name", "process_name"}, {"ph", "M"}, {"pid", pid}, {"tid", 0},
+                           {"args", {{"name", "plugin host"}}} });
+        events.push_back({ {"name", "host: execute " + pending.function}, {"cat", "host"}, {"ph", "X"},
+                           {"ts", ts}, {"dur", detail::trace_timestamp_us(now) - ts},
+                           {"pid", pid}, {"tid", pending.id},
+                           {"args", {{"trace_id", pending.trace_id}, {"ok", response.ok},
+                                     {"stream_frames", pending.stream_frames}}} });
+        if (response.trace.is_array()) {
+            for (json& event : response.trace) events.push_back(std::move(event));
+        }
+        response.trace_id = pending.trace_id;
+        response.trace = std::move(events);
+    }
+
+    std::unique_ptr<Protocol> m_protocol;
+    std::thread m_reader;
+    std::atomic<bool> m_connected;
+    std::map<int, std::shared_ptr<Pending>> m_pending;
+    std::mutex m_pending_mutex;
+    int m_next_id;
+    std::atomic<size_t> m_in_flight;
+    std::atomic<uint64_t> m_completed;
+    StartupTiming m_timing;
+    json m_info;
+    Handle m_to_child = NO_HANDLE;
+    Handle m_from_child = NO_HANDLE;
+#ifdef _WIN32
+    PROCESS_INFORMATION m_process{};
+#else
+    pid_t m_pid = -1;
+#endif
+};
+
+// ============================================================================
+// Plugin Pool
+// ============================================================================
+
+struct PoolOptions {
+    ProcessOptions process;
+    size_t size = 1;            // processes started and kept warm
+};
+
+class PluginPool {
+public:
+    explicit PluginPool(PoolOptions options) : m_options(std::move(options)), m_next(0) {}
+    ~PluginPool() { stop(); }
+
+    PluginPool(const PluginPool&) = delete;
+    PluginPool& operator=(const PluginPool&) = delete;
+
+    // Start and warm up every process in parallel; fails if any of them does
+    bool start(std::string* error = nullptr) {
+        stop();
+        m_processes.clear();
+        for (size_t i = 0; i < std::max<size_t>(1, m_options.size); ++i) {
+            m_processes.push_back(std::make_unique<PluginProcess>());
+        }
+
+        std::vector<std::string> errors(m_processes.size());
+        std::vector<char> started(m_processes.size(), 0);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < m_processes.size(); ++i) {
+            threads.emplace_back([this, i, &errors, &started] {
+                started[i] = m_processes[i]->start(m_options.process, &errors[i]);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        for (size_t i = 0; i < m_processes.size(); ++i) {
+            if (!started[i]) {
+                if (error) *error = "process " + std::to_string(i) + ": " + errors[i];
+                stop();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Run a command on the running process with the fewest requests in flight
+    std::future<Response> execute(const std::string& function, json arguments,
+                                  PluginProcess::StreamHandler on_stream = nullptr,
+                                  const std::string& trace_id = std::string()) {
+        PluginProcess* target = pick();
+        if (!target) {
+            std::promise<Response> failed;
+            Response response;
+            response.error = "No plugin process is running";
+            failed.set_value(std::move(response));
+            return failed.get_future();
+        }
+        return target->execute(function, std::move(arguments), std::move(on_stream), trace_id);
+    }
+
+    size_t size() const { return m_processes.size(); }
+    PluginProcess& process(size_t index) { return *m_processes[index]; }
+    const PoolOptions& options() const { return m_options; }
+
+    // Warm-up timing and request counts per process
+    json report() const {
+        json out = json::array();
+        for (size_t i = 0; i < m_processes.size(); ++i) {
+            const PluginProcess& process = *m_processes[i];
+            const StartupTiming& timing = process.timing();
+            json entry;
+            entry["process"] = i;
+            entry["running"] = process.running();
+            entry["spawn_ms"] = timing.spawn_ms;
+            entry["ready_ms"] = timing.ready_ms;
+            entry["handshake_ms"] = timing.handshake_ms;
+            entry["initialize_ms"] = timing.initialize_ms;
+            entry["completed"] = process.completed();
+            entry["in_flight"] = process.in_flight();
+            out.push_back(std::move(entry));
+        }
+        return out;
+    }
+
+    void stop() {
+        for (auto& process : m_processes) process->stop();
+    }
+
+private:
+    // Least loaded wins; the scan starts at a rotating index so ties spread out
+    PluginProcess* pick() {
+        size_t count = m_processes.size();
+        size_t first = m_next.fetch_add(1, std::memory_order_relaxed);
+        PluginProcess* best = nullptr;
+        size_t best_load = SIZE_MAX;
+        for (size_t i = 0; i < count; ++i) {
+            PluginProcess* process = m_processes[(first + i) % count].get();
+            if (!process->running()) continue;
+            size_t load = process->in_flight();
+            if (load < best_load) {
+                best = process;
+                best_load = load;
+                if (load == 0) break;
+            }
+        }
+        return best;
+    }
+
+    PoolOptions m_options;
+    std::vector<std::unique_ptr<PluginProcess>> m_processes;
+    std::atomic<size_t> m_next;
+};
+
+// ============================================================================
+// Plugin Host
+// ============================================================================
+
+class PluginHost {
+public:
+    PluginHost() = default;
+    ~PluginHost() { stop(); }
+
+    PluginHost(const PluginHost&) = delete;
+    PluginHost& operator=(const PluginHost&) = delete;
+
+    // Register a plugin before start(); false if the name is already taken
+    bool add(const std::string& name, PoolOptions options) {
+        return m_pools.emplace(name, std::make_unique<PluginPool>(std::move(options))).second;
+    }
+
+    // Register the plugin in a directory under the name in its manifest
+    bool add_directory(const std::string& directory, size_t pool_size = 1, std::string* error = nullptr) {
+        PoolOptions options;
+        options.size = pool_size;
+        std::string name;
+        if (!load_plugin_manifest(directory, options.process, name, error)) return false;
+        if (!add(name, std::move(options))) {
+            if (error) *error = "Plugin '" + name + "' is already registered";
+            return false;
+        }
+        return true;
+    }
+
+    // Start every pool in parallel
+    bool start(std::string* error = nullptr) {
+        std::vector<std::pair<const std::string*, PluginPool*>> pools;
+        for (auto& [name, pool] : m_pools) pools.emplace_back(&name, pool.get());
+
+        std::vector<std::string> errors(pools.size());
+        std::vector<char> started(pools.size(), 0);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < pools.size(); ++i) {
+            threads.emplace_back([i, &pools, &errors, &started] {
+                started[i] = pools[i].second->start(&errors[i]);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        for (size_t i = 0; i < pools.size(); ++i) {
+            if (!started[i]) {
+                if (error) *error = *pools[i].first + ": " + errors[i];
+                stop();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::future<Response> execute(const std::string& plugin, const std::string& function, json arguments,
+                                  PluginProcess::StreamHandler on_stream = nullptr,
+                                  const std::string& trace_id = std::string()) {
+        PluginPool* target = pool(plugin);
+        if (!target) {
+            std::promise<Response> failed;
+            Response response;
+            response.error = "Unknown plugin: " + plugin;
+            failed.set_value(std::move(response));
+            return failed.get_future();
+        }
+        return target->execute(function, std::move(arguments), std::move(on_stream), trace_id);
+    }
+
+    PluginPool* pool(const std::string& name) {
+        auto it = m_pools.find(name);
+        return it != m_pools.end() ? it->second.get() : nullptr;
+    }
+
+    std::vector<std::string> plugins() const {
+        std::vector<std::string> names;
+        for (const auto& [name, pool] : m_pools) names.push_back(name);
+        return names;
+    }
+
+    json report() const {
+        json out = json::object();
+        for (const auto& [name, pool] : m_pools) out[name] = pool->report();
+        return out;
+    }
+
+    void stop() {
+        for (auto& [name, pool] : m_pools) pool->stop();
+    }
+
+private:
+    std::map<std::string, std::unique_ptr<PluginPool>> m_pools;
+};
+
+} // namespace gassist
+
+#endif // GASSIST_HOST_HPP
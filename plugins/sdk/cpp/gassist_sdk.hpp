@@ -21,6 +21,29 @@
 //       plugin.run();
 //       return 0;
 //   }
+//
+// Concurrency:
+//   By default every command runs on the thread that reads from the engine.
+//   Call plugin.set_worker_threads(n) before run() to execute commands on a
+//   pool of n workers instead; ping is then always answered immediately, even
+//   while long-running commands are in flight. Handlers that need to stream or
+//   control passthrough from another thread can take a RequestContext&:
+//
+//       plugin.command("slow", [&](const json& args, gassist::RequestContext& ctx) {
+//           ctx.stream("working...");
+//           return json("done");
+//       });
+//
+//   Commands registered with plugin.command_async() get a gassist::AsyncResult
+//   to complete when their work is done, and free their thread meanwhile. The
+//   engine may send `cancel` for any in-flight request; handlers observe it
+//   through ctx.cancelled().
+//
+// Tracing:
+//   An execute request with a "trace_id" param is traced: its queue and
+//   handler spans, plus any ctx.trace_span() the handler opens, return with
+//   the result as Chrome trace events. plugin.set_trace_directory(dir) also
+//   writes every request's trace to a file.
 
 #ifndef GASSIST_SDK_HPP
 #define GASSIST_SDK_HPP
@@ -28,13 +51,28 @@
 #include <nlohmann/json.hpp>
 
 #include <string>
+#include <string_view>
 #include <map>
+#include <list>
+#include <unordered_map>
+#include <memory>
 #include <functional>
 #include <iostream>
 #include <fstream>
 #include <cstdint>
 #include <mutex>
 #include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <type_traits>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -42,157 +80,1359 @@
 #include <fcntl.h>
 #else
 #include <unistd.h>
+#include <cerrno>
 #endif
 
 namespace gassist {
 
-// Use nlohmann::json directly
-using json = nlohmann::json;
+// Use nlohmann::json directly
+using json = nlohmann::json;
+
+// ============================================================================
+// Protocol Handler
+// ============================================================================
+
+// Controls when written frames are forced out to the engine.
+//   None         - rely on the pipe; frames are visible as soon as they are written
+//   EveryMessage - flush the output handle after every frame (legacy behaviour)
+enum class FlushPolicy {
+    None,
+    EveryMessage
+};
+
+// Payload encoding of a frame. The top byte of the 4-byte length prefix
+// carries the encoding; it is always zero for JSON text, so frames from
+// peers that only speak JSON are unchanged. Binary encodings are only used
+// for writing after the engine asks for them in `initialize`.
+enum class Encoding : uint8_t {
+    Json = 0,
+    Cbor = 1,
+    MessagePack = 2
+};
+
+// Outcome of Protocol::read_message().
+//   Ok         - a message was decoded
+//   Closed     - the connection ended
+//   BadPayload - a well-framed payload did not decode; the next frame is
+//                still readable
+//   BadHeader  - the length prefix was invalid, so frame boundaries are lost
+//                and the connection is closed
+enum class ReadStatus {
+    Ok,
+    Closed,
+    BadPayload,
+    BadHeader
+};
+
+inline const char* encoding_name(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::Cbor: return "cbor";
+        case Encoding::MessagePack: return "msgpack";
+        default: return "json";
+    }
+}
+
+class Protocol {
+public:
+    // Traffic counters, readable while the connection is in use
+    struct Stats {
+        uint64_t bytes_read;
+        uint64_t bytes_written;
+        uint64_t frames_read;
+        uint64_t frames_written;
+        uint64_t parse_failures;  // malformed headers and undecodable payloads
+    };
+
+    static constexpr size_t MAX_MESSAGE_SIZE = 10 * 1024 * 1024; // 10MB
+    static constexpr size_t HEADER_SIZE = 4;
+    static constexpr uint32_t LENGTH_MASK = 0x00FFFFFF;
+    static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+    // Buffers grown past this by a single large message are released afterwards
+    static constexpr size_t BUFFER_RETAIN_LIMIT = 1024 * 1024;
+
+#ifdef _WIN32
+    using NativeHandle = HANDLE;
+#else
+    using NativeHandle = int;
+#endif
+
+    // Plugin side: frames are read from stdin and written to stdout
+    Protocol()
+        : m_closed(false), m_flush_policy(FlushPolicy::None), m_write_encoding(Encoding::Json),
+          m_read_pos(0), m_read_end(0), m_bytes_read(0), m_bytes_written(0),
+          m_frames_read(0), m_frames_written(0), m_parse_failures(0) {
+#ifdef _WIN32
+        m_input = GetStdHandle(STD_INPUT_HANDLE);
+        m_output = GetStdHandle(STD_OUTPUT_HANDLE);
+        // Set binary mode for stdin/stdout
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+#else
+        m_input = STDIN_FILENO;
+        m_output = STDOUT_FILENO;
+#endif
+    }
+
+    // Any other pair of pipe ends, e.g. a host talking to a plugin process.
+    // The handles stay owned by the caller.
+    Protocol(NativeHandle input, NativeHandle output)
+        : m_closed(false), m_flush_policy(FlushPolicy::None), m_write_encoding(Encoding::Json),
+          m_read_pos(0), m_read_end(0), m_bytes_read(0), m_bytes_written(0),
+          m_frames_read(0), m_frames_written(0), m_parse_failures(0),
+          m_input(input), m_output(output) {}
+
+    ReadStatus read_message(json& out_message) {
+        if (m_closed) return ReadStatus::Closed;
+
+        std::lock_guard<std::mutex> lock(m_read_mutex);
+
+        // Read 4-byte length header (big-endian, encoding in the top byte)
+        if (!fill_read_buffer(HEADER_SIZE)) {
+            m_closed = true;
+            return ReadStatus::Closed;
+        }
+
+        const uint8_t* header = m_read_buffer.data() + m_read_pos;
+        uint32_t prefix = (static_cast<uint32_t>(header[0]) << 24) | 
+                          (static_cast<uint32_t>(header[1]) << 16) | 
+                          (static_cast<uint32_t>(header[2]) << 8) | 
+                          static_cast<uint32_t>(header[3]);
+        Encoding encoding = static_cast<Encoding>(prefix >> 24);
+        uint32_t length = prefix & LENGTH_MASK;
+
+        if (length > MAX_MESSAGE_SIZE || length == 0 || encoding > Encoding::MessagePack) {
+            // There is no way to find the next frame from here
+            m_bytes_read += HEADER_SIZE;
+            ++m_parse_failures;
+            m_closed = true;
+            return ReadStatus::BadHeader;
+        }
+
+        // Read JSON payload
+        if (!fill_read_buffer(HEADER_SIZE + length)) {
+            m_closed = true;
+            return ReadStatus::Closed;
+        }
+
+        // Decode straight out of the connection buffer
+        const uint8_t* payload = m_read_buffer.data() + m_read_pos + HEADER_SIZE;
+        m_read_pos += HEADER_SIZE + length;
+        m_bytes_read += HEADER_SIZE + length;
+        ++m_frames_read;
+
+        try {
+            switch (encoding) {
+                case Encoding::Cbor:
+                    out_message = json::from_cbor(payload, payload + length);
+                    break;
+                case Encoding::MessagePack:
+                    out_message = json::from_msgpack(payload, payload + length);
+                    break;
+                default:
+                    out_message = json::parse(reinterpret_cast<const char*>(payload),
+                                              reinterpret_cast<const char*>(payload) + length);
+                    break;
+            }
+        } catch (...) {
+            ++m_parse_failures;
+            release_read_buffer_if_idle();
+            return ReadStatus::BadPayload;
+        }
+
+        release_read_buffer_if_idle();
+        return ReadStatus::Ok;
+    }
+
+    bool write_message(const json& message) {
+        if (m_closed) return false;
+
+        // Ensure jsonrpc field (only messages built without it pay for a copy)
+        if (message.is_object() && !message.contains("jsonrpc")) {
+            json msg = message;
+            msg["jsonrpc"] = "2.0";
+            return write_message(msg);
+        }
+
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+
+        // Serialize directly after a reserved header slot so header and
+        // payload leave in a single write
+        Encoding encoding = m_write_encoding;
+        m_write_buffer.assign(HEADER_SIZE, '\0');
+        serialize_into(m_write_buffer, message, encoding);
+
+        size_t payload_size = m_write_buffer.size() - HEADER_SIZE;
+        if (payload_size > MAX_MESSAGE_SIZE) {
+            release_write_buffer_if_large();
+            return false;
+        }
+
+        // Fill in length prefix
+        uint32_t length = static_cast<uint32_t>(payload_size) | (static_cast<uint32_t>(encoding) << 24);
+        m_write_buffer[0] = static_cast<char>((length >> 24) & 0xFF);
+        m_write_buffer[1] = static_cast<char>((length >> 16) & 0xFF);
+        m_write_buffer[2] = static_cast<char>((length >> 8) & 0xFF);
+        m_write_buffer[3] = static_cast<char>(length & 0xFF);
+
+        bool ok = write_bytes(reinterpret_cast<const uint8_t*>(m_write_buffer.data()), m_write_buffer.size());
+        if (ok) {
+            m_bytes_written += m_write_buffer.size();
+            ++m_frames_written;
+            if (m_flush_policy == FlushPolicy::EveryMessage) {
+                flush_output();
+            }
+        }
+
+        release_write_buffer_if_large();
+        return ok;
+    }
+
+    // Force any written frames out to the engine
+    void flush() {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        flush_output();
+    }
+
+    void set_flush_policy(FlushPolicy policy) { m_flush_policy = policy; }
+    FlushPolicy flush_policy() const { return m_flush_policy; }
+
+    // Encoding used for outgoing frames; incoming frames are decoded by marker
+    void set_write_encoding(Encoding encoding) { m_write_encoding = encoding; }
+    Encoding write_encoding() const { return m_write_encoding; }
+
+    void close() { m_closed = true; }
+    bool is_closed() const { return m_closed; }
+
+    Stats stats() const {
+        return Stats{ m_bytes_read.load(), m_bytes_written.load(), m_frames_read.load(),
+                      m_frames_written.load(), m_parse_failures.load() };
+    }
+
+private:
+    // Appends the payload to `out`. Binary encodings write into it directly;
+    // the public API has no way to do that for text, so JSON costs one
+    // temporary string.
+    static void serialize_into(std::string& out, const json& message, Encoding encoding) {
+        switch (encoding) {
+            case Encoding::Cbor:
+                json::to_cbor(message, out);
+                break;
+            case Encoding::MessagePack:
+                json::to_msgpack(message, out);
+                break;
+            default:
+                out += message.dump();
+                break;
+        }
+    }
+
+    // Make sure at least `count` unread bytes are buffered, reading from the
+    // input in large chunks so small frames usually arrive in one syscall
+    bool fill_read_buffer(size_t count) {
+        while (m_read_end - m_read_pos < count) {
+            if (m_read_pos > 0) {
+                size_t pending = m_read_end - m_read_pos;
+                if (pending > 0) {
+                    std::memmove(m_read_buffer.data(), m_read_buffer.data() + m_read_pos, pending);
+                }
+                m_read_pos = 0;
+                m_read_end = pending;
+            }
+            if (m_read_buffer.size() < count || m_read_buffer.size() < READ_CHUNK_SIZE) {
+                m_read_buffer.resize(std::max(count, READ_CHUNK_SIZE));
+            }
+
+            size_t received = read_some(m_read_buffer.data() + m_read_end, m_read_buffer.size() - m_read_end);
+            if (received == 0) return false;
+            m_read_end += received;
+        }
+        return true;
+    }
+
+    void release_read_buffer_if_idle() {
+        if (m_read_pos == m_read_end && m_read_buffer.size() > BUFFER_RETAIN_LIMIT) {
+            std::vector<uint8_t>().swap(m_read_buffer);
+            m_read_pos = m_read_end = 0;
+        }
+    }
+
+    void release_write_buffer_if_large() {
+        if (m_write_buffer.capacity() > BUFFER_RETAIN_LIMIT) {
+            std::string().swap(m_write_buffer);
+        }
+    }
+
+    // Read whatever is available (at least one byte); returns 0 on EOF/error
+    size_t read_some(uint8_t* buffer, size_t capacity) {
+#ifdef _WIN32
+        DWORD bytes_read = 0;
+        if (!ReadFile(m_input, buffer, static_cast<DWORD>(capacity), &bytes_read, NULL)) {
+            return 0;
+        }
+        return bytes_read;
+#else
+        while (true) {
+            ssize_t n = read(m_input, buffer, capacity);
+            if (n < 0 && errno == EINTR) continue;
+            return n > 0 ? static_cast<size_t>(n) : 0;
+        }
+#endif
+    }
+
+    bool write_bytes(const uint8_t* buffer, size_t count) {
+#ifdef _WIN32
+        size_t total_written = 0;
+        while (total_written < count) {
+            DWORD bytes_written = 0;
+            if (!WriteFile(m_output, buffer + total_written,
+                           static_cast<DWORD>(count - total_written), &bytes_written, NULL)) {
+                return false;
+            }
+            if (bytes_written == 0) return false;
+            total_written += bytes_written;
+        }
+        return true;
+#else
+        size_t total_written = 0;
+        while (total_written < count) {
+            ssize_t n = write(m_output, buffer + total_written, count - total_written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            total_written += n;
+        }
+        return true;
+#endif
+    }
+
+    void flush_output() {
+#ifdef _WIN32
+        FlushFileBuffers(m_output);
+#else
+        fsync(m_output);
+#endif
+    }
+
+    std::atomic<bool> m_closed;
+    FlushPolicy m_flush_policy;
+    std::atomic<Encoding> m_write_encoding;
+    std::mutex m_read_mutex;
+    std::mutex m_write_mutex;
+    std::vector<uint8_t> m_read_buffer;
+    size_t m_read_pos;
+    size_t m_read_end;
+    std::string m_write_buffer;
+    std::atomic<uint64_t> m_bytes_read;
+    std::atomic<uint64_t> m_bytes_written;
+    std::atomic<uint64_t> m_frames_read;
+    std::atomic<uint64_t> m_frames_written;
+    std::atomic<uint64_t> m_parse_failures;
+    NativeHandle m_input;
+    NativeHandle m_output;
+};
+
+// ============================================================================
+// Stream Batching
+// ============================================================================
+
+class RequestContext;
+
+// Coalesces stream() calls into fewer "stream" notifications. Buffered data
+// is flushed when it reaches max_bytes, when max_delay has passed since the
+// first buffered chunk, or when the request completes. A background thread
+// enforces the deadlines; it only runs while batching is enabled.
+class StreamBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t chunks;   // stream() calls
+        uint64_t frames;   // stream notifications actually written
+
+        uint64_t frames_saved() const { return chunks > frames ? chunks - frames : 0; }
+    };
+
+    StreamBatcher()
+        : m_enabled(false), m_max_bytes(0), m_max_delay(0), m_stopping(false),
+          m_chunks(0), m_frames(0) {}
+
+    ~StreamBatcher() { stop(); }
+
+    StreamBatcher(const StreamBatcher&) = delete;
+    StreamBatcher& operator=(const StreamBatcher&) = delete;
+
+    // Must be called before start()
+    void configure(size_t max_bytes, std::chrono::milliseconds max_delay) {
+        m_max_bytes = max_bytes;
+        m_max_delay = max_delay;
+        m_enabled = true;
+    }
+
+    bool enabled() const { return m_enabled; }
+    size_t max_bytes() const { return m_max_bytes; }
+    std::chrono::milliseconds max_delay() const { return m_max_delay; }
+
+    void start() {
+        if (!m_enabled || m_thread.joinable()) return;
+        m_stopping = false;
+        m_thread = std::thread([this] { flush_loop(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    // Ask for `context` to be flushed no later than `deadline`
+    void schedule(RequestContext* context, Clock::time_point deadline) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_deadlines.emplace(context, deadline);
+        }
+        m_condition.notify_one();
+    }
+
+    // Forget `context`; once this returns the flush thread no longer touches it
+    void release(RequestContext* context) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_deadlines.erase(context);
+    }
+
+    void record(uint64_t chunks, uint64_t frames) {
+        m_chunks += chunks;
+        m_frames += frames;
+    }
+
+    Stats stats() const {
+        return Stats{ m_chunks.load(), m_frames.load() };
+    }
+
+private:
+    void flush_loop();
+
+    bool m_enabled;
+    size_t m_max_bytes;
+    std::chrono::milliseconds m_max_delay;
+    bool m_stopping;
+    std::map<RequestContext*, Clock::time_point> m_deadlines;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+    std::atomic<uint64_t> m_chunks;
+    std::atomic<uint64_t> m_frames;
+};
+
+// ============================================================================
+// Metrics
+// ============================================================================
+
+// Log-scale latency histogram in microseconds. Every power of two is split
+// into SUB_BUCKETS buckets, so percentiles are within ~25% of the true value;
+// recording is one relaxed atomic add and never blocks readers.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 4;
+    static constexpr size_t BUCKET_COUNT = 40 * SUB_BUCKETS;  // up to ~12 days
+
+    LatencyHistogram() : m_count(0), m_sum_us(0), m_max_us(0) {
+        for (auto& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+
+    void record(std::chrono::microseconds latency) {
+        uint64_t us = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+        m_buckets[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum_us.fetch_add(us, std::memory_order_relaxed);
+
+        uint64_t max = m_max_us.load(std::memory_order_relaxed);
+        while (us > max && !m_max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t max_us() const { return m_max_us.load(std::memory_order_relaxed); }
+
+    double mean_us() const {
+        uint64_t n = count();
+        return n ? static_cast<double>(m_sum_us.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    // Upper bound of the bucket holding the p-th fraction (0..1) of samples
+    uint64_t percentile_us(double p) const {
+        uint64_t counts[BUCKET_COUNT];
+        uint64_t total = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total == 0) return 0;
+
+        uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total) + 0.5);
+        rank = std::min(std::max<uint64_t>(rank, 1), total);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucket_upper_bound(i), max_us());
+        }
+        return max_us();
+    }
+
+private:
+    static unsigned floor_log2(uint64_t value) {
+        unsigned result = 0;
+        while (value >>= 1) ++result;
+        return result;
+    }
+
+    // Values below SUB_BUCKETS map to themselves; above that, the exponent
+    // picks the group and the next two bits below the leading one the bucket
+    static size_t bucket_index(uint64_t us) {
+        if (us < SUB_BUCKETS) return static_cast<size_t>(us);
+        unsigned exponent = floor_log2(us);
+        size_t sub = static_cast<size_t>((us >> (exponent - 2)) & (SUB_BUCKETS - 1));
+        size_t index = (exponent - 1) * SUB_BUCKETS + sub;
+        return std::min(index, BUCKET_COUNT - 1);
+    }
+
+    static uint64_t bucket_upper_bound(size_t index) {
+        if (index < SUB_BUCKETS) return index;
+        unsigned exponent = static_cast<unsigned>(index / SUB_BUCKETS) + 1;
+        uint64_t sub = index % SUB_BUCKETS;
+        uint64_t width = uint64_t(1) << (exponent - 2);
+        return (SUB_BUCKETS + sub) * width + width - 1;
+    }
+
+    std::atomic<uint64_t> m_buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum_us;
+    std::atomic<uint64_t> m_max_us;
+};
+
+// Per-command counters. Latency runs from the moment the request is read to
+// the moment its outcome is written, so it includes time queued for a worker.
+struct CommandMetrics {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> cancelled{0};
+    std::atomic<uint64_t> cache_hits{0};
+    std::atomic<uint64_t> cache_misses{0};
+    LatencyHistogram latency;
+
+    json to_json() const {
+        auto ms = [](double us) { return us / 1000.0; };
+        json out;
+        out["calls"] = calls.load();
+        out["errors"] = errors.load();
+        out["cancelled"] = cancelled.load();
+        out["cache_hits"] = cache_hits.load();
+        out["cache_misses"] = cache_misses.load();
+        out["latency_ms"]["p50"] = ms(static_cast<double>(latency.percentile_us(0.50)));
+        out["latency_ms"]["p95"] = ms(static_cast<double>(latency.percentile_us(0.95)));
+        out["latency_ms"]["p99"] = ms(static_cast<double>(latency.percentile_us(0.99)));
+        out["latency_ms"]["max"] = ms(static_cast<double>(latency.max_us()));
+        out["latency_ms"]["mean"] = ms(latency.mean_us());
+        return out;
+    }
+};
+
+// ============================================================================
+// Tracing
+// ============================================================================
+
+// A caller asks for a trace of one request by putting "trace_id" in the
+// execute params (RISE clients send it as client_config.trace_id). The SDK
+// then records when the request was received, queued and handled, plus any
+// spans the handler adds, and returns them in the complete or error
+// notification as params["trace"]: an array of Chrome trace events
+// (chrome://tracing, ui.perfetto.dev) in microseconds since the Unix epoch,
+// so they line up with the caller's own events.
+
+namespace detail {
+
+inline int64_t trace_timestamp_us(std::chrono::steady_clock::time_point time) {
+    using namespace std::chrono;
+    static const steady_clock::time_point steady_anchor = steady_clock::now();
+    static const int64_t system_anchor_us = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    return system_anchor_us + duration_cast<microseconds>(time - steady_anchor).count();
+}
+
+inline int64_t process_id() {
+#ifdef _WIN32
+    return static_cast<int64_t>(GetCurrentProcessId());
+#else
+    return static_cast<int64_t>(getpid());
+#endif
+}
+
+// Trace ids made of characters that are safe in file names
+inline std::string trace_file_part(const std::string& text) {
+    std::string out = text;
+    for (char& c : out) {
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                    c == '-' || c == '_';
+        if (!safe) c = '_';
+    }
+    return out;
+}
+
+} // namespace detail
+
+// Spans of one traced request. Thread-safe: handlers may add spans from
+// background work while the SDK adds its own.
+class RequestTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    RequestTrace(std::string trace_id, int request_id, std::string function, bool in_band)
+        : m_id(std::move(trace_id)), m_request_id(request_id), m_function(std::move(function)),
+          m_in_band(in_band), m_received(Clock::now()) {}
+
+    const std::string& id() const { return m_id; }
+    int request_id() const { return m_request_id; }
+    const std::string& function() const { return m_function; }
+    Clock::time_point received() const { return m_received; }
+
+    // Whether the caller asked for the trace (and gets it back in the response)
+    bool in_band() const { return m_in_band; }
+
+    void add_span(std::string name, Clock::time_point start, Clock::time_point end, json args = json::object()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_spans.push_back({ std::move(name), start, end < start ? start : end, std::move(args) });
+    }
+
+    // Chrome trace events: this process and request's names, then one
+    // complete ("X") event per span, all on the request's row
+    json events(const std::string& process_name) const {
+        int64_t pid = detail::process_id();
+        json out = json::array();
+        out.push_back({ {"name", "process_name"}, {"ph", "M"}, {"pid", pid}, {"tid", 0},
+                        {"args", {{"name", process_name}}} });
+        out.push_back({ {"name", "thread_name"}, {"ph", "M"}, {"pid", pid}, {"tid", m_request_id},
+                        {"args", {{"name", "request " + std::to_string(m_request_id)}}} });
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const Span& span : m_spans) {
+            int64_t ts = detail::trace_timestamp_us(span.start);
+            out.push_back({ {"name", span.name}, {"cat", "plugin"}, {"ph", "X"}, {"ts", ts},
+                            {"dur", detail::trace_timestamp_us(span.end) - ts},
+                            {"pid", pid}, {"tid", m_request_id}, {"args", span.args} });
+        }
+        return out;
+    }
+
+private:
+    struct Span {
+        std::string name;
+        Clock::time_point start;
+        Clock::time_point end;
+        json args;
+    };
+
+    std::string m_id;
+    int m_request_id;
+    std::string m_function;
+    bool m_in_band;
+    Clock::time_point m_received;
+    mutable std::mutex m_mutex;
+    std::vector<Span> m_spans;
+};
+
+// Records a span from construction to end() or destruction; does nothing
+// when the request is not traced
+class TraceSpan {
+public:
+    TraceSpan(RequestTrace* trace, std::string name)
+        : m_trace(trace), m_name(std::move(name)),
+          m_start(trace ? RequestTrace::Clock::now() : RequestTrace::Clock::time_point()) {}
+
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void end() {
+        if (!m_trace) return;
+        m_trace->add_span(std::move(m_name), m_start, RequestTrace::Clock::now());
+        m_trace = nullptr;
+    }
+
+private:
+    RequestTrace* m_trace;
+    std::string m_name;
+    RequestTrace::Clock::time_point m_start;
+};
+
+// Write trace events as a Chrome trace file
+inline bool write_chrome_trace(const std::string& path, const json& events, const std::string& trace_id,
+                               std::string* error = nullptr) {
+    json file;
+    file["traceEvents"] = events;
+    file["displayTimeUnit"] = "ms";
+    file["otherData"]["trace_id"] = trace_id;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::string text = file.dump();
+    if (!out || !out.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+        if (error) *error = "Cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Cancellation
+// ============================================================================
+
+// Shared flag telling a handler that the engine gave up on its request.
+// Copies refer to the same flag, so it can be handed to background work.
+class CancellationToken {
+public:
+    CancellationToken() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    bool is_cancelled() const { return m_flag->load(std::memory_order_acquire); }
+    void cancel() const { m_flag->store(true, std::memory_order_release); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+// ============================================================================
+// Async Results
+// ============================================================================
+
+// Completion handle of an async command (see Plugin::command_async). The
+// handler, or work it started, calls complete() or fail() once; later calls
+// are ignored, and dropping every copy without either fails the request.
+// Copies refer to the same request, so it can be moved into a callback or
+// another thread. Completing wakes the SDK directly; nothing polls for the
+// result. A result still outstanding when its Plugin is destroyed is failed
+// and its request cancelled; done() tells the work it can stop.
+class AsyncResult {
+public:
+    void complete(json result) const { finish(std::move(result), nullptr); }
+    void fail(std::exception_ptr error) const { finish(json(), std::move(error)); }
+    void fail(const std::string& message) const { fail(std::make_exception_ptr(std::runtime_error(message))); }
+
+    // True once complete() or fail() was called
+    bool done() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        return m_state->done;
+    }
+
+private:
+    friend class Plugin;
+    using Callback = std::function<void(json result, std::exception_ptr error)>;
+
+    struct State {
+        mutable std::mutex mutex;
+        bool done = false;
+        Callback on_done;
+
+        // Every copy was dropped without completing: fail the request
+        // rather than leave it in flight
+        ~State() {
+            if (!done && on_done) {
+                on_done(json(), std::make_exception_ptr(std::runtime_error("Async command finished without a result")));
+            }
+        }
+    };
+
+    explicit AsyncResult(Callback on_done) : m_state(std::make_shared<State>()) {
+        m_state->on_done = std::move(on_done);
+    }
+
+    void finish(json result, std::exception_ptr error) const {
+        Callback on_done;
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            if (m_state->done) return;
+            m_state->done = true;
+            on_done = std::move(m_state->on_done);
+        }
+        if (on_done) on_done(std::move(result), std::move(error));
+    }
+
+    std::shared_ptr<State> m_state;
+};
+
+// ============================================================================
+// Request Context
+// ============================================================================
+
+// Per-request state handed to command handlers. Each execute/input request
+// gets its own context, so several requests can be in flight at once without
+// sharing a "current request" between them.
+class RequestContext {
+public:
+    RequestContext(Protocol& protocol, int request_id, StreamBatcher* batcher = nullptr,
+                   CancellationToken token = CancellationToken(),
+                   std::shared_ptr<RequestTrace> trace = nullptr)
+        : m_protocol(protocol), m_request_id(request_id), m_keep_session(false),
+          m_batcher(batcher), m_pending_chunks(0), m_token(std::move(token)), m_streamed(false),
+          m_trace(std::move(trace)) {}
+
+    ~RequestContext() { finish(); }
+
+    RequestContext(const RequestContext&) = delete;
+    RequestContext& operator=(const RequestContext&) = delete;
+
+    int request_id() const { return m_request_id; }
+
+    // True once the engine has cancelled this request; handlers should stop early
+    bool cancelled() const { return m_token.is_cancelled(); }
+    CancellationToken cancellation_token() const { return m_token; }
+
+    // Send streaming data for this request (buffered when batching is enabled).
+    // Dropped once the request has been cancelled.
+    void stream(const std::string& data) {
+        if (cancelled()) return;
+        m_streamed.store(true, std::memory_order_relaxed);
+
+        if (!m_batcher || !m_batcher->enabled()) {
+            send_stream(data);
+            if (m_batcher) m_batcher->record(1, 1);
+            return;
+        }
+
+        bool first_chunk = false;
+        {
+            std::lock_guard<std::mutex> lock(m_stream_mutex);
+            first_chunk = m_pending.empty();
+            m_pending += data;
+            ++m_pending_chunks;
+            if (m_pending.size() >= m_batcher->max_bytes()) {
+                flush_locked();
+                return;
+            }
+        }
+
+        if (first_chunk) {
+            m_batcher->schedule(this, StreamBatcher::Clock::now() + m_batcher->max_delay());
+        }
+    }
+
+    // Write out any buffered stream data now
+    void flush_stream() {
+        std::lock_guard<std::mutex> lock(m_stream_mutex);
+        flush_locked();
+    }
+
+    // Flush remaining data and detach from the batcher. Called before the
+    // request's complete/error notification so stream data always precedes it.
+    void finish() {
+        if (m_batcher) m_batcher->release(this);
+        flush_stream();
+    }
+
+    // Set passthrough mode for this request
+    void set_keep_session(bool keep) { m_keep_session = keep; }
+    bool keep_session() const { return m_keep_session; }
+
+    // Whether the handler produced any stream output for this request
+    bool has_streamed() const { return m_streamed.load(std::memory_order_relaxed); }
+
+    // The request's trace; null unless the caller asked for one
+    RequestTrace* trace() const { return m_trace.get(); }
+
+    // Time part of the handler under its own name in the trace:
+    //   auto span = ctx.trace_span("query device");
+    TraceSpan trace_span(std::string name) const { return TraceSpan(m_trace.get(), std::move(name)); }
+
+private:
+    friend class Plugin;
+
+    // Flush and forget the batcher, so that destroying the context later
+    // (async commands: on whichever thread drops the result) no longer
+    // touches the Plugin
+    void detach() {
+        finish();
+        m_batcher = nullptr;
+    }
+
+    void flush_locked() {
+        if (m_pending.empty()) return;
+        if (!cancelled()) {
+            send_stream(m_pending);
+            m_batcher->record(m_pending_chunks, 1);
+        }
+        m_pending.clear();
+        m_pending_chunks = 0;
+    }
+
+    void send_stream(const std::string& data) {
+        json notification;
+        notification["jsonrpc"] = "2.0";
+        notification["method"] = "stream";
+        notification["params"]["request_id"] = m_request_id;
+        notification["params"]["data"] = data;
+        m_protocol.write_message(notification);
+    }
+
+    Protocol& m_protocol;
+    int m_request_id;
+    bool m_keep_session;
+    StreamBatcher* m_batcher;
+    std::string m_pending;
+    uint64_t m_pending_chunks;
+    std::mutex m_stream_mutex;
+    CancellationToken m_token;
+    std::atomic<bool> m_streamed;
+    std::shared_ptr<RequestTrace> m_trace;
+};
+
+inline void StreamBatcher::flush_loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_deadlines.empty()) {
+            m_condition.wait(lock);
+            continue;
+        }
+
+        auto next = m_deadlines.begin()->second;
+        for (const auto& entry : m_deadlines) {
+            next = std::min(next, entry.second);
+        }
+
+        auto now = Clock::now();
+        if (now < next) {
+            m_condition.wait_until(lock, next);
+            continue;
+        }
+
+        // Flush while holding the lock so release() waits for us
+        for (auto it = m_deadlines.begin(); it != m_deadlines.end();) {
+            if (it->second <= now) {
+                it->first->flush_stream();
+                it = m_deadlines.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Worker Pool
+// ============================================================================
+
+// Fixed-size thread pool used when a plugin opts into concurrent execution.
+// Tasks run in FIFO order; shutdown() drains the queue before joining.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t thread_count) : m_stopping(false) {
+        for (size_t i = 0; i < thread_count; ++i) {
+            m_threads.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~WorkerPool() { shutdown(); }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) return;
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (auto& thread : m_threads) {
+            if (thread.joinable()) thread.join();
+        }
+    }
+
+private:
+    void worker_loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                if (m_tasks.empty()) return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+};
+
+// ============================================================================
+// Command Router
+// ============================================================================
+
+// Open-addressing hash table from command name to handler, built once when
+// the plugin starts. Lookups take a string_view straight from the parsed
+// message, so dispatch neither allocates nor walks a tree of string compares.
+template <typename Handler>
+class CommandRouter {
+public:
+    void build(const std::map<std::string, Handler>& commands) {
+        m_entries.clear();
+        m_entries.reserve(commands.size());
+        for (const auto& [name, handler] : commands) {
+            m_entries.push_back(Entry{ name, handler });
+        }
+
+        size_t capacity = 8;
+        while (capacity < m_entries.size() * 2) capacity <<= 1;
+        m_mask = capacity - 1;
+        m_slots.assign(capacity, EMPTY);
+
+        for (size_t i = 0; i < m_entries.size(); ++i) {
+            size_t slot = hash(m_entries[i].name) & m_mask;
+            while (m_slots[slot] != EMPTY) slot = (slot + 1) & m_mask;
+            m_slots[slot] = static_cast<uint32_t>(i);
+        }
+    }
+
+    const Handler* find(std::string_view name) const {
+        if (m_slots.empty()) return nullptr;
+        size_t slot = hash(name) & m_mask;
+        while (m_slots[slot] != EMPTY) {
+            const Entry& entry = m_entries[m_slots[slot]];
+            if (entry.name == name) return &entry.handler;
+            slot = (slot + 1) & m_mask;
+        }
+        return nullptr;
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+
+    struct Entry {
+        std::string name;
+        Handler handler;
+    };
+
+    static size_t hash(std::string_view name) {
+        return std::hash<std::string_view>{}(name);
+    }
+
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_slots;
+    size_t m_mask = 0;
+};
+
+// ============================================================================
+// Response Cache
+// ============================================================================
+
+// Limits for caching a command's results. Only use it for commands whose
+// result depends on nothing but their arguments.
+struct CachePolicy {
+    std::chrono::milliseconds ttl{0};   // 0 keeps entries until evicted
+    size_t max_entries = 256;
+    size_t max_bytes = 1024 * 1024;     // serialized arguments + results
+};
+
+// LRU map from a command's canonical arguments to its last result. The key
+// is the compact JSON dump of the arguments; objects serialize in sorted key
+// order, so equal arguments always produce the same key regardless of the
+// order the engine sent them in.
+class ResponseCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ResponseCache(const CachePolicy& policy) : m_policy(policy), m_bytes(0) {}
+
+    static std::string key_for(const json& arguments) {
+        return arguments.dump();
+    }
+
+    bool get(const std::string& key, json& result, bool& keep_session) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return false;
+
+        auto node = it->second;
+        if (m_policy.ttl.count() > 0 && Clock::now() >= node->expires) {
+            erase(node);
+            return false;
+        }
+
+        m_lru.splice(m_lru.begin(), m_lru, node);
+        result = node->result;
+        keep_session = node->keep_session;
+        return true;
+    }
+
+    void put(const std::string& key, const json& result, bool keep_session) {
+        size_t bytes = key.size() + result.dump().size();
+        if (bytes > m_policy.max_bytes || m_policy.max_entries == 0) return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) erase(it->second);
+
+        m_lru.push_front(Node{ key, result, keep_session, bytes, Clock::now() + m_policy.ttl });
+        m_index.emplace(m_lru.front().key, m_lru.begin());
+        m_bytes += bytes;
+
+        while (m_lru.size() > m_policy.max_entries || m_bytes > m_policy.max_bytes) {
+            erase(std::prev(m_lru.end()));
+        }
+    }
+
+private:
+    struct Node {
+        std::string key;
+        json result;
+        bool keep_session;
+        size_t bytes;
+        Clock::time_point expires;
+    };
+
+    void erase(std::list<Node>::iterator node) {
+        m_bytes -= node->bytes;
+        m_index.erase(node->key);
+        m_lru.erase(node);
+    }
+
+    CachePolicy m_policy;
+    std::list<Node> m_lru;  // most recently used first
+    std::unordered_map<std::string_view, std::list<Node>::iterator> m_index;  // views into m_lru keys
+    size_t m_bytes;
+    std::mutex m_mutex;
+};
 
 // ============================================================================
-// Protocol Handler
+// Logging
 // ============================================================================
 
-class Protocol {
-public:
-    static constexpr size_t MAX_MESSAGE_SIZE = 10 * 1024 * 1024; // 10MB
+enum class LogLevel : uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
 
-    Protocol() : m_closed(false) {
-#ifdef _WIN32
-        m_stdin_handle = GetStdHandle(STD_INPUT_HANDLE);
-        m_stdout_handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        // Set binary mode for stdin/stdout
-        _setmode(_fileno(stdin), _O_BINARY);
-        _setmode(_fileno(stdout), _O_BINARY);
-#endif
+inline const char* log_level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warning: return "WARN";
+        case LogLevel::Error: return "ERROR";
+        default: return "";
     }
+}
 
-    bool read_message(json& out_message) {
-        if (m_closed) return false;
+namespace detail {
 
-        std::lock_guard<std::mutex> lock(m_read_mutex);
+inline void append_log_part(std::string& out, std::string_view part) { out.append(part); }
+inline void append_log_part(std::string& out, const char* part) { out.append(part); }
+inline void append_log_part(std::string& out, const std::string& part) { out.append(part); }
+inline void append_log_part(std::string& out, char part) { out.push_back(part); }
+inline void append_log_part(std::string& out, bool part) { out.append(part ? "true" : "false"); }
 
-        // Read 4-byte length header (big-endian)
-        uint8_t header[4];
-        if (!read_bytes(header, 4)) {
-            m_closed = true;
-            return false;
-        }
+template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+void append_log_part(std::string& out, T part) { out.append(std::to_string(part)); }
 
-        uint32_t length = (static_cast<uint32_t>(header[0]) << 24) | 
-                          (static_cast<uint32_t>(header[1]) << 16) | 
-                          (static_cast<uint32_t>(header[2]) << 8) | 
-                          static_cast<uint32_t>(header[3]);
+} // namespace detail
 
-        if (length > MAX_MESSAGE_SIZE || length == 0) {
-            return false;
-        }
+// Background file logger. Callers format a line and push it into a bounded
+// lock-free ring (multi-producer, single consumer); a writer thread drains
+// the ring and writes each batch with one write and one flush. A full ring
+// drops lines rather than blocking the caller, and the drop count is logged.
+class AsyncLogger {
+public:
+    using Clock = std::chrono::system_clock;
 
-        // Read JSON payload
-        std::vector<char> buffer(length);
-        if (!read_bytes(reinterpret_cast<uint8_t*>(buffer.data()), length)) {
-            m_closed = true;
-            return false;
-        }
+    static constexpr size_t CAPACITY = 4096;  // power of two
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{100};
 
-        // Parse JSON
-        try {
-            out_message = json::parse(buffer.begin(), buffer.end());
-            return true;
-        } catch (...) {
-            return false;
+    AsyncLogger()
+        : m_level(LogLevel::Info), m_slots(new Slot[CAPACITY]), m_enqueue_pos(0),
+          m_dequeue_pos(0), m_dropped(0), m_open(false), m_wake(false), m_stopping(false) {
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
         }
     }
 
-    bool write_message(const json& message) {
-        if (m_closed) return false;
+    ~AsyncLogger() { stop(); }
 
-        std::lock_guard<std::mutex> lock(m_write_mutex);
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
 
-        // Ensure jsonrpc field
-        json msg = message;
-        if (!msg.contains("jsonrpc")) {
-            msg["jsonrpc"] = "2.0";
+    void open(const std::string& path) {
+        m_file.open(path, std::ios::app);
+        if (m_file.is_open()) {
+            m_open = true;
+            m_thread = std::thread([this] { write_loop(); });
         }
+    }
 
-        // Serialize to JSON
-        std::string payload = msg.dump();
-
-        if (payload.size() > MAX_MESSAGE_SIZE) {
-            return false;
+    // Drain everything queued so far and stop the writer thread
+    void stop() {
+        m_open = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
         }
+        m_condition.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+        if (m_file.is_open()) m_file.close();
+    }
 
-        // Create length-prefixed message
-        uint32_t length = static_cast<uint32_t>(payload.size());
-        uint8_t header[4] = {
-            static_cast<uint8_t>((length >> 24) & 0xFF),
-            static_cast<uint8_t>((length >> 16) & 0xFF),
-            static_cast<uint8_t>((length >> 8) & 0xFF),
-            static_cast<uint8_t>(length & 0xFF)
-        };
-
-        // Write header + payload
-        if (!write_bytes(header, 4)) return false;
-        if (!write_bytes(reinterpret_cast<const uint8_t*>(payload.data()), payload.size())) return false;
+    void set_level(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return m_level.load(std::memory_order_relaxed); }
 
-        return true;
+    bool enabled(LogLevel level) const {
+        return level >= this->level() && level != LogLevel::Off && m_open.load(std::memory_order_relaxed);
     }
 
-    void close() { m_closed = true; }
-    bool is_closed() const { return m_closed; }
+    void write(LogLevel level, std::string text) {
+        if (!try_push(level, std::move(text))) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // Errors go out promptly; everything else waits for the next batch
+        if (level >= LogLevel::Error) {
+            m_wake.store(true, std::memory_order_release);
+            m_condition.notify_one();
+        }
+    }
 
 private:
-    bool read_bytes(uint8_t* buffer, size_t count) {
-#ifdef _WIN32
-        DWORD bytes_read = 0;
-        size_t total_read = 0;
-        while (total_read < count) {
-            if (!ReadFile(m_stdin_handle, buffer + total_read, 
-                         static_cast<DWORD>(count - total_read), &bytes_read, NULL)) {
+    struct Line {
+        LogLevel level;
+        Clock::time_point time;
+        std::string text;
+    };
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Line line;
+    };
+
+    static constexpr size_t MASK = CAPACITY - 1;
+
+    // Bounded MPMC queue (Vyukov); each slot's sequence says whose turn it is
+    bool try_push(LogLevel level, std::string&& text) {
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[pos & MASK];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.line.level = level;
+                    slot.line.time = Clock::now();
+                    slot.line.text = std::move(text);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
                 return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
             }
-            if (bytes_read == 0) return false;
-            total_read += bytes_read;
         }
+    }
+
+    // Writer thread only
+    bool try_pop(Line& out) {
+        Slot& slot = m_slots[m_dequeue_pos & MASK];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1) return false;
+        out.level = slot.line.level;
+        out.time = slot.line.time;
+        out.text.swap(slot.line.text);
+        slot.line.text.clear();
+        slot.sequence.store(m_dequeue_pos + CAPACITY, std::memory_order_release);
+        ++m_dequeue_pos;
         return true;
+    }
+
+    static void append_timestamp(std::string& out, Clock::time_point time) {
+        std::time_t seconds = Clock::to_time_t(time);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
 #else
-        size_t total_read = 0;
-        while (total_read < count) {
-            ssize_t n = read(STDIN_FILENO, buffer + total_read, count - total_read);
-            if (n <= 0) return false;
-            total_read += n;
-        }
-        return true;
+        localtime_r(&seconds, &local);
 #endif
+        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+            time.time_since_epoch()).count() % 1000;
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+                      local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                      local.tm_hour, local.tm_min, local.tm_sec, static_cast<int>(millis));
+        out.append(buffer);
     }
 
-    bool write_bytes(const uint8_t* buffer, size_t count) {
-#ifdef _WIN32
-        DWORD bytes_written = 0;
-        if (!WriteFile(m_stdout_handle, buffer, static_cast<DWORD>(count), &bytes_written, NULL)) {
-            return false;
+    void drain(std::string& batch) {
+        Line entry;
+        while (try_pop(entry)) {
+            append_timestamp(batch, entry.time);
+            batch.append(" [");
+            batch.append(log_level_name(entry.level));
+            batch.append("] ");
+            batch.append(entry.text);
+            batch.push_back('\n');
         }
-        FlushFileBuffers(m_stdout_handle);
-        return bytes_written == count;
-#else
-        size_t total_written = 0;
-        while (total_written < count) {
-            ssize_t n = write(STDOUT_FILENO, buffer + total_written, count - total_written);
-            if (n <= 0) return false;
-            total_written += n;
+
+        uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped) {
+            append_timestamp(batch, Clock::now());
+            batch.append(" [WARN] ");
+            batch.append(std::to_string(dropped));
+            batch.append(" log lines dropped (queue full)\n");
+        }
+
+        if (!batch.empty()) {
+            m_file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            m_file.flush();
+            batch.clear();
         }
-        fsync(STDOUT_FILENO);
-        return true;
-#endif
     }
 
-    bool m_closed;
-    std::mutex m_read_mutex;
-    std::mutex m_write_mutex;
-#ifdef _WIN32
-    HANDLE m_stdin_handle;
-    HANDLE m_stdout_handle;
-#endif
+    void write_loop() {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping) {
+            m_condition.wait_for(lock, FLUSH_INTERVAL, [this] {
+                return m_stopping || m_wake.load(std::memory_order_acquire);
+            });
+            m_wake.store(false, std::memory_order_relaxed);
+            lock.unlock();
+            drain(batch);
+            lock.lock();
+        }
+        lock.unlock();
+        drain(batch);
+    }
+
+    std::atomic<LogLevel> m_level;
+    std::unique_ptr<Slot[]> m_slots;
+    alignas(64) std::atomic<size_t> m_enqueue_pos;
+    alignas(64) size_t m_dequeue_pos;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<bool> m_open;
+    std::atomic<bool> m_wake;
+    bool m_stopping;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+    std::ofstream m_file;
 };
 
 // ============================================================================
@@ -202,63 +1442,298 @@ private:
 class Plugin {
 public:
     using CommandHandler = std::function<json(const json& arguments)>;
+    using ContextCommandHandler = std::function<json(const json& arguments, RequestContext& context)>;
+    using AsyncCommandHandler = std::function<void(const json& arguments, RequestContext& context, AsyncResult result)>;
+
+    // Error code sent when the engine cancels an in-flight request
+    static constexpr int ERROR_CANCELLED = -4;
 
     Plugin(const std::string& name, const std::string& version, const std::string& description = "")
         : m_name(name), m_version(version), m_description(description),
-          m_running(false), m_current_request_id(-1), m_keep_session(false) {
+          m_running(false), m_worker_threads(0), m_binary_encodings(true), m_async_outstanding(0),
+          m_async_stopping(false),
+          m_started(std::chrono::steady_clock::now()), m_unknown_commands(0),
+          m_metrics_interval(0), m_metrics_stopping(false) {
+        m_async_link = std::make_shared<AsyncLink>();
+        m_async_link->plugin = this;
+
         // Open log file
         std::string log_path = get_plugin_dir() + "\\" + name + ".log";
-        m_log_file.open(log_path, std::ios::app);
-        log("Plugin '" + name + "' v" + version + " initialized");
+        m_logger.open(log_path);
+        log(LogLevel::Info, "Plugin '", name, "' v", version, " initialized");
     }
 
     ~Plugin() {
-        if (m_log_file.is_open()) {
-            m_log_file.close();
-        }
+        abandon_async();
+        m_logger.stop();
     }
 
-    // Register a command handler
+    // Register a command handler. Commands must be registered before run().
     void command(const std::string& name, CommandHandler handler) {
-        m_commands[name] = handler;
-        log("Registered command: " + name);
+        Command entry;
+        entry.handler = [handler](const json& arguments, RequestContext&) {
+            return handler(arguments);
+        };
+        entry.metrics = &m_command_metrics[name];
+        m_commands[name] = std::move(entry);
+        log(LogLevel::Info, "Registered command: ", name);
     }
 
-    // Send streaming data during command execution
-    void stream(const std::string& data) {
-        if (m_current_request_id < 0) return;
+    // Register a command handler that receives its request context
+    void command(const std::string& name, ContextCommandHandler handler) {
+        Command entry;
+        entry.handler = std::move(handler);
+        entry.metrics = &m_command_metrics[name];
+        m_commands[name] = std::move(entry);
+        log(LogLevel::Info, "Registered command: ", name);
+    }
 
-        json notification;
-        notification["jsonrpc"] = "2.0";
-        notification["method"] = "stream";
-        notification["params"]["request_id"] = m_current_request_id;
-        notification["params"]["data"] = data;
-        m_protocol.write_message(notification);
+    // Register a command whose results are cached per distinct arguments.
+    // A hit is answered from the cache without running the handler. Results
+    // of failed calls and of calls that streamed output are not cached.
+    void command(const std::string& name, CommandHandler handler, const CachePolicy& policy) {
+        command(name, std::move(handler));
+        m_commands[name].cache = std::make_shared<ResponseCache>(policy);
+    }
+
+    void command(const std::string& name, ContextCommandHandler handler, const CachePolicy& policy) {
+        command(name, std::move(handler));
+        m_commands[name].cache = std::make_shared<ResponseCache>(policy);
+    }
+
+    // Register an asynchronous command. The handler starts the work and
+    // returns; the work calls result.complete() or result.fail() when it is
+    // done, and the SDK sends the outcome then, without holding a reader or
+    // worker thread in the meantime. A handler that throws fails the request.
+    // The arguments and context stay valid until the result is completed.
+    // Background work should stream through the context and watch
+    // context.cancelled().
+    void command_async(const std::string& name, AsyncCommandHandler handler) {
+        Command entry;
+        entry.async_handler = std::move(handler);
+        entry.metrics = &m_command_metrics[name];
+        m_commands[name] = std::move(entry);
+        log(LogLevel::Info, "Registered async command: ", name);
+    }
+
+    // Run commands on a pool of worker threads instead of the reader thread.
+    // Must be called before run(); 0 (the default) keeps execution inline.
+    void set_worker_threads(size_t count) {
+        m_worker_threads = count;
+    }
+
+    // Coalesce stream() calls into fewer notifications. Data is sent once
+    // max_bytes are buffered, max_delay after the first buffered chunk, or
+    // when the command completes. Must be called before run().
+    void set_stream_batching(size_t max_bytes, std::chrono::milliseconds max_delay = std::chrono::milliseconds(16)) {
+        m_stream_batcher.configure(max_bytes, max_delay);
+    }
+
+    // Stream call/frame counters; frames_saved() shows how much batching helps
+    StreamBatcher::Stats stream_stats() const {
+        return m_stream_batcher.stats();
+    }
+
+    // Only messages at or above `level` are formatted and written (default: Info)
+    void set_log_level(LogLevel level) {
+        m_logger.set_level(level);
+    }
+
+    bool log_enabled(LogLevel level) const {
+        return m_logger.enabled(level);
+    }
+
+    // Append a line to the plugin log. The parts (strings, string views and
+    // numbers) are only concatenated when `level` is enabled; the file write
+    // happens on a background thread. Guard expensive arguments with
+    // log_enabled().
+    template<typename... Parts>
+    void log(LogLevel level, const Parts&... parts) {
+        if (!m_logger.enabled(level)) return;
+        std::string line;
+        (detail::append_log_part(line, parts), ...);
+        m_logger.write(level, std::move(line));
+    }
+
+    // Write a metrics snapshot to the log file every `interval` while running
+    // (0, the default, disables it). Must be called before run(). The same
+    // snapshot is always available to the engine through the `metrics` method.
+    void set_metrics_interval(std::chrono::seconds interval) {
+        m_metrics_interval = interval;
+    }
+
+    // Snapshot of traffic, streaming and per-command latency counters
+    json metrics() const {
+        using namespace std::chrono;
+
+        json out;
+        out["uptime_ms"] = duration_cast<milliseconds>(steady_clock::now() - m_started).count();
+
+        Protocol::Stats io = m_protocol.stats();
+        out["protocol"]["bytes_read"] = io.bytes_read;
+        out["protocol"]["bytes_written"] = io.bytes_written;
+        out["protocol"]["frames_read"] = io.frames_read;
+        out["protocol"]["frames_written"] = io.frames_written;
+        out["protocol"]["parse_failures"] = io.parse_failures;
+
+        StreamBatcher::Stats stream = m_stream_batcher.stats();
+        out["stream"]["chunks"] = stream.chunks;
+        out["stream"]["frames"] = stream.frames;
+        out["stream"]["frames_saved"] = stream.frames_saved();
+
+        out["unknown_commands"] = m_unknown_commands.load();
+        out["commands"] = json::object();
+        for (const auto& [name, command] : m_command_metrics) {
+            out["commands"][name] = command.to_json();
+        }
+        return out;
+    }
+
+    // Allow a binary encoding to be negotiated with the engine. When the engine
+    // lists supported encodings in `initialize`, the first one this plugin
+    // also accepts is used for all later frames; JSON is always the fallback.
+    void set_binary_encodings(bool enabled) {
+        m_binary_encodings = enabled;
     }
 
-    // Set passthrough mode
+    // Also write each traced request to `directory` as a Chrome trace file
+    // (<trace_id>.<plugin>.<request_id>.json), and trace every execute
+    // request, not only those that carry a trace_id. Must be called before run().
+    void set_trace_directory(const std::string& directory) {
+        m_trace_directory = directory;
+    }
+
+    // Choose when frames are flushed to the engine (default: FlushPolicy::None)
+    void set_flush_policy(FlushPolicy policy) {
+        m_protocol.set_flush_policy(policy);
+    }
+
+    // Send streaming data during command execution.
+    // Applies to the request being handled on the calling thread.
+    void stream(const std::string& data) {
+        RequestContext* context = current_context();
+        if (!context) return;
+        context->stream(data);
+    }
+
+    // Set passthrough mode for the request being handled on the calling thread
     void set_keep_session(bool keep) {
-        m_keep_session = keep;
+        RequestContext* context = current_context();
+        if (!context) return;
+        context->set_keep_session(keep);
     }
 
     // Run the plugin main loop
     void run() {
-        log("Starting plugin main loop");
+        log(LogLevel::Info, "Starting plugin main loop");
         m_running = true;
 
+        m_router.build(m_commands);
+
+        if (m_worker_threads > 0) {
+            m_pool = std::make_unique<WorkerPool>(m_worker_threads);
+            log(LogLevel::Info, "Concurrent mode: ", m_worker_threads, " worker threads");
+        }
+        m_stream_batcher.start();
+
+        for (const auto& [name, entry] : m_commands) {
+            if (entry.async_handler) {
+                m_async_stopping = false;
+                m_async_thread = std::thread([this] { async_loop(); });
+                break;
+            }
+        }
+
+        if (m_metrics_interval.count() > 0) {
+            m_metrics_stopping = false;
+            m_metrics_thread = std::thread([this] { metrics_loop(); });
+        }
+
         while (m_running) {
             json message;
-            if (!m_protocol.read_message(message)) {
+            ReadStatus status = m_protocol.read_message(message);
+            if (status == ReadStatus::BadPayload) {
+                log(LogLevel::Warning, "Dropped a message that did not decode");
+                continue;
+            }
+            if (status != ReadStatus::Ok) {
+                if (status == ReadStatus::BadHeader) log(LogLevel::Error, "Malformed frame header; closing");
                 break;
             }
 
             handle_message(message);
         }
 
-        log("Plugin stopped");
+        // Let in-flight commands finish and report before exiting
+        if (m_pool) {
+            m_pool->shutdown();
+            m_pool.reset();
+        }
+        if (m_async_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_async_mutex);
+                m_async_stopping = true;
+            }
+            m_async_condition.notify_all();
+            m_async_thread.join();
+        }
+        m_stream_batcher.stop();
+        if (m_metrics_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_metrics_mutex);
+                m_metrics_stopping = true;
+            }
+            m_metrics_condition.notify_all();
+            m_metrics_thread.join();
+        }
+
+        if (m_stream_batcher.enabled()) {
+            StreamBatcher::Stats stats = m_stream_batcher.stats();
+            log(LogLevel::Info, "Stream batching: ", stats.chunks, " chunks in ", stats.frames,
+                " frames (", stats.frames_saved(), " saved)");
+        }
+        if (log_enabled(LogLevel::Info)) {
+            log(LogLevel::Info, "Metrics: ", metrics().dump());
+        }
+
+        log(LogLevel::Info, "Plugin stopped");
     }
 
 private:
+    struct Command {
+        ContextCommandHandler handler;
+        AsyncCommandHandler async_handler;
+        CommandMetrics* metrics = nullptr;
+        std::shared_ptr<ResponseCache> cache;
+    };
+
+    // Bookkeeping for a request that has not reported its outcome yet
+    struct InFlight {
+        CancellationToken token;
+        CommandMetrics* metrics;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    // An async request; owned by its AsyncResult, and listed in
+    // m_async_requests until completed
+    struct PendingAsync {
+        json arguments;
+        std::unique_ptr<RequestContext> context;
+        std::weak_ptr<AsyncResult::State> state;
+        bool cancelled = false;     // no longer holds up shutdown
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point finished;
+        json result;
+        std::exception_ptr error;
+    };
+
+    // Shared with every async completion callback, which can run on any
+    // thread, even after the Plugin is gone. Cleared on teardown.
+    struct AsyncLink {
+        std::mutex mutex;
+        Plugin* plugin = nullptr;
+    };
+
     std::string get_plugin_dir() {
 #ifdef _WIN32
         const char* programdata = std::getenv("PROGRAMDATA");
@@ -271,30 +1746,69 @@ private:
 #endif
     }
 
-    void log(const std::string& message) {
-        if (m_log_file.is_open()) {
-            m_log_file << message << std::endl;
-            m_log_file.flush();
+    // Context of the request executing on this thread (null outside handlers)
+    static RequestContext*& current_context() {
+        thread_local RequestContext* context = nullptr;
+        return context;
+    }
+
+    enum class Method {
+        Unknown,
+        Ping,
+        Initialize,
+        Execute,
+        Input,
+        Cancel,
+        Metrics,
+        Shutdown
+    };
+
+    // Method names mostly have distinct lengths, so one or two compares settle the match
+    static Method lookup_method(std::string_view name) {
+        switch (name.size()) {
+            case 4:  return name == "ping" ? Method::Ping : Method::Unknown;
+            case 5:  return name == "input" ? Method::Input : Method::Unknown;
+            case 6:  return name == "cancel" ? Method::Cancel : Method::Unknown;
+            case 7:  return name == "execute" ? Method::Execute
+                          : name == "metrics" ? Method::Metrics : Method::Unknown;
+            case 8:  return name == "shutdown" ? Method::Shutdown : Method::Unknown;
+            case 10: return name == "initialize" ? Method::Initialize : Method::Unknown;
+            default: return Method::Unknown;
         }
     }
 
-    void handle_message(const json& message) {
-        std::string method = message.value("method", "");
-        int id = message.contains("id") ? message["id"].get<int>() : -1;
-        json params = message.value("params", json::object());
+    static std::string_view string_field(const json& object, const char* key) {
+        auto it = object.find(key);
+        if (it == object.end() || !it->is_string()) return std::string_view();
+        return it->template get_ref<const std::string&>();
+    }
 
-        log("Received: " + method);
+    static json& empty_object() {
+        thread_local json empty = json::object();
+        empty = json::object();
+        return empty;
+    }
 
-        if (method == "ping") {
-            handle_ping(id, params);
-        } else if (method == "initialize") {
-            handle_initialize(id, params);
-        } else if (method == "execute") {
-            handle_execute(id, params);
-        } else if (method == "input") {
-            handle_input(id, params);
-        } else if (method == "shutdown") {
-            m_running = false;
+    void handle_message(json& message) {
+        if (!message.is_object()) return;
+
+        std::string_view method = string_field(message, "method");
+        auto id_it = message.find("id");
+        int id = id_it != message.end() ? id_it->get<int>() : -1;
+        auto params_it = message.find("params");
+        json& params = params_it != message.end() && params_it->is_object() ? *params_it : empty_object();
+
+        log(LogLevel::Debug, "Received: ", method);
+
+        switch (lookup_method(method)) {
+            case Method::Ping:       handle_ping(id, params); break;
+            case Method::Initialize: handle_initialize(id, params); break;
+            case Method::Execute:    handle_execute(id, params); break;
+            case Method::Input:      handle_input(id, params); break;
+            case Method::Cancel:     handle_cancel(params); break;
+            case Method::Metrics:    handle_metrics(id); break;
+            case Method::Shutdown:   m_running = false; break;
+            default: break;
         }
     }
 
@@ -306,8 +1820,35 @@ private:
         m_protocol.write_message(response);
     }
 
+    void handle_metrics(int id) {
+        json response;
+        response["jsonrpc"] = "2.0";
+        response["id"] = id;
+        response["result"] = metrics();
+        m_protocol.write_message(response);
+    }
+
+    // Pick the engine's most preferred encoding that we support
+    Encoding negotiate_encoding(const json& params) const {
+        if (!m_binary_encodings) return Encoding::Json;
+
+        auto it = params.find("encodings");
+        if (it == params.end() || !it->is_array()) return Encoding::Json;
+
+        for (const auto& name : *it) {
+            if (!name.is_string()) continue;
+            const std::string& value = name.get_ref<const std::string&>();
+            if (value == "cbor") return Encoding::Cbor;
+            if (value == "msgpack") return Encoding::MessagePack;
+            if (value == "json") return Encoding::Json;
+        }
+        return Encoding::Json;
+    }
+
     void handle_initialize(int id, const json& params) {
-        log("Initializing...");
+        log(LogLevel::Info, "Initializing...");
+
+        Encoding encoding = negotiate_encoding(params);
 
         json commands = json::array();
         for (const auto& [name, handler] : m_commands) {
@@ -325,40 +1866,49 @@ private:
         response["result"]["description"] = m_description;
         response["result"]["protocol_version"] = "2.0";
         response["result"]["commands"] = commands;
+        response["result"]["encoding"] = encoding_name(encoding);
         m_protocol.write_message(response);
-        log("Initialization complete");
-    }
 
-    void handle_execute(int id, const json& params) {
-        std::string function_name = params.value("function", "");
-        json arguments = params.value("arguments", json::object());
+        // The initialize response itself goes out as JSON; switch afterwards
+        m_protocol.set_write_encoding(encoding);
+        log(LogLevel::Info, "Initialization complete (encoding: ", encoding_name(encoding), ")");
+    }
 
-        log("Executing: " + function_name);
+    void handle_execute(int id, json& params) {
+        std::string_view function_name = string_field(params, "function");
 
-        m_current_request_id = id;
-        m_keep_session = false;
+        log(LogLevel::Debug, "Executing: ", function_name);
 
-        auto it = m_commands.find(function_name);
-        if (it == m_commands.end()) {
-            send_error(id, -32601, "Unknown command: " + function_name);
-            m_current_request_id = -1;
+        const Command* handler = m_router.find(function_name);
+        if (!handler) {
+            ++m_unknown_commands;
+            send_error(id, -32601, "Unknown command: " + std::string(function_name));
             return;
         }
 
-        try {
-            json result = it->second(arguments);
-            send_complete(id, true, result);
-        } catch (const std::exception& e) {
-            send_error(id, -1, e.what());
-        }
+        auto args_it = params.find("arguments");
+        json& arguments = args_it != params.end() ? *args_it : empty_object();
+        dispatch(id, handler, arguments, begin_trace(id, function_name, params));
+    }
+
+    // Trace of an execute request, if the caller sent a trace_id or a trace
+    // directory is set
+    std::shared_ptr<RequestTrace> begin_trace(int id, std::string_view function, const json& params) {
+        std::string_view trace_id = string_field(params, "trace_id");
+        if (trace_id.empty() && m_trace_directory.empty()) return nullptr;
 
-        m_current_request_id = -1;
+        std::string name = trace_id.empty()
+            ? m_name + "-" + std::to_string(detail::trace_timestamp_us(m_started)) + "-" + std::to_string(id)
+            : std::string(trace_id);
+        return std::make_shared<RequestTrace>(std::move(name), id, std::string(function), !trace_id.empty());
     }
 
-    void handle_input(int id, const json& params) {
-        std::string content = params.value("content", "");
+    void handle_input(int id, json& params) {
+        auto content_it = params.find("content");
+        std::string content = content_it != params.end() && content_it->is_string()
+            ? std::move(content_it->get_ref<std::string&>()) : std::string();
 
-        log("Input: " + content.substr(0, 50));
+        log(LogLevel::Debug, "Input: ", std::string_view(content).substr(0, 50));
 
         // Send acknowledgment
         json ack;
@@ -367,56 +1917,385 @@ private:
         ack["result"]["acknowledged"] = true;
         m_protocol.write_message(ack);
 
-        m_current_request_id = id;
-        m_keep_session = false;
-
-        auto it = m_commands.find("on_input");
-        if (it != m_commands.end()) {
-            try {
-                json args;
-                args["content"] = content;
-                json result = it->second(args);
-                send_complete(id, true, result);
-            } catch (const std::exception& e) {
-                send_error(id, -1, e.what());
-            }
+        const Command* handler = m_router.find("on_input");
+        if (handler) {
+            json args = json::object();
+            args["content"] = std::move(content);
+            dispatch(id, handler, args);
         } else {
-            send_complete(id, true, json("Received: " + content));
+            send_complete(id, true, json("Received: " + content), false);
+        }
+    }
+
+    void handle_cancel(const json& params) {
+        int target = params.value("request_id", -1);
+
+        CancellationToken token;
+        CommandMetrics* metrics = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_inflight_mutex);
+            auto it = m_inflight.find(target);
+            if (it == m_inflight.end()) {
+                log(LogLevel::Debug, "Cancel for unknown request ", target);
+                return;
+            }
+            token = it->second.token;
+            metrics = it->second.metrics;
+            m_inflight.erase(it);
+        }
+
+        // The request is gone from the engine's point of view: report it now,
+        // and whatever the handler produces later is dropped
+        token.cancel();
+        if (metrics) ++metrics->cancelled;
+        send_error(target, ERROR_CANCELLED, "Request cancelled");
+        log(LogLevel::Info, "Cancelled request ", target);
+
+        // A cancelled async request no longer holds up shutdown
+        bool drained = false;
+        {
+            std::lock_guard<std::mutex> lock(m_async_mutex);
+            auto it = m_async_requests.find(target);
+            if (it != m_async_requests.end() && !it->second->cancelled) {
+                it->second->cancelled = true;
+                drained = --m_async_outstanding == 0;
+            }
+        }
+        if (drained) m_async_condition.notify_one();
+    }
+
+    CancellationToken begin_request(int id, CommandMetrics* metrics) {
+        if (metrics) ++metrics->calls;
+        std::lock_guard<std::mutex> lock(m_inflight_mutex);
+        InFlight entry{ CancellationToken(), metrics, std::chrono::steady_clock::now() };
+        return m_inflight.emplace(id, std::move(entry)).first->second.token;
+    }
+
+    // Claim the right to report a request's outcome; false if it was cancelled.
+    // Records the request's latency against its command.
+    bool end_request(int id, bool failed = false) {
+        InFlight entry;
+        {
+            std::lock_guard<std::mutex> lock(m_inflight_mutex);
+            auto it = m_inflight.find(id);
+            if (it == m_inflight.end()) return false;
+            entry = std::move(it->second);
+            m_inflight.erase(it);
+        }
+
+        if (entry.metrics) {
+            entry.metrics->latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - entry.started));
+            if (failed) ++entry.metrics->errors;
+        }
+        return true;
+    }
+
+    // Run a handler inline (arguments by reference) or hand it to the worker
+    // pool (arguments moved out of the parsed message, never copied)
+    void dispatch(int id, const Command* command, json& arguments,
+                  std::shared_ptr<RequestTrace> trace = nullptr) {
+        std::string cache_key;
+        if (command->cache) {
+            cache_key = ResponseCache::key_for(arguments);
+            if (answer_from_cache(id, *command, cache_key, trace.get())) return;
+        }
+
+        CancellationToken token = begin_request(id, command->metrics);
+
+        if (command->async_handler) {
+            if (!m_pool) {
+                start_async(id, command->async_handler, std::move(arguments), token, std::move(trace));
+                return;
+            }
+            m_pool->submit([this, id, command, arguments = std::move(arguments), token,
+                            trace = std::move(trace)]() mutable {
+                start_async(id, command->async_handler, std::move(arguments), token, std::move(trace));
+            });
+            return;
+        }
+
+        if (!m_pool) {
+            run_handler(id, *command, arguments, token, cache_key, trace);
+            return;
+        }
+
+        m_pool->submit([this, id, command, arguments = std::move(arguments), token,
+                        cache_key = std::move(cache_key), trace = std::move(trace)]() {
+            run_handler(id, *command, arguments, token, cache_key, trace);
+        });
+    }
+
+    bool answer_from_cache(int id, const Command& command, const std::string& key, RequestTrace* trace) {
+        auto started = std::chrono::steady_clock::now();
+        json result;
+        bool keep_session = false;
+        if (!command.cache->get(key, result, keep_session)) {
+            if (command.metrics) ++command.metrics->cache_misses;
+            return false;
+        }
+
+        if (trace) trace->add_span("cache hit", started, std::chrono::steady_clock::now());
+        send_complete(id, true, std::move(result), keep_session, trace);
+        if (command.metrics) {
+            ++command.metrics->calls;
+            ++command.metrics->cache_hits;
+            command.metrics->latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started));
+        }
+        return true;
+    }
+
+    void run_handler(int id, const Command& command, const json& arguments, const CancellationToken& token,
+                     const std::string& cache_key, const std::shared_ptr<RequestTrace>& trace) {
+        if (token.is_cancelled()) return;
+
+        if (trace) trace->add_span("queued", trace->received(), std::chrono::steady_clock::now());
+        RequestContext context(m_protocol, id, &m_stream_batcher, token, trace);
+        RequestContext*& current = current_context();
+        RequestContext* previous = current;
+        current = &context;
+
+        try {
+            TraceSpan handler_span(trace.get(), "handler");
+            json result = command.handler(arguments, context);
+            context.finish();
+            handler_span.end();
+            if (command.cache && !context.has_streamed() && !context.cancelled()) {
+                command.cache->put(cache_key, result, context.keep_session());
+            }
+            if (end_request(id)) send_complete(id, true, std::move(result), context.keep_session(), trace.get());
+        } catch (const std::exception& e) {
+            context.finish();
+            fail_request(id, e.what(), trace.get());
+        } catch (...) {
+            context.finish();
+            fail_request(id, "Unknown error", trace.get());
+        }
+
+        current = previous;
+    }
+
+    void fail_request(int id, const std::string& message, RequestTrace* trace = nullptr) {
+        log(LogLevel::Error, "Request ", id, " failed: ", message);
+        if (end_request(id, true)) send_error(id, -1, message, trace);
+    }
+
+    void start_async(int id, const AsyncCommandHandler& handler, json arguments,
+                     const CancellationToken& token, std::shared_ptr<RequestTrace> trace) {
+        if (token.is_cancelled()) return;
+
+        auto pending = std::make_shared<PendingAsync>();
+        pending->started = std::chrono::steady_clock::now();
+        if (trace) trace->add_span("queued", trace->received(), pending->started);
+        pending->arguments = std::move(arguments);
+        pending->context = std::make_unique<RequestContext>(m_protocol, id, &m_stream_batcher, token, trace);
+
+        // Runs on whichever thread completes the result
+        AsyncResult result([link = m_async_link, pending](json value, std::exception_ptr error) {
+            std::lock_guard<std::mutex> lock(link->mutex);
+            if (link->plugin) link->plugin->queue_async(pending, std::move(value), std::move(error));
+        });
+        pending->state = result.m_state;
+
+        {
+            std::lock_guard<std::mutex> lock(m_async_mutex);
+            m_async_requests[id] = pending;
+            ++m_async_outstanding;
+        }
+
+        RequestContext*& current = current_context();
+        RequestContext* previous = current;
+        current = pending->context.get();
+        PendingAsync& request = *pending;
+        pending.reset();    // the result and m_async_requests own it from here on
+
+        try {
+            handler(request.arguments, *request.context, result);
+        } catch (...) {
+            result.fail(std::current_exception());
+        }
+        current = previous;
+    }
+
+    void queue_async(const std::shared_ptr<PendingAsync>& pending, json result, std::exception_ptr error) {
+        bool cancelled = false;
+        {
+            std::lock_guard<std::mutex> lock(m_async_mutex);
+            m_async_requests.erase(pending->context->request_id());
+            cancelled = pending->cancelled;
+            if (!cancelled) {
+                pending->finished = std::chrono::steady_clock::now();
+                pending->result = std::move(result);
+                pending->error = std::move(error);
+                m_async_completed.push_back(pending);
+            }
+        }
+        if (cancelled) {
+            pending->context->detach();     // already answered; nothing to report
+            return;
+        }
+        m_async_condition.notify_one();
+    }
+
+    void complete_async(PendingAsync& pending) {
+        RequestContext& context = *pending.context;
+        RequestTrace* trace = context.trace();
+        int id = context.request_id();
+
+        if (trace) trace->add_span("handler", pending.started, pending.finished, { {"async", true} });
+
+        context.detach();
+        if (!pending.error) {
+            if (end_request(id)) send_complete(id, true, std::move(pending.result), context.keep_session(), trace);
+            return;
+        }
+        try {
+            std::rethrow_exception(pending.error);
+        } catch (const std::exception& e) {
+            fail_request(id, e.what(), trace);
+        } catch (...) {
+            fail_request(id, "Unknown error", trace);
+        }
+    }
+
+    // Report async requests as their results are completed; on shutdown,
+    // keeps going until every outstanding one has been reported
+    void async_loop() {
+        std::unique_lock<std::mutex> lock(m_async_mutex);
+        while (true) {
+            m_async_condition.wait(lock, [this] {
+                return !m_async_completed.empty() || (m_async_stopping && m_async_outstanding == 0);
+            });
+            if (m_async_completed.empty()) return;
+
+            std::vector<std::shared_ptr<PendingAsync>> completed;
+            completed.swap(m_async_completed);
+            m_async_outstanding -= completed.size();
+            lock.unlock();
+            for (auto& pending : completed) {
+                complete_async(*pending);
+            }
+            completed.clear();
+            lock.lock();
+        }
+    }
+
+    // Cut completion callbacks off from this Plugin and fail the results
+    // still outstanding: cancelled requests, and any left when run() returned
+    void abandon_async() {
+        {
+            std::lock_guard<std::mutex> lock(m_async_link->mutex);
+            m_async_link->plugin = nullptr;
         }
 
-        m_current_request_id = -1;
+        std::map<int, std::shared_ptr<PendingAsync>> outstanding;
+        {
+            std::lock_guard<std::mutex> lock(m_async_mutex);
+            outstanding.swap(m_async_requests);
+        }
+        for (auto& [id, pending] : outstanding) {
+            pending->context->cancellation_token().cancel();
+            pending->context->detach();
+            if (auto state = pending->state.lock()) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done = true;
+            }
+        }
+    }
+
+    void metrics_loop() {
+        std::unique_lock<std::mutex> lock(m_metrics_mutex);
+        while (!m_metrics_stopping) {
+            if (m_metrics_condition.wait_for(lock, m_metrics_interval, [this] { return m_metrics_stopping; })) {
+                break;
+            }
+            lock.unlock();
+            if (log_enabled(LogLevel::Info)) {
+                log(LogLevel::Info, "Metrics: ", metrics().dump());
+            }
+            lock.lock();
+        }
     }
 
-    void send_complete(int request_id, bool success, const json& data) {
+    void send_complete(int request_id, bool success, json data, bool keep_session,
+                       RequestTrace* trace = nullptr) {
         json notification;
         notification["jsonrpc"] = "2.0";
         notification["method"] = "complete";
         notification["params"]["request_id"] = request_id;
         notification["params"]["success"] = success;
-        notification["params"]["data"] = data;
-        notification["params"]["keep_session"] = m_keep_session;
+        notification["params"]["data"] = std::move(data);
+        notification["params"]["keep_session"] = keep_session;
+        json events = finish_trace(trace, notification["params"], success);
         m_protocol.write_message(notification);
+        write_trace(trace, events);
     }
 
-    void send_error(int request_id, int code, const std::string& message) {
+    void send_error(int request_id, int code, const std::string& message, RequestTrace* trace = nullptr) {
         json notification;
         notification["jsonrpc"] = "2.0";
         notification["method"] = "error";
         notification["params"]["request_id"] = request_id;
         notification["params"]["code"] = code;
         notification["params"]["message"] = message;
+        json events = finish_trace(trace, notification["params"], false);
         m_protocol.write_message(notification);
+        write_trace(trace, events);
+    }
+
+    // Close a trace with the span of the whole request; its events go into
+    // the notification if the caller asked for them
+    json finish_trace(RequestTrace* trace, json& params, bool success) {
+        if (!trace) return json();
+        trace->add_span("execute " + trace->function(), trace->received(), std::chrono::steady_clock::now(),
+                        { {"trace_id", trace->id()}, {"request_id", trace->request_id()}, {"success", success} });
+        json events = trace->events(m_name);
+        if (trace->in_band()) params["trace"] = events;
+        return events;
+    }
+
+    void write_trace(const RequestTrace* trace, const json& events) {
+        if (!trace || m_trace_directory.empty()) return;
+        std::string path = m_trace_directory + "/" + detail::trace_file_part(trace->id()) + "." +
+                           detail::trace_file_part(m_name) + "." + std::to_string(trace->request_id()) + ".json";
+        std::string error;
+        if (!write_chrome_trace(path, events, trace->id(), &error)) {
+            log(LogLevel::Warning, error);
+        }
     }
 
     std::string m_name;
     std::string m_version;
     std::string m_description;
     Protocol m_protocol;
-    std::map<std::string, CommandHandler> m_commands;
-    bool m_running;
-    int m_current_request_id;
-    bool m_keep_session;
-    std::ofstream m_log_file;
+    std::map<std::string, Command> m_commands;
+    CommandRouter<Command> m_router;
+    std::atomic<bool> m_running;
+    size_t m_worker_threads;
+    bool m_binary_encodings;
+    std::unique_ptr<WorkerPool> m_pool;
+    StreamBatcher m_stream_batcher;
+    std::map<int, InFlight> m_inflight;
+    std::mutex m_inflight_mutex;
+    std::shared_ptr<AsyncLink> m_async_link;
+    std::map<int, std::shared_ptr<PendingAsync>> m_async_requests;
+    std::vector<std::shared_ptr<PendingAsync>> m_async_completed;
+    size_t m_async_outstanding;     // requests not yet completed or cancelled
+    std::mutex m_async_mutex;
+    std::condition_variable m_async_condition;
+    std::thread m_async_thread;
+    bool m_async_stopping;
+    std::chrono::steady_clock::time_point m_started;
+    std::map<std::string, CommandMetrics> m_command_metrics;
+    std::atomic<uint64_t> m_unknown_commands;
+    std::chrono::seconds m_metrics_interval;
+    bool m_metrics_stopping;
+    std::mutex m_metrics_mutex;
+    std::condition_variable m_metrics_condition;
+    std::thread m_metrics_thread;
+    std::string m_trace_directory;
+    AsyncLogger m_logger;
 };
 
 } // namespace gassist